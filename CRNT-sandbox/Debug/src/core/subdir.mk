@@ -4,58 +4,103 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../src/core/AsyncLog.cpp \
+../src/core/ChannelBuffer.cpp \
+../src/core/ChannelMath.cpp \
+../src/core/ChannelValue.cpp \
 ../src/core/ClientSocket.cpp \
+../src/core/Clock.cpp \
 ../src/core/Condition.cpp \
 ../src/core/DataInterface.cpp \
 ../src/core/DataPacket.cpp \
+../src/core/FixedMath.cpp \
 ../src/core/FloatValue.cpp \
+../src/core/HistoryRing.cpp \
 ../src/core/InPort.cpp \
 ../src/core/IntValue.cpp \
+../src/core/MetricsReporter.cpp \
 ../src/core/Mutex.cpp \
 ../src/core/OutPort.cpp \
+../src/core/PacketPool.cpp \
 ../src/core/SerialDevice.cpp \
+../src/core/SharedBuffer.cpp \
 ../src/core/Socket.cpp \
+../src/core/SocketReactor.cpp \
+../src/core/SpscInPort.cpp \
 ../src/core/StreamTask.cpp \
 ../src/core/TBObject.cpp \
+../src/core/TaskScheduler.cpp \
 ../src/core/Thread.cpp \
 ../src/core/Timer.cpp \
-../src/core/Value.cpp 
+../src/core/Value.cpp \
+../src/core/WaitSet.cpp \
+../src/core/WindowView.cpp 
 
 OBJS += \
+./src/core/AsyncLog.o \
+./src/core/ChannelBuffer.o \
+./src/core/ChannelMath.o \
+./src/core/ChannelValue.o \
 ./src/core/ClientSocket.o \
+./src/core/Clock.o \
 ./src/core/Condition.o \
 ./src/core/DataInterface.o \
 ./src/core/DataPacket.o \
+./src/core/FixedMath.o \
 ./src/core/FloatValue.o \
+./src/core/HistoryRing.o \
 ./src/core/InPort.o \
 ./src/core/IntValue.o \
+./src/core/MetricsReporter.o \
 ./src/core/Mutex.o \
 ./src/core/OutPort.o \
+./src/core/PacketPool.o \
 ./src/core/SerialDevice.o \
+./src/core/SharedBuffer.o \
 ./src/core/Socket.o \
+./src/core/SocketReactor.o \
+./src/core/SpscInPort.o \
 ./src/core/StreamTask.o \
 ./src/core/TBObject.o \
+./src/core/TaskScheduler.o \
 ./src/core/Thread.o \
 ./src/core/Timer.o \
-./src/core/Value.o 
+./src/core/Value.o \
+./src/core/WaitSet.o \
+./src/core/WindowView.o 
 
 CPP_DEPS += \
+./src/core/AsyncLog.d \
+./src/core/ChannelBuffer.d \
+./src/core/ChannelMath.d \
+./src/core/ChannelValue.d \
 ./src/core/ClientSocket.d \
+./src/core/Clock.d \
 ./src/core/Condition.d \
 ./src/core/DataInterface.d \
 ./src/core/DataPacket.d \
+./src/core/FixedMath.d \
 ./src/core/FloatValue.d \
+./src/core/HistoryRing.d \
 ./src/core/InPort.d \
 ./src/core/IntValue.d \
+./src/core/MetricsReporter.d \
 ./src/core/Mutex.d \
 ./src/core/OutPort.d \
+./src/core/PacketPool.d \
 ./src/core/SerialDevice.d \
+./src/core/SharedBuffer.d \
 ./src/core/Socket.d \
+./src/core/SocketReactor.d \
+./src/core/SpscInPort.d \
 ./src/core/StreamTask.d \
 ./src/core/TBObject.d \
+./src/core/TaskScheduler.d \
 ./src/core/Thread.d \
 ./src/core/Timer.d \
-./src/core/Value.d 
+./src/core/Value.d \
+./src/core/WaitSet.d \
+./src/core/WindowView.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
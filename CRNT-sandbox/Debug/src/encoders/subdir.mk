@@ -0,0 +1,33 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../src/encoders/BinaryDecoder.cpp \
+../src/encoders/BinaryEncoder.cpp \
+../src/encoders/DeltaDecoder.cpp \
+../src/encoders/DeltaEncoder.cpp 
+
+OBJS += \
+./src/encoders/BinaryDecoder.o \
+./src/encoders/BinaryEncoder.o \
+./src/encoders/DeltaDecoder.o \
+./src/encoders/DeltaEncoder.o 
+
+CPP_DEPS += \
+./src/encoders/BinaryDecoder.d \
+./src/encoders/BinaryEncoder.d \
+./src/encoders/DeltaDecoder.d \
+./src/encoders/DeltaEncoder.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/encoders/%.o: ../src/encoders/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
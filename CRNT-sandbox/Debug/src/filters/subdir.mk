@@ -0,0 +1,30 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../src/filters/SlidingWindow.cpp \
+../src/filters/StreamSynchronizer.cpp \
+../src/filters/WindowStatistics.cpp 
+
+OBJS += \
+./src/filters/SlidingWindow.o \
+./src/filters/StreamSynchronizer.o \
+./src/filters/WindowStatistics.o 
+
+CPP_DEPS += \
+./src/filters/SlidingWindow.d \
+./src/filters/StreamSynchronizer.d \
+./src/filters/WindowStatistics.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/filters/%.o: ../src/filters/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
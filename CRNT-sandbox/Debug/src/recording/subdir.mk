@@ -0,0 +1,39 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../src/recording/Recorder.cpp \
+../src/recording/Recording.cpp \
+../src/recording/RecordingIndex.cpp \
+../src/recording/RecordingReader.cpp \
+../src/recording/RecordingWriter.cpp \
+../src/recording/Replay.cpp 
+
+OBJS += \
+./src/recording/Recorder.o \
+./src/recording/Recording.o \
+./src/recording/RecordingIndex.o \
+./src/recording/RecordingReader.o \
+./src/recording/RecordingWriter.o \
+./src/recording/Replay.o 
+
+CPP_DEPS += \
+./src/recording/Recorder.d \
+./src/recording/Recording.d \
+./src/recording/RecordingIndex.d \
+./src/recording/RecordingReader.d \
+./src/recording/RecordingWriter.d \
+./src/recording/Replay.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/recording/%.o: ../src/recording/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
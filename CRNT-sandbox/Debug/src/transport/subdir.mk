@@ -0,0 +1,39 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../src/transport/BroadcastServer.cpp \
+../src/transport/ShmReader.cpp \
+../src/transport/ShmRing.cpp \
+../src/transport/ShmWriter.cpp \
+../src/transport/UdpReader.cpp \
+../src/transport/UdpWriter.cpp 
+
+OBJS += \
+./src/transport/BroadcastServer.o \
+./src/transport/ShmReader.o \
+./src/transport/ShmRing.o \
+./src/transport/ShmWriter.o \
+./src/transport/UdpReader.o \
+./src/transport/UdpWriter.o 
+
+CPP_DEPS += \
+./src/transport/BroadcastServer.d \
+./src/transport/ShmReader.d \
+./src/transport/ShmRing.d \
+./src/transport/ShmWriter.d \
+./src/transport/UdpReader.d \
+./src/transport/UdpWriter.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/transport/%.o: ../src/transport/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
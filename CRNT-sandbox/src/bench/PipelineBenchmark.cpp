@@ -0,0 +1,400 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// PipelineBenchmark.cpp - end-to-end throughput and latency benchmark
+//
+// Builds synthetic pipelines
+//
+//   source -> passthrough x chain -> sink x fanout
+//
+// for every combination of the given parameters and measures the
+// throughput and the source-to-sink latency (DataPacket::timestampNs).
+// Each run is printed as one JSON object per line, so results of two
+// builds can be compared with standard tools.
+//
+// This file has its own main() and is not part of the toolbox build,
+// build it with the Makefile in this directory (see src/sources.mk):
+//
+//   make -C src/bench
+//   make -C src/bench run ARGS="--chain 1,16 --scheduled 0,1"
+//
+// Usage: PipelineBenchmark [--chain 1,4,16] [--fanout 1,4] [--channels 1,16,128]
+//                          [--buffer 100,9999] [--lossless 0,1] [--scheduled 0,1]
+//                          [--values 0] [--packets 100000] [--rate 0]
+
+#include "../core/StreamTask.h"
+#include "../core/TaskScheduler.h"
+#include "../core/AsyncLog.h"
+#include "../core/Clock.h"
+#include "../core/DataPacket.h"
+#include "../core/FloatValue.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+/// Parameters of one benchmark run.
+struct BenchConfig {
+	unsigned int chain;			///< Number of passthrough tasks.
+	unsigned int fanout;		///< Number of sinks.
+	unsigned int channels;		///< Channels per packet.
+	unsigned int buffer;		///< inPortBufferSize of all tasks.
+	bool lossless;				///< inPortLossless of all tasks.
+	bool scheduled;				///< Run passthroughs on the TaskScheduler.
+	bool values;				///< Use Value channels instead of typed storage.
+	unsigned int packets;		///< Packets sent by the source.
+	unsigned int rate;			///< Packets per second (0 = as fast as possible).
+};
+
+
+static long long elapsedUs( unsigned long long fromNs, unsigned long long toNs )
+{
+	return ((long long)toNs - (long long)fromNs) / 1000;
+}
+
+
+/**
+ * Sends a fixed number of packets, stamped at the time of sending.
+ */
+class BenchSource : public StreamTask
+{
+	public:
+		BenchSource( const BenchConfig &c ) : StreamTask( 0, 1 ), config( c ), done( 0 )
+		{
+			setId( "source" );
+		}
+
+		void run()
+		{
+			unsigned long long start = Clock::nowNs();
+			for( unsigned int i = 0; i < config.packets && running; i++ ) {
+				if( config.rate ) {
+					//pace the source
+					long long due = (long long)i * 1000000 / config.rate;
+					long long ahead = due - elapsedUs( start, Clock::nowNs() );
+					if( ahead > 0 ) {
+						usleep( ahead );
+					}
+				}
+				DataPacket *p;
+				if( config.values ) {
+					p = new DataPacket( 0 );
+					for( unsigned int k = 0; k < config.channels; k++ ) {
+						p->dataVector.push_back( new FloatValue( k ) );
+					}
+				}
+				else {
+					p = new DataPacket( 0, config.channels, ChannelBuffer::FLOAT );
+				}
+				p->seqNr = i;
+				p->timestampNs = Clock::nowNs();
+				outPorts[0]->send( p );
+			}
+			__atomic_store_n( &done, 1, __ATOMIC_SEQ_CST );
+		}
+
+		bool finished() { return __atomic_load_n( &done, __ATOMIC_SEQ_CST ); }
+
+	private:
+		BenchConfig config;
+		int done;
+};
+
+
+/**
+ * Forwards packets, either in its own thread or on the TaskScheduler.
+ */
+class BenchPassthrough : public StreamTask
+{
+	public:
+		BenchPassthrough( bool sched ) : StreamTask( 1, 1 )
+		{
+			scheduled = sched;
+			setId( "passthrough" );
+		}
+
+		void run()
+		{
+			vector<DataPacket *> batch;
+			try {
+				while( running ) {
+					inPorts[0]->receiveBatch( batch, 64 );
+					outPorts[0]->sendBatch( batch );
+				}
+			}
+			catch( char const* msg ) {
+				//canceled by stop()
+			}
+		}
+
+	protected:
+		void process()
+		{
+			vector<DataPacket *> batch;
+			while( inPorts[0]->notEmpty() ) {
+				inPorts[0]->receiveBatch( batch, 64, 1 );
+				outPorts[0]->sendBatch( batch );
+			}
+		}
+};
+
+
+/**
+ * Records the latency of every packet.
+ */
+class BenchSink : public StreamTask
+{
+	public:
+		BenchSink( unsigned int expected ) : StreamTask( 1, 0 ), received( 0 )
+		{
+			setId( "sink" );
+			latencies.reserve( expected );
+		}
+
+		void run()
+		{
+			vector<DataPacket *> batch;
+			try {
+				while( running ) {
+					batch.clear();
+					inPorts[0]->receiveBatch( batch, 64 );
+					unsigned long long now = Clock::nowNs();
+					for( unsigned int i = 0; i < batch.size(); i++ ) {
+						latencies.push_back( elapsedUs( batch[i]->timestampNs, now ) );
+						delete batch[i];
+					}
+					last = now;
+					__atomic_add_fetch( &received, batch.size(), __ATOMIC_SEQ_CST );
+				}
+			}
+			catch( char const* msg ) {
+				//canceled by stop()
+			}
+		}
+
+		unsigned long getReceived() { return __atomic_load_n( &received, __ATOMIC_SEQ_CST ); }
+
+		vector<long long> latencies;	///< Read after stop() only.
+		unsigned long long last;		///< Time of the last packet.
+
+	private:
+		unsigned long received;
+};
+
+
+/// Percentile \p q (0..1) of the sorted vector \p v.
+static long long percentile( const vector<long long> &v, double q )
+{
+	if( v.empty() ) {
+		return 0;
+	}
+	size_t i = (size_t)(q * (v.size() - 1) + 0.5);
+	return v[i];
+}
+
+
+static void runBenchmark( const BenchConfig &c, ostream &out )
+{
+	BenchSource source( c );
+	vector<BenchPassthrough *> chain;
+	vector<BenchSink *> sinks;
+	vector<StreamTask *> tasks;
+
+	tasks.push_back( &source );
+	for( unsigned int i = 0; i < c.chain; i++ ) {
+		chain.push_back( new BenchPassthrough( c.scheduled ) );
+		tasks.push_back( chain.back() );
+	}
+	for( unsigned int i = 0; i < c.fanout; i++ ) {
+		sinks.push_back( new BenchSink( c.packets ) );
+		tasks.push_back( sinks.back() );
+	}
+
+	//connect: every task sends to the next one, the last one to all sinks
+	for( unsigned int i = 0; i < c.chain; i++ ) {
+		const_cast<vector<OutPort *>&>( tasks[i]->getOutPorts() )[0]->connect(
+				chain[i]->getInPorts()[0] );
+	}
+	OutPort *last = const_cast<vector<OutPort *>&>( tasks[c.chain]->getOutPorts() )[0];
+	for( unsigned int i = 0; i < c.fanout; i++ ) {
+		last->connect( sinks[i]->getInPorts()[0] );
+	}
+
+	for( unsigned int i = 1; i < tasks.size(); i++ ) {
+		const vector<InPort *> &in = tasks[i]->getInPorts();
+		for( unsigned int k = 0; k < in.size(); k++ ) {
+			in[k]->setMaxQueueSize( c.buffer );
+			in[k]->setLossless( c.lossless );
+			in[k]->setSilent( true );
+		}
+	}
+
+	//start downstream first, the source last
+	for( unsigned int i = tasks.size() - 1; i > 0; i-- ) {
+		tasks[i]->start();
+		//start() re-applies the task parameters to the ports
+		const vector<InPort *> &in = tasks[i]->getInPorts();
+		for( unsigned int k = 0; k < in.size(); k++ ) {
+			in[k]->setMaxQueueSize( c.buffer );
+			in[k]->setLossless( c.lossless );
+			in[k]->setSilent( true );
+		}
+	}
+	unsigned long long start = Clock::nowNs();
+	source.start();
+
+	//wait until all packets arrived or were dropped (no progress for 200ms)
+	unsigned long long lastCount = ~0ULL;
+	int idle = 0;
+	while( idle < 200 ) {
+		usleep( 1000 );
+		unsigned long long count = 0;
+		for( unsigned int i = 1; i < tasks.size(); i++ ) {
+			TaskStats s = tasks[i]->getStats();
+			for( unsigned int k = 0; k < s.inPorts.size(); k++ ) {
+				count += s.inPorts[k].received + s.inPorts[k].dropped;
+			}
+		}
+		idle = (source.finished() && count == lastCount) ? idle + 1 : 0;
+		lastCount = count;
+	}
+
+	source.stop();
+	for( unsigned int i = 1; i < tasks.size(); i++ ) {
+		tasks[i]->stop();
+	}
+
+	//collect results
+	vector<long long> lat;
+	unsigned long long received = 0, dropped = 0;
+	unsigned long long end = start;
+	for( unsigned int i = 0; i < sinks.size(); i++ ) {
+		received += sinks[i]->getReceived();
+		lat.insert( lat.end(), sinks[i]->latencies.begin(), sinks[i]->latencies.end() );
+		if( sinks[i]->getReceived() && elapsedUs( end, sinks[i]->last ) > 0 ) {
+			end = sinks[i]->last;
+		}
+	}
+	for( unsigned int i = 1; i < tasks.size(); i++ ) {
+		TaskStats s = tasks[i]->getStats();
+		for( unsigned int k = 0; k < s.inPorts.size(); k++ ) {
+			dropped += s.inPorts[k].dropped;
+		}
+	}
+	sort( lat.begin(), lat.end() );
+	double seconds = elapsedUs( start, end ) * 1e-6;
+
+	out << "{\"chain\":" << c.chain
+		<< ",\"fanout\":" << c.fanout
+		<< ",\"channels\":" << c.channels
+		<< ",\"buffer\":" << c.buffer
+		<< ",\"lossless\":" << (c.lossless ? "true" : "false")
+		<< ",\"scheduled\":" << (c.scheduled ? "true" : "false")
+		<< ",\"values\":" << (c.values ? "true" : "false")
+		<< ",\"sent\":" << c.packets
+		<< ",\"received\":" << received
+		<< ",\"dropped\":" << dropped
+		<< ",\"seconds\":" << seconds
+		<< ",\"packetsPerSec\":" << (seconds > 0 ? received / seconds : 0)
+		<< ",\"latencyUs\":{\"p50\":" << percentile( lat, 0.5 )
+		<< ",\"p99\":" << percentile( lat, 0.99 )
+		<< ",\"p999\":" << percentile( lat, 0.999 )
+		<< ",\"max\":" << (lat.empty() ? 0 : lat.back())
+		<< "}}" << endl;
+
+	for( unsigned int i = 0; i < chain.size(); i++ ) {
+		delete chain[i];
+	}
+	for( unsigned int i = 0; i < sinks.size(); i++ ) {
+		delete sinks[i];
+	}
+}
+
+
+/// Parse a comma separated list of numbers.
+static vector<unsigned int> parseList( const char *arg )
+{
+	vector<unsigned int> v;
+	stringstream s( arg );
+	string item;
+	while( getline( s, item, ',' ) ) {
+		v.push_back( strtoul( item.c_str(), NULL, 10 ) );
+	}
+	return v;
+}
+
+
+int main( int argc, char **argv )
+{
+	vector<unsigned int> chains, fanouts, channels, buffers, lossless, scheduled;
+	chains.push_back( 1 ); chains.push_back( 4 ); chains.push_back( 16 );
+	fanouts.push_back( 1 ); fanouts.push_back( 4 );
+	channels.push_back( 1 ); channels.push_back( 16 ); channels.push_back( 128 );
+	buffers.push_back( 100 ); buffers.push_back( 9999 );
+	lossless.push_back( 0 ); lossless.push_back( 1 );
+	scheduled.push_back( 0 );
+
+	BenchConfig c;
+	c.packets = 100000;
+	c.rate = 0;
+	c.values = false;
+
+	for( int i = 1; i + 1 < argc; i += 2 ) {
+		const char *opt = argv[i];
+		const char *arg = argv[i + 1];
+		if( !strcmp( opt, "--chain" ) ) chains = parseList( arg );
+		else if( !strcmp( opt, "--fanout" ) ) fanouts = parseList( arg );
+		else if( !strcmp( opt, "--channels" ) ) channels = parseList( arg );
+		else if( !strcmp( opt, "--buffer" ) ) buffers = parseList( arg );
+		else if( !strcmp( opt, "--lossless" ) ) lossless = parseList( arg );
+		else if( !strcmp( opt, "--scheduled" ) ) scheduled = parseList( arg );
+		else if( !strcmp( opt, "--values" ) ) c.values = atoi( arg ) != 0;
+		else if( !strcmp( opt, "--packets" ) ) c.packets = strtoul( arg, NULL, 10 );
+		else if( !strcmp( opt, "--rate" ) ) c.rate = strtoul( arg, NULL, 10 );
+		else {
+			cerr << "unknown option " << opt << endl;
+			return 1;
+		}
+	}
+
+	//keep the task log out of the results: at most one message per second
+	//and thread, the in-ports are silent already
+	AsyncLog::setRateLimit( 1 );
+
+	for( unsigned int a = 0; a < chains.size(); a++ )
+	for( unsigned int b = 0; b < fanouts.size(); b++ )
+	for( unsigned int d = 0; d < channels.size(); d++ )
+	for( unsigned int e = 0; e < buffers.size(); e++ )
+	for( unsigned int f = 0; f < lossless.size(); f++ )
+	for( unsigned int g = 0; g < scheduled.size(); g++ ) {
+		c.chain = chains[a];
+		c.fanout = fanouts[b] ? fanouts[b] : 1;
+		c.channels = channels[d];
+		c.buffer = buffers[e];
+		c.lossless = lossless[f] != 0;
+		c.scheduled = scheduled[g] != 0;
+		runBenchmark( c, cout );
+	}
+	return 0;
+}
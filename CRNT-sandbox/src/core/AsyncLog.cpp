@@ -0,0 +1,440 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// AsyncLog.cpp
+
+#include "AsyncLog.h"
+#include "Mutex.h"
+#include "Thread.h"
+#include "Clock.h"
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+using namespace std;
+
+
+static const unsigned int MAX_LINE = 1024;		///< Longest record text.
+static const unsigned int FLUSH_INTERVAL = 5000;	///< Flusher sleep time [us].
+
+/// Record in a thread ring, followed by the text (padded to 16 bytes).
+struct RecordHeader {
+	uint32_t len;		///< Total length including header and padding.
+	uint32_t flags;
+	int64_t sec;		///< Time stamp of message records.
+};
+
+enum {
+	RECORD_MESSAGE = 1,	///< First line of a log message (gets a time stamp).
+	RECORD_WRAP = 2		///< Unused space at the end of the ring.
+};
+
+// plain pthread objects, log() may be called during static initialization
+static pthread_key_t logKey;
+static pthread_once_t logOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t flushMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flushCondition = PTHREAD_COND_INITIALIZER;
+static int flushRequested = 0;
+
+static int synchronous = 0;
+static unsigned int rateLimit = AsyncLog::DEFAULT_RATE_LIMIT;
+static unsigned int ringSize = AsyncLog::DEFAULT_RING_SIZE;
+static unsigned long long lostMessages = 0;
+
+AsyncLog::ThreadLog *AsyncLog::threads = NULL;
+AsyncLog::Flusher *AsyncLog::flusher = NULL;
+
+
+/// Stream buffer for the continuation text of a message.
+class AsyncLog::LogBuf : public streambuf
+{
+	public:
+		LogBuf( ThreadLog *t ) : discard( false ), tl( t ) { setp( buffer, buffer + MAX_LINE ); }
+		void commit();
+		bool discard;	///< Drop the text (message was suppressed).
+
+	protected:
+		int overflow( int c );
+		int sync() { commit(); return 0; }
+
+	private:
+		ThreadLog *tl;
+		char buffer[MAX_LINE];
+};
+
+
+/// Ring buffer and state of one thread.
+struct AsyncLog::ThreadLog
+{
+	ThreadLog( unsigned int size );
+	~ThreadLog() { delete[] ring; }
+	bool push( uint32_t flags, int64_t sec, const char *text, unsigned int n );
+
+	char *ring;
+	unsigned long mask;
+	unsigned long head;		///< Read position (flusher).
+	char pad[64];
+	unsigned long tail;		///< Write position (owner thread).
+	LogBuf buf;
+	ostream stream;
+	double tokens;			///< Rate limit bucket.
+	unsigned long long lastNs;	///< Monotonic time of the last refill.
+	unsigned long suppressed;	///< Written by the owner thread (relaxed atomic).
+	unsigned long dropped;		///< Written by the owner thread (relaxed atomic).
+	unsigned long suppressedReported;	///< Flusher only.
+	unsigned long droppedReported;		///< Flusher only.
+	int dead;				///< Thread has exited.
+	ThreadLog *next;
+};
+
+
+/// Background thread writing the rings.
+class AsyncLog::Flusher : public Thread
+{
+	public:
+		void run();
+		string identify() { return "AsyncLog::Flusher"; }
+};
+
+
+AsyncLog::ThreadLog::ThreadLog( unsigned int size ) :
+	head(0), tail(0), buf(this), stream(&buf), tokens(rateLimit), lastNs(0),
+	suppressed(0), dropped(0), suppressedReported(0), droppedReported(0), dead(0), next(NULL)
+{
+	unsigned long n = 4096;
+	while( n < size ) {
+		n *= 2;
+	}
+	ring = new char[n];
+	mask = n - 1;
+}
+
+
+/**
+ * Copies a record to the ring. Never blocks.
+ * @return false if the ring is full.
+ */
+bool AsyncLog::ThreadLog::push( uint32_t flags, int64_t sec, const char *text, unsigned int n )
+{
+	unsigned long size = mask + 1;
+	unsigned int need = (sizeof( RecordHeader ) + n + 15) & ~15u;
+	unsigned long t = tail;
+	unsigned long h = __atomic_load_n( &head, __ATOMIC_ACQUIRE );
+	unsigned long toEnd = size - (t & mask);
+	unsigned long total = need <= toEnd ? need : toEnd + need;
+
+	if( t + total - h > size ) {
+		__atomic_store_n( &dropped, dropped + 1, __ATOMIC_RELAXED );
+		__sync_add_and_fetch( &lostMessages, 1 );
+		return false;
+	}
+
+	if( need > toEnd ) {
+		RecordHeader *wrap = reinterpret_cast<RecordHeader *>( ring + (t & mask) );
+		wrap->len = toEnd;
+		wrap->flags = RECORD_WRAP;
+		t += toEnd;
+	}
+	RecordHeader *r = reinterpret_cast<RecordHeader *>( ring + (t & mask) );
+	r->len = need;
+	r->flags = flags;
+	r->sec = sec;
+	memcpy( r + 1, text, n );
+	if( n < need - sizeof( RecordHeader ) ) {
+		reinterpret_cast<char *>( r + 1 )[n] = 0;
+	}
+	__atomic_store_n( &tail, t + need, __ATOMIC_RELEASE );
+
+	//wake up the flusher early if the ring fills up
+	if( t + need - h > size / 2 && !__atomic_exchange_n( &flushRequested, 1, __ATOMIC_SEQ_CST ) ) {
+		pthread_mutex_lock( &flushMutex );
+		pthread_cond_signal( &flushCondition );
+		pthread_mutex_unlock( &flushMutex );
+	}
+	return true;
+}
+
+
+void AsyncLog::LogBuf::commit()
+{
+	unsigned int n = pptr() - pbase();
+	if( n && !discard ) {
+		tl->push( 0, 0, pbase(), n );
+	}
+	setp( buffer, buffer + MAX_LINE );
+}
+
+
+int AsyncLog::LogBuf::overflow( int c )
+{
+	commit();
+	if( c != EOF ) {
+		*pptr() = c;
+		pbump( 1 );
+		return c;
+	}
+	return 0;
+}
+
+
+void AsyncLog::Flusher::run()
+{
+	while( !exiting() ) {
+		string out;
+		if( drain( out ) ) {
+			output( out );
+			continue;
+		}
+
+		struct timespec ts;
+		Clock::toTimespec( Clock::nowNs() + FLUSH_INTERVAL * 1000ULL, &ts );
+		pthread_mutex_lock( &flushMutex );
+		if( !__atomic_load_n( &flushRequested, __ATOMIC_SEQ_CST ) ) {
+			pthread_cond_timedwait( &flushCondition, &flushMutex, &ts );
+		}
+		__atomic_store_n( &flushRequested, 0, __ATOMIC_SEQ_CST );
+		pthread_mutex_unlock( &flushMutex );
+	}
+}
+
+
+void AsyncLog::init()
+{
+	pthread_key_create( &logKey, AsyncLog::destroyThreadLog );
+
+	//the flusher waits on the monotonic clock (see Clock)
+	pthread_condattr_t attr;
+	pthread_condattr_init( &attr );
+	pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+	pthread_cond_init( &flushCondition, &attr );
+	pthread_condattr_destroy( &attr );
+
+	atexit( AsyncLog::atExit );
+	flusher = new Flusher();
+	flusher->init();
+}
+
+
+AsyncLog::ThreadLog *AsyncLog::getThreadLog()
+{
+	pthread_once( &logOnce, AsyncLog::init );
+	ThreadLog *tl = static_cast<ThreadLog *>( pthread_getspecific( logKey ) );
+	if( tl ) {
+		return tl;
+	}
+
+	tl = new ThreadLog( __atomic_load_n( &ringSize, __ATOMIC_RELAXED ) );
+	pthread_mutex_lock( &registryMutex );
+	tl->next = threads;
+	threads = tl;
+	pthread_mutex_unlock( &registryMutex );
+	pthread_setspecific( logKey, tl );
+	return tl;
+}
+
+
+/**
+ * Called on thread exit (pthread key destructor). The ring is freed by
+ * the flusher once it is empty.
+ */
+void AsyncLog::destroyThreadLog( void *p )
+{
+	ThreadLog *tl = static_cast<ThreadLog *>( p );
+	tl->buf.commit();
+	__atomic_store_n( &tl->dead, 1, __ATOMIC_RELEASE );
+}
+
+
+void AsyncLog::atExit()
+{
+	if( flusher ) {
+		flusher->exitNow();
+		flusher->joinMe();
+	}
+	flush();
+	__atomic_store_n( &synchronous, 1, __ATOMIC_SEQ_CST );
+}
+
+
+ostream& AsyncLog::write( const char *id, const char *type, const void *obj, const char *msg )
+{
+	if( __atomic_load_n( &synchronous, __ATOMIC_RELAXED ) ) {
+		time_t rawtime;
+		time( &rawtime );
+		struct tm timeinfo;
+		char timestring[20];
+		localtime_r( &rawtime, &timeinfo );
+		strftime( timestring, 20, "%b %d %X", &timeinfo );
+
+		//sync log messages (at least the first line)
+		Mutex::GLOBAL_MUTEX.lock();
+			clog << timestring << " [" << id << "] ::: "
+				 << type << " @ " << obj << ": " << msg << endl;
+		Mutex::GLOBAL_MUTEX.unlock();
+		return clog;
+	}
+
+	ThreadLog *tl = getThreadLog();
+	tl->buf.commit();	//rest of the previous message
+
+	//monotonic: a step of the system time must not empty or refill the bucket
+	unsigned long long now = Clock::nowNs();
+
+	unsigned int limit = __atomic_load_n( &rateLimit, __ATOMIC_RELAXED );
+	if( limit ) {
+		tl->tokens += (now - tl->lastNs) * 1e-9 * limit;
+		if( tl->tokens > limit ) {
+			tl->tokens = limit;
+		}
+		tl->lastNs = now;
+		if( tl->tokens < 1.0 ) {
+			__atomic_store_n( &tl->suppressed, tl->suppressed + 1, __ATOMIC_RELAXED );
+			__sync_add_and_fetch( &lostMessages, 1 );
+			tl->buf.discard = true;
+			return tl->stream;
+		}
+		tl->tokens -= 1.0;
+	}
+
+	struct timeval tv;
+	Clock::toTimeval( now, &tv );
+
+	char line[MAX_LINE];
+	int n = snprintf( line, MAX_LINE, "[%s] ::: %s @ %p: %s\n", id, type, obj, msg );
+	if( n >= (int)MAX_LINE ) {
+		n = MAX_LINE - 1;
+		line[n - 1] = '\n';
+	}
+	tl->buf.discard = !tl->push( RECORD_MESSAGE, tv.tv_sec, line, n );
+	return tl->stream;
+}
+
+
+/**
+ * Takes the pending records of all threads and formats them.
+ * @return true if there was anything to write.
+ */
+bool AsyncLog::drain( string &out )
+{
+	pthread_mutex_lock( &registryMutex );
+	ThreadLog **link = &threads;
+	while( *link ) {
+		ThreadLog *tl = *link;
+		bool dead = __atomic_load_n( &tl->dead, __ATOMIC_ACQUIRE );
+		unsigned long h = tl->head;
+		unsigned long t = __atomic_load_n( &tl->tail, __ATOMIC_ACQUIRE );
+
+		while( h < t ) {
+			RecordHeader *r = reinterpret_cast<RecordHeader *>( tl->ring + (h & tl->mask) );
+			if( r->flags & RECORD_MESSAGE ) {
+				time_t sec = r->sec;
+				struct tm timeinfo;
+				char timestring[20];
+				localtime_r( &sec, &timeinfo );
+				strftime( timestring, 20, "%b %d %X", &timeinfo );
+				out += timestring;
+				out += ' ';
+			}
+			if( !(r->flags & RECORD_WRAP) ) {
+				const char *text = reinterpret_cast<const char *>( r + 1 );
+				out.append( text, strnlen( text, r->len - sizeof( RecordHeader ) ) );
+			}
+			h += r->len;
+		}
+		__atomic_store_n( &tl->head, h, __ATOMIC_RELEASE );
+		reportLost( tl, out );
+
+		if( dead ) {
+			*link = tl->next;
+			delete tl;
+		}
+		else {
+			link = &tl->next;
+		}
+	}
+	pthread_mutex_unlock( &registryMutex );
+	return !out.empty();
+}
+
+
+/// Append a note about messages of \p tl suppressed or dropped since the last one.
+void AsyncLog::reportLost( ThreadLog *tl, string &out )
+{
+	unsigned long s = __atomic_load_n( &tl->suppressed, __ATOMIC_RELAXED );
+	unsigned long d = __atomic_load_n( &tl->dropped, __ATOMIC_RELAXED );
+	if( s == tl->suppressedReported && d == tl->droppedReported ) {
+		return;
+	}
+	time_t sec = time( NULL );
+	struct tm timeinfo;
+	char line[128];
+	localtime_r( &sec, &timeinfo );
+	size_t n = strftime( line, sizeof( line ), "%b %d %X", &timeinfo );
+	snprintf( line + n, sizeof( line ) - n, " [] ::: AsyncLog: %lu messages suppressed, %lu dropped\n",
+			s - tl->suppressedReported, d - tl->droppedReported );
+	out += line;
+	tl->suppressedReported = s;
+	tl->droppedReported = d;
+}
+
+
+void AsyncLog::output( const string &out )
+{
+	Mutex::GLOBAL_MUTEX.lock();
+	clog << out;
+	clog.flush();
+	Mutex::GLOBAL_MUTEX.unlock();
+}
+
+
+void AsyncLog::flush()
+{
+	string out;
+	if( drain( out ) ) {
+		output( out );
+	}
+}
+
+
+void AsyncLog::setSynchronous( bool flag )
+{
+	if( flag ) {
+		flush();
+	}
+	__atomic_store_n( &synchronous, flag ? 1 : 0, __ATOMIC_SEQ_CST );
+}
+
+
+void AsyncLog::setRateLimit( unsigned int perSecond )
+{
+	__atomic_store_n( &rateLimit, perSecond, __ATOMIC_RELAXED );
+}
+
+
+void AsyncLog::setRingSize( unsigned int bytes )
+{
+	__atomic_store_n( &ringSize, bytes, __ATOMIC_RELAXED );
+}
+
+
+unsigned long long AsyncLog::getLostMessages()
+{
+	return __sync_add_and_fetch( &lostMessages, 0 );
+}
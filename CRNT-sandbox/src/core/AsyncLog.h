@@ -0,0 +1,106 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// AsyncLog.h - asynchronous backend of TBObject::log()
+
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include <iostream>
+#include <string>
+
+
+/**
+ * \ingroup core
+ * \brief Asynchronous, low-contention log backend.
+ *
+ * TBObject::log() does not write to std::clog directly. Every thread owns
+ * a ring buffer the messages are copied to without taking any lock; a
+ * background thread formats the time stamps and writes the rings to
+ * std::clog.
+ *
+ * log() returns a per-thread stream, so the usual style
+ * \code
+ * log( "message" ) << "\tdetails: " << x << endl;
+ * \endcode
+ * still works. Text written to that stream is committed at every
+ * \c endl or \c flush (and at the next log() call of the thread).
+ *
+ * Each thread may write up to the rate limit messages per second; further
+ * messages (and their continuation text) are suppressed and counted. If a
+ * ring is full the message is dropped instead of blocking the caller.
+ * The limit is measured on the monotonic clock. Both counts are reported
+ * by the background thread at its next flush, also if the thread logs
+ * nothing more.
+ *
+ * Pending messages are written at program exit. Call
+ * setSynchronous( true ) to get the old blocking behaviour, e.g. when
+ * debugging a crash.
+ */
+class AsyncLog
+{
+	public:
+		static const unsigned int DEFAULT_RING_SIZE = 65536;	///< Bytes per thread.
+		static const unsigned int DEFAULT_RATE_LIMIT = 1000;		///< Messages per second and thread.
+
+		/**
+		 * \brief Start a log message.
+		 *
+		 * Called by TBObject::log().
+		 * \param id Id of the logging object.
+		 * \param type Type name of the logging object.
+		 * \param obj Address of the logging object.
+		 * \param msg The message.
+		 * \return Stream for additional text.
+		 */
+		static std::ostream& write( const char *id, const char *type, const void *obj, const char *msg );
+
+		/// Write all pending messages now.
+		static void flush();
+
+		/// Write messages synchronously (with a global lock) if \p flag is set.
+		static void setSynchronous( bool flag );
+
+		/**
+		 * \brief Set the maximal number of messages per second and thread.
+		 * \param perSecond The limit, zero disables rate limiting.
+		 */
+		static void setRateLimit( unsigned int perSecond );
+
+		/// Set the ring size in bytes for threads that did not log yet.
+		static void setRingSize( unsigned int bytes );
+
+		/// Number of messages that were suppressed or dropped so far.
+		static unsigned long long getLostMessages();
+
+	private:
+		struct ThreadLog;
+		class LogBuf;
+		class Flusher;
+
+		static ThreadLog *getThreadLog();
+		static void init();
+		static void destroyThreadLog( void *tl );
+		static void atExit();
+		static bool drain( std::string &out );
+		static void output( const std::string &out );
+		static void reportLost( ThreadLog *tl, std::string &out );
+
+		static ThreadLog *threads;	///< Registry of all thread rings.
+		static Flusher *flusher;
+};
+
+
+#endif	//ASYNCLOG_H
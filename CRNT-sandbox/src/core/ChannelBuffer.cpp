@@ -0,0 +1,466 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelBuffer.cpp
+
+#include "ChannelBuffer.h"
+#include "PacketPool.h"
+#include <string.h>
+#include <iostream>
+
+using namespace std;
+
+
+unsigned long long ChannelBuffer::sharedCopies = 0;
+unsigned long long ChannelBuffer::detachedCopies = 0;
+
+
+size_t ChannelBuffer::blockBytes( unsigned int capacity )
+{
+	unsigned int words = (capacity + 31) / 32;
+	return sizeof( Block ) + capacity * sizeof( Slot ) + 2 * words * sizeof( uint32 );
+}
+
+
+/// Capacity of the block that is allocated for \p n channels.
+unsigned int ChannelBuffer::blockCapacity( unsigned int n )
+{
+	unsigned int capacity = 8;
+	while( capacity < n ) {
+		capacity *= 2;
+	}
+	return capacity;
+}
+
+
+void ChannelBuffer::reservePool( unsigned int buffers, unsigned int channels )
+{
+	if( channels ) {
+		PacketPool::reserve( blockBytes( blockCapacity( channels ) ), buffers );
+	}
+}
+
+
+ChannelBuffer::Block *ChannelBuffer::allocBlock( unsigned int capacity )
+{
+	Block *b = static_cast<Block *>( PacketPool::allocate( blockBytes( capacity ) ) );
+	b->refs = 1;
+	b->size = 0;
+	b->capacity = capacity;
+	return b;
+}
+
+
+void ChannelBuffer::freeBlock( Block *b )
+{
+	if( b ) {
+		PacketPool::release( b, blockBytes( b->capacity ) );
+	}
+}
+
+
+/// Drop one reference, the last one frees the block.
+void ChannelBuffer::releaseBlock( Block *b )
+{
+	if( b && __sync_sub_and_fetch( &b->refs, 1 ) == 0 ) {
+		freeBlock( b );
+	}
+}
+
+
+ChannelBuffer::ChannelBuffer() : block(NULL)
+{
+}
+
+
+ChannelBuffer::ChannelBuffer( const ChannelBuffer &b ) : block(NULL)
+{
+	*this = b;
+}
+
+
+/**
+ * The storage of \p b is shared, not copied.
+ */
+ChannelBuffer& ChannelBuffer::operator=( const ChannelBuffer &b )
+{
+	if( block == b.block ) {
+		return *this;
+	}
+	releaseBlock( block );
+	block = NULL;
+	if( !b.empty() ) {
+		__sync_add_and_fetch( &b.block->refs, 1 );
+		__sync_add_and_fetch( &sharedCopies, 1 );
+		block = b.block;
+	}
+	return *this;
+}
+
+
+ChannelBuffer::~ChannelBuffer()
+{
+	releaseBlock( block );
+}
+
+
+/**
+ * Replaces the shared block by a private copy.
+ */
+void ChannelBuffer::unshare()
+{
+	Block *shared = block;
+	unsigned int words = (shared->capacity + 31) / 32;
+	block = allocBlock( shared->capacity );
+	block->size = shared->size;
+	memcpy( slots(), shared + 1, shared->size * sizeof( Slot ) );
+	memcpy( typeBits(), reinterpret_cast<Slot *>( shared + 1 ) + shared->capacity,
+			2 * words * sizeof( uint32 ) );
+	releaseBlock( shared );
+	__sync_add_and_fetch( &detachedCopies, 1 );
+}
+
+
+bool ChannelBuffer::isShared() const
+{
+	return block && __atomic_load_n( &block->refs, __ATOMIC_ACQUIRE ) > 1;
+}
+
+
+unsigned long long ChannelBuffer::getClonesAvoided()
+{
+	return sharedCopies - detachedCopies;
+}
+
+
+/**
+ * Makes room for at least \p n channels. Existing channels are moved
+ * to the new block.
+ */
+void ChannelBuffer::grow( unsigned int n )
+{
+	if( block && n <= block->capacity ) {
+		detach();
+		return;
+	}
+	unsigned int capacity = blockCapacity( n );
+
+	Block *nb = allocBlock( capacity );
+	unsigned int words = (capacity + 31) / 32;
+	uint32 *nbits = reinterpret_cast<uint32 *>( reinterpret_cast<Slot *>( nb + 1 ) + capacity );
+	memset( nbits, 0, 2 * words * sizeof( uint32 ) );
+
+	if( block ) {
+		unsigned int oldWords = (block->capacity + 31) / 32;
+		memcpy( nb + 1, slots(), block->size * sizeof( Slot ) );
+		memcpy( nbits, typeBits(), oldWords * sizeof( uint32 ) );
+		memcpy( nbits + words, validBits(), oldWords * sizeof( uint32 ) );
+		nb->size = block->size;
+		if( __atomic_load_n( &block->refs, __ATOMIC_ACQUIRE ) > 1 ) {
+			__sync_add_and_fetch( &detachedCopies, 1 );
+		}
+		releaseBlock( block );
+	}
+	block = nb;
+}
+
+
+void ChannelBuffer::reserve( unsigned int n )
+{
+	grow( n );
+}
+
+
+void ChannelBuffer::resize( unsigned int n, Type type )
+{
+	if( n <= size() ) {
+		if( block && n < block->size ) {
+			detach();
+			block->size = n;
+		}
+		return;
+	}
+	grow( n );
+	for( unsigned int i = block->size; i < n; i++ ) {
+		slots()[i].i = 0;
+		setBit( typeBits(), i, type == INT );
+		setBit( validBits(), i, true );
+	}
+	block->size = n;
+}
+
+
+void ChannelBuffer::clear()
+{
+	if( isShared() ) {
+		releaseBlock( block );
+		block = NULL;
+	}
+	else if( block ) {
+		block->size = 0;
+	}
+}
+
+
+void ChannelBuffer::appendFloat( float f, bool valid )
+{
+	unsigned int i = size();
+	grow( i + 1 );
+	slots()[i].f = f;
+	setBit( typeBits(), i, false );
+	setBit( validBits(), i, valid );
+	block->size = i + 1;
+}
+
+
+void ChannelBuffer::appendInt( int32 k, bool valid )
+{
+	unsigned int i = size();
+	grow( i + 1 );
+	slots()[i].i = k;
+	setBit( typeBits(), i, true );
+	setBit( validBits(), i, valid );
+	block->size = i + 1;
+}
+
+
+void ChannelBuffer::append( const ChannelBuffer &b )
+{
+	unsigned int n = b.size();
+	if( n == 0 ) {
+		return;
+	}
+	unsigned int base = size();
+	grow( base + n );
+	memcpy( slots() + base, b.slots(), n * sizeof( Slot ) );
+	for( unsigned int i = 0; i < n; i++ ) {
+		setBit( typeBits(), base + i, b.getBit( b.typeBits(), i ) );
+		setBit( validBits(), base + i, b.getBit( b.validBits(), i ) );
+	}
+	block->size = base + n;
+}
+
+
+void ChannelBuffer::select( const vector<unsigned> &channels )
+{
+	ChannelBuffer keep;
+	keep.reserve( channels.size() );
+	for( unsigned int k = 0; k < channels.size(); k++ ) {
+		unsigned int i = channels[k];
+		if( getType( i ) == INT ) {
+			keep.appendInt( slots()[i].i, isValid( i ) );
+		}
+		else {
+			keep.appendFloat( slots()[i].f, isValid( i ) );
+		}
+	}
+	Block *tmp = block;
+	block = keep.block;
+	keep.block = tmp;
+}
+
+
+ChannelBuffer::Type ChannelBuffer::getType( unsigned int i ) const
+{
+	return getBit( typeBits(), i ) ? INT : FLOAT;
+}
+
+
+void ChannelBuffer::setType( unsigned int i, Type type )
+{
+	if( getType( i ) == type ) {
+		return;
+	}
+	detach();
+	if( type == INT ) {
+		slots()[i].i = (int)slots()[i].f;
+	}
+	else {
+		slots()[i].f = (float)slots()[i].i;
+	}
+	setBit( typeBits(), i, type == INT );
+}
+
+
+bool ChannelBuffer::isHomogeneous( Type type ) const
+{
+	unsigned int n = size();
+	if( n == 0 ) {
+		return true;
+	}
+	const uint32 *bits = typeBits();
+	uint32 expect = (type == INT) ? 0xffffffffu : 0;
+	for( unsigned int w = 0; w < n / 32; w++ ) {
+		if( bits[w] != expect ) {
+			return false;
+		}
+	}
+	if( n % 32 ) {
+		uint32 mask = (1u << (n % 32)) - 1;
+		if( (bits[n / 32] & mask) != (expect & mask) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+float ChannelBuffer::getFloat( unsigned int i ) const
+{
+	return getBit( typeBits(), i ) ? (float)slots()[i].i : slots()[i].f;
+}
+
+
+int32 ChannelBuffer::getInt( unsigned int i ) const
+{
+	return getBit( typeBits(), i ) ? slots()[i].i : (int)slots()[i].f;
+}
+
+
+void ChannelBuffer::setFloat( unsigned int i, float f )
+{
+	detach();
+	if( getBit( typeBits(), i ) ) {
+		slots()[i].i = (int)f;
+	}
+	else {
+		slots()[i].f = f;
+	}
+}
+
+
+void ChannelBuffer::setInt( unsigned int i, int32 k )
+{
+	detach();
+	if( getBit( typeBits(), i ) ) {
+		slots()[i].i = k;
+	}
+	else {
+		slots()[i].f = (float)k;
+	}
+}
+
+
+bool ChannelBuffer::isValid( unsigned int i ) const
+{
+	return getBit( validBits(), i );
+}
+
+
+void ChannelBuffer::setValid( unsigned int i, bool valid )
+{
+	detach();
+	setBit( validBits(), i, valid );
+}
+
+
+void ChannelBuffer::invalidateAll()
+{
+	if( block ) {
+		detach();
+		memset( validBits(), 0, ((block->capacity + 31) / 32) * sizeof( uint32 ) );
+	}
+}
+
+
+float *ChannelBuffer::floatData()
+{
+	detach();
+	return block && block->size ? &slots()->f : NULL;
+}
+
+
+const float *ChannelBuffer::floatData() const
+{
+	return block && block->size ? &slots()->f : NULL;
+}
+
+
+int32 *ChannelBuffer::intData()
+{
+	detach();
+	return block && block->size ? &slots()->i : NULL;
+}
+
+
+const int32 *ChannelBuffer::intData() const
+{
+	return block && block->size ? &slots()->i : NULL;
+}
+
+
+void ChannelBuffer::getRaw( void *slotsOut, uint32 *typeOut, uint32 *validOut ) const
+{
+	unsigned int n = size();
+	if( n == 0 ) {
+		return;
+	}
+	unsigned int words = (n + 31) / 32;
+	memcpy( slotsOut, slots(), n * sizeof( Slot ) );
+	memcpy( typeOut, typeBits(), words * sizeof( uint32 ) );
+	memcpy( validOut, validBits(), words * sizeof( uint32 ) );
+	if( n % 32 ) {
+		//bits of channels beyond size() are undefined
+		uint32 mask = (1u << (n % 32)) - 1;
+		typeOut[words - 1] &= mask;
+		validOut[words - 1] &= mask;
+	}
+}
+
+
+void ChannelBuffer::setRaw( unsigned int n, const void *slotsIn, const void *typeIn, const void *validIn )
+{
+	if( n == 0 ) {
+		clear();
+		return;
+	}
+	if( isShared() ) {
+		releaseBlock( block );
+		block = NULL;
+	}
+	if( !block || block->capacity < n ) {
+		freeBlock( block );
+		block = allocBlock( blockCapacity( n ) );
+	}
+	unsigned int words = (n + 31) / 32;
+	block->size = n;
+	memcpy( slots(), slotsIn, n * sizeof( Slot ) );
+	memcpy( typeBits(), typeIn, words * sizeof( uint32 ) );
+	memcpy( validBits(), validIn, words * sizeof( uint32 ) );
+}
+
+
+void ChannelBuffer::setBit( uint32 *bits, unsigned int i, bool flag )
+{
+	if( flag ) {
+		bits[i >> 5] |= (1u << (i & 31));
+	}
+	else {
+		bits[i >> 5] &= ~(1u << (i & 31));
+	}
+}
+
+
+void ChannelBuffer::toString( ostream &o ) const
+{
+	for( unsigned int i = 0; i < size(); i++ ) {
+		if( getType( i ) == INT ) {
+			o << slots()[i].i << " ";
+		}
+		else {
+			o << scientific << slots()[i].f << " ";
+		}
+	}
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelBuffer.h - contiguous typed channel storage
+
+#ifndef CHANNELBUFFER_H
+#define CHANNELBUFFER_H
+
+#include "Value.h"
+#include <vector>
+
+
+/**
+ * \ingroup core
+ * \brief Contiguous storage for the channels of a data packet.
+ *
+ * All channels are stored in one block of 32 bit slots, each holding
+ * either a float or an int32. The type and the valid flag of each channel
+ * are kept in bitmaps next to the slots. The block is allocated from the
+ * PacketPool.
+ *
+ * Conversions between the channel types follow the semantics of
+ * FloatValue and IntValue (e.g. getInt() of a float channel truncates).
+ *
+ * If all channels have the same type, floatData() and intData() give
+ * direct access to the slots as a plain C array.
+ *
+ * Copies share the storage block (copy-on-write). The block is reference
+ * counted and a private copy is made only when a buffer that shares its
+ * block is modified. This makes cloning a typed DataPacket, e.g. for
+ * every receiver in OutPort::send(), independent of the channel count.
+ * Use the const accessors for reading to avoid unnecessary copies.
+ */
+class ChannelBuffer
+{
+	public:
+		/// Channel types.
+		enum Type {
+			FLOAT = 0,	///< float channel (like FloatValue)
+			INT = 1		///< int32 channel (like IntValue)
+		};
+
+		ChannelBuffer();
+		ChannelBuffer( const ChannelBuffer &b );
+		ChannelBuffer& operator=( const ChannelBuffer &b );
+		~ChannelBuffer();
+
+		/// Get the number of channels.
+		unsigned int size() const { return block ? block->size : 0; }
+
+		/// Check if there are no channels.
+		bool empty() const { return size() == 0; }
+
+		/**
+		 * \brief Set the number of channels.
+		 *
+		 * Added channels are valid, zero and of type \p type.
+		 */
+		void resize( unsigned int n, Type type = FLOAT );
+
+		/// Reserve space for \p n channels.
+		void reserve( unsigned int n );
+
+		/// Delete all channels.
+		void clear();
+
+		/// Append a float channel.
+		void appendFloat( float f, bool valid = true );
+
+		/// Append an int channel.
+		void appendInt( int32 k, bool valid = true );
+
+		/// Append all channels of \p b.
+		void append( const ChannelBuffer &b );
+
+		/// Only keep the channels listed in \p channels (in this order).
+		void select( const std::vector<unsigned> &channels );
+
+		/// Get the type of channel \p i.
+		Type getType( unsigned int i ) const;
+
+		/// Change the type of channel \p i, converting its value.
+		void setType( unsigned int i, Type type );
+
+		/// Check if all channels are of type \p type.
+		bool isHomogeneous( Type type ) const;
+
+		float getFloat( unsigned int i ) const;	///< Read channel \p i as float.
+		int32 getInt( unsigned int i ) const;	///< Read channel \p i as int.
+		void setFloat( unsigned int i, float f );	///< Write channel \p i (keeps its type).
+		void setInt( unsigned int i, int32 k );	///< Write channel \p i (keeps its type).
+
+		bool isValid( unsigned int i ) const;	///< Check if channel \p i is valid.
+		void setValid( unsigned int i, bool valid );	///< Set the valid state of channel \p i.
+		void invalidateAll();					///< Set all channels invalid.
+
+		/**
+		 * \brief Direct access to the slots as floats.
+		 * \note Only meaningful for channels of type FLOAT.
+		 * \note The non-const version makes the storage private.
+		 * \return Pointer to the first slot or NULL if empty.
+		 */
+		float *floatData();
+		const float *floatData() const;
+
+		/**
+		 * \brief Direct access to the slots as ints.
+		 * \note Only meaningful for channels of type INT.
+		 * \return Pointer to the first slot or NULL if empty.
+		 */
+		int32 *intData();
+		const int32 *intData() const;
+
+		/**
+		 * \brief Copy the raw storage out (e.g. for serialization).
+		 *
+		 * \param slots Receives size() 32 bit slots (float or int32).
+		 * \param typeBits Receives (size() + 31) / 32 words, bit i set for INT channels.
+		 * \param validBits Receives (size() + 31) / 32 words, bit i set for valid channels.
+		 */
+		void getRaw( void *slots, uint32 *typeBits, uint32 *validBits ) const;
+
+		/**
+		 * \brief Replace all channels by raw storage (see getRaw()).
+		 *
+		 * The buffers need not be aligned, e.g. they may point into a
+		 * receive buffer.
+		 */
+		void setRaw( unsigned int n, const void *slots, const void *typeBits, const void *validBits );
+
+		/// Print the channels to stream o.
+		void toString( std::ostream &o ) const;
+
+		/// Check if the storage is shared with other buffers.
+		bool isShared() const;
+
+		/**
+		 * \brief Number of copies that did not need their own storage.
+		 *
+		 * Counts copies that shared a block minus the private copies that
+		 * were made later because a sharing buffer was modified.
+		 */
+		static unsigned long long getClonesAvoided();
+
+		/**
+		 * \brief Preallocate pool memory for \p buffers buffers of
+		 * \p channels channels each.
+		 * \see DataPacket::reservePool()
+		 */
+		static void reservePool( unsigned int buffers, unsigned int channels );
+
+	private:
+		/// Storage block header, followed by slots, type- and valid-bitmaps.
+		struct Block {
+			int refs;
+			unsigned int size;
+			unsigned int capacity;
+			unsigned int reserved;	///< keeps the slots 16 byte aligned
+		};
+
+		union Slot {
+			float f;
+			int32 i;
+		};
+
+		Block *block;
+
+		static Block *allocBlock( unsigned int capacity );
+		static void freeBlock( Block *b );
+		static void releaseBlock( Block *b );
+		static size_t blockBytes( unsigned int capacity );
+		static unsigned int blockCapacity( unsigned int n );
+
+		Slot *slots() const { return reinterpret_cast<Slot *>( block + 1 ); }
+		uint32 *typeBits() const { return reinterpret_cast<uint32 *>( slots() + block->capacity ); }
+		uint32 *validBits() const { return typeBits() + (block->capacity + 31) / 32; }
+
+		void grow( unsigned int n );
+		void detach() { if( block && __atomic_load_n( &block->refs, __ATOMIC_ACQUIRE ) > 1 ) unshare(); }
+		void unshare();
+
+		static unsigned long long sharedCopies;
+		static unsigned long long detachedCopies;
+		void setBit( uint32 *bits, unsigned int i, bool flag );
+		bool getBit( const uint32 *bits, unsigned int i ) const
+		{
+			return (bits[i >> 5] >> (i & 31)) & 1;
+		}
+};
+
+
+#endif	//CHANNELBUFFER_H
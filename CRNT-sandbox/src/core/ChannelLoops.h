@@ -0,0 +1,193 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelLoops.h - vector loops shared by the channel kernels (internal)
+
+#ifndef CHANNELLOOPS_H
+#define CHANNELLOOPS_H
+
+#include "ChannelMath.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHANNELMATH_X86
+#include <immintrin.h>
+#define TARGET_SSE __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+
+/*
+ * Loops over channel arrays
+ *
+ * An operation is a functor with a scalar() method and, on x86, sse() and
+ * avx() methods that take 4 and 8 channels. The loops apply the widest
+ * version the level allows and scalar() to the remaining channels.
+ */
+
+template<class Op>
+void unaryScalar( float *x, unsigned int n, const Op &op )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = op.scalar( x[i] );
+	}
+}
+
+template<class Op>
+void binaryScalar( float *x, const float *y, unsigned int n, const Op &op )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = op.scalar( x[i], y[i] );
+	}
+}
+
+template<class Op>
+void unaryScalar( int32 *x, unsigned int n, const Op &op )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = op.scalar( x[i] );
+	}
+}
+
+template<class Op>
+void binaryScalar( int32 *x, const int32 *y, unsigned int n, const Op &op )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = op.scalar( x[i], y[i] );
+	}
+}
+
+#ifdef CHANNELMATH_X86
+
+template<class Op>
+TARGET_SSE void unarySse( float *x, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		_mm_storeu_ps( x + i, op.sse( _mm_loadu_ps( x + i ) ) );
+	}
+	unaryScalar( x + i, n - i, op );
+}
+
+template<class Op>
+TARGET_AVX2 void unaryAvx2( float *x, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		_mm256_storeu_ps( x + i, op.avx( _mm256_loadu_ps( x + i ) ) );
+	}
+	unaryScalar( x + i, n - i, op );
+}
+
+template<class Op>
+TARGET_SSE void binarySse( float *x, const float *y, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		_mm_storeu_ps( x + i, op.sse( _mm_loadu_ps( x + i ), _mm_loadu_ps( y + i ) ) );
+	}
+	binaryScalar( x + i, y + i, n - i, op );
+}
+
+template<class Op>
+TARGET_AVX2 void binaryAvx2( float *x, const float *y, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		_mm256_storeu_ps( x + i, op.avx( _mm256_loadu_ps( x + i ), _mm256_loadu_ps( y + i ) ) );
+	}
+	binaryScalar( x + i, y + i, n - i, op );
+}
+
+template<class Op>
+TARGET_SSE void unarySse( int32 *x, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		__m128i *p = (__m128i *)(x + i);
+		_mm_storeu_si128( p, op.sse( _mm_loadu_si128( p ) ) );
+	}
+	unaryScalar( x + i, n - i, op );
+}
+
+template<class Op>
+TARGET_AVX2 void unaryAvx2( int32 *x, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		__m256i *p = (__m256i *)(x + i);
+		_mm256_storeu_si256( p, op.avx( _mm256_loadu_si256( p ) ) );
+	}
+	unaryScalar( x + i, n - i, op );
+}
+
+template<class Op>
+TARGET_SSE void binarySse( int32 *x, const int32 *y, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		__m128i *p = (__m128i *)(x + i);
+		_mm_storeu_si128( p, op.sse( _mm_loadu_si128( p ), _mm_loadu_si128( (const __m128i *)(y + i) ) ) );
+	}
+	binaryScalar( x + i, y + i, n - i, op );
+}
+
+template<class Op>
+TARGET_AVX2 void binaryAvx2( int32 *x, const int32 *y, unsigned int n, const Op &op )
+{
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		__m256i *p = (__m256i *)(x + i);
+		_mm256_storeu_si256( p, op.avx( _mm256_loadu_si256( p ), _mm256_loadu_si256( (const __m256i *)(y + i) ) ) );
+	}
+	binaryScalar( x + i, y + i, n - i, op );
+}
+
+#endif	//CHANNELMATH_X86
+
+
+/// Run the loop of the selected instruction set.
+template<class T, class Op>
+void unary( T *x, unsigned int n, const Op &op, ChannelMath::Level level )
+{
+#ifdef CHANNELMATH_X86
+	if( level == ChannelMath::AVX2 ) {
+		unaryAvx2( x, n, op );
+		return;
+	}
+	if( level == ChannelMath::SSE ) {
+		unarySse( x, n, op );
+		return;
+	}
+#endif
+	unaryScalar( x, n, op );
+}
+
+template<class T, class Op>
+void binary( T *x, const T *y, unsigned int n, const Op &op, ChannelMath::Level level )
+{
+#ifdef CHANNELMATH_X86
+	if( level == ChannelMath::AVX2 ) {
+		binaryAvx2( x, y, n, op );
+		return;
+	}
+	if( level == ChannelMath::SSE ) {
+		binarySse( x, y, n, op );
+		return;
+	}
+#endif
+	binaryScalar( x, y, n, op );
+}
+
+#endif	//CHANNELLOOPS_H
@@ -0,0 +1,438 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelMath.cpp
+
+#include "ChannelMath.h"
+#include "ChannelLoops.h"
+#include <cmath>
+
+
+ChannelMath::Level ChannelMath::detected = ChannelMath::detect();
+ChannelMath::Level ChannelMath::level = ChannelMath::detected;
+
+
+ChannelMath::Level ChannelMath::detect()
+{
+#ifdef CHANNELMATH_X86
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "avx2" ) ) {
+		return AVX2;
+	}
+	if( __builtin_cpu_supports( "sse4.2" ) ) {
+		return SSE;
+	}
+#endif
+	return SCALAR;
+}
+
+
+ChannelMath::Level ChannelMath::getLevel()
+{
+	return level;
+}
+
+
+ChannelMath::Level ChannelMath::setLevel( Level max )
+{
+	level = max < detected ? max : detected;
+	return level;
+}
+
+
+/*
+ * Operations, see ChannelLoops.h. The loops are instantiated for them in
+ * this file only.
+ */
+
+namespace {
+
+struct AddF {
+	float scalar( float a, float b ) const { return a + b; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a, __m128 b ) const { return _mm_add_ps( a, b ); }
+	TARGET_AVX2 __m256 avx( __m256 a, __m256 b ) const { return _mm256_add_ps( a, b ); }
+#endif
+};
+
+struct SubF {
+	float scalar( float a, float b ) const { return a - b; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a, __m128 b ) const { return _mm_sub_ps( a, b ); }
+	TARGET_AVX2 __m256 avx( __m256 a, __m256 b ) const { return _mm256_sub_ps( a, b ); }
+#endif
+};
+
+struct MulF {
+	float scalar( float a, float b ) const { return a * b; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a, __m128 b ) const { return _mm_mul_ps( a, b ); }
+	TARGET_AVX2 __m256 avx( __m256 a, __m256 b ) const { return _mm256_mul_ps( a, b ); }
+#endif
+};
+
+struct AddConstF {
+	float c;
+	AddConstF( float c ) : c(c) {}
+	float scalar( float a ) const { return a + c; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a ) const { return _mm_add_ps( a, _mm_set1_ps( c ) ); }
+	TARGET_AVX2 __m256 avx( __m256 a ) const { return _mm256_add_ps( a, _mm256_set1_ps( c ) ); }
+#endif
+};
+
+struct ScaleF {
+	float c;
+	ScaleF( float c ) : c(c) {}
+	float scalar( float a ) const { return a * c; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a ) const { return _mm_mul_ps( a, _mm_set1_ps( c ) ); }
+	TARGET_AVX2 __m256 avx( __m256 a ) const { return _mm256_mul_ps( a, _mm256_set1_ps( c ) ); }
+#endif
+};
+
+/// min/max of SSE return the second operand if one is NaN, so NaN passes through.
+struct ClampF {
+	float lo, hi;
+	ClampF( float lo, float hi ) : lo(lo), hi(hi) {}
+	float scalar( float a ) const
+	{
+		float m = lo > a ? lo : a;
+		return hi < m ? hi : m;
+	}
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a ) const
+	{
+		return _mm_min_ps( _mm_set1_ps( hi ), _mm_max_ps( _mm_set1_ps( lo ), a ) );
+	}
+	TARGET_AVX2 __m256 avx( __m256 a ) const
+	{
+		return _mm256_min_ps( _mm256_set1_ps( hi ), _mm256_max_ps( _mm256_set1_ps( lo ), a ) );
+	}
+#endif
+};
+
+struct AbsF {
+	float scalar( float a ) const { return ::fabsf( a ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a ) const { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+	TARGET_AVX2 __m256 avx( __m256 a ) const { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ); }
+#endif
+};
+
+/// The single precision square root equals the double one rounded to float.
+struct SqrtF {
+	float scalar( float a ) const { return (float) ::sqrt( (double)a ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128 sse( __m128 a ) const { return _mm_sqrt_ps( a ); }
+	TARGET_AVX2 __m256 avx( __m256 a ) const { return _mm256_sqrt_ps( a ); }
+#endif
+};
+
+
+/// 32 bit int arithmetic wraps around like the vector instructions.
+static inline int32 wrap( unsigned int u ) { return (int32)u; }
+
+struct AddI {
+	int32 scalar( int32 a, int32 b ) const { return wrap( (uint32)a + (uint32)b ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a, __m128i b ) const { return _mm_add_epi32( a, b ); }
+	TARGET_AVX2 __m256i avx( __m256i a, __m256i b ) const { return _mm256_add_epi32( a, b ); }
+#endif
+};
+
+struct SubI {
+	int32 scalar( int32 a, int32 b ) const { return wrap( (uint32)a - (uint32)b ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a, __m128i b ) const { return _mm_sub_epi32( a, b ); }
+	TARGET_AVX2 __m256i avx( __m256i a, __m256i b ) const { return _mm256_sub_epi32( a, b ); }
+#endif
+};
+
+struct MulI {
+	int32 scalar( int32 a, int32 b ) const { return wrap( (uint32)a * (uint32)b ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a, __m128i b ) const { return _mm_mullo_epi32( a, b ); }
+	TARGET_AVX2 __m256i avx( __m256i a, __m256i b ) const { return _mm256_mullo_epi32( a, b ); }
+#endif
+};
+
+struct AddConstI {
+	int32 c;
+	AddConstI( int32 c ) : c(c) {}
+	int32 scalar( int32 a ) const { return wrap( (uint32)a + (uint32)c ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a ) const { return _mm_add_epi32( a, _mm_set1_epi32( c ) ); }
+	TARGET_AVX2 __m256i avx( __m256i a ) const { return _mm256_add_epi32( a, _mm256_set1_epi32( c ) ); }
+#endif
+};
+
+struct ScaleI {
+	int32 c;
+	ScaleI( int32 c ) : c(c) {}
+	int32 scalar( int32 a ) const { return wrap( (uint32)a * (uint32)c ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a ) const { return _mm_mullo_epi32( a, _mm_set1_epi32( c ) ); }
+	TARGET_AVX2 __m256i avx( __m256i a ) const { return _mm256_mullo_epi32( a, _mm256_set1_epi32( c ) ); }
+#endif
+};
+
+struct ClampI {
+	int32 lo, hi;
+	ClampI( int32 lo, int32 hi ) : lo(lo), hi(hi) {}
+	int32 scalar( int32 a ) const
+	{
+		int32 m = lo > a ? lo : a;
+		return hi < m ? hi : m;
+	}
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a ) const
+	{
+		return _mm_min_epi32( _mm_set1_epi32( hi ), _mm_max_epi32( _mm_set1_epi32( lo ), a ) );
+	}
+	TARGET_AVX2 __m256i avx( __m256i a ) const
+	{
+		return _mm256_min_epi32( _mm256_set1_epi32( hi ), _mm256_max_epi32( _mm256_set1_epi32( lo ), a ) );
+	}
+#endif
+};
+
+/// abs() of the smallest int stays negative, like the vector instruction.
+struct AbsI {
+	int32 scalar( int32 a ) const { return a < 0 ? wrap( 0u - (uint32)a ) : a; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a ) const { return _mm_abs_epi32( a ); }
+	TARGET_AVX2 __m256i avx( __m256i a ) const { return _mm256_abs_epi32( a ); }
+#endif
+};
+
+/**
+ * The double square root of a 32 bit int is exact enough that truncating
+ * it gives the integer square root of IntValue::sqrt(). The sign mask
+ * clears the results of negative values.
+ */
+struct SqrtI {
+	int32 scalar( int32 a ) const { return a > 0 ? (int32) ::sqrt( (double)a ) : 0; }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a ) const
+	{
+		__m128i lo = _mm_cvttpd_epi32( _mm_sqrt_pd( _mm_cvtepi32_pd( a ) ) );
+		__m128i hi = _mm_cvttpd_epi32( _mm_sqrt_pd( _mm_cvtepi32_pd( _mm_srli_si128( a, 8 ) ) ) );
+		__m128i r = _mm_unpacklo_epi64( lo, hi );
+		return _mm_andnot_si128( _mm_srai_epi32( a, 31 ), r );
+	}
+	TARGET_AVX2 __m256i avx( __m256i a ) const
+	{
+		__m128i lo = _mm256_cvttpd_epi32( _mm256_sqrt_pd( _mm256_cvtepi32_pd( _mm256_castsi256_si128( a ) ) ) );
+		__m128i hi = _mm256_cvttpd_epi32( _mm256_sqrt_pd( _mm256_cvtepi32_pd( _mm256_extracti128_si256( a, 1 ) ) ) );
+		__m256i r = _mm256_inserti128_si256( _mm256_castsi128_si256( lo ), hi, 1 );
+		return _mm256_andnot_si256( _mm256_srai_epi32( a, 31 ), r );
+	}
+#endif
+};
+
+}	//namespace
+
+
+void ChannelMath::add( float *x, const float *y, unsigned int n ) { binary( x, y, n, AddF(), level ); }
+void ChannelMath::subtract( float *x, const float *y, unsigned int n ) { binary( x, y, n, SubF(), level ); }
+void ChannelMath::multiply( float *x, const float *y, unsigned int n ) { binary( x, y, n, MulF(), level ); }
+void ChannelMath::add( float *x, float c, unsigned int n ) { unary( x, n, AddConstF( c ), level ); }
+void ChannelMath::scale( float *x, float c, unsigned int n ) { unary( x, n, ScaleF( c ), level ); }
+void ChannelMath::clamp( float *x, float lo, float hi, unsigned int n ) { unary( x, n, ClampF( lo, hi ), level ); }
+void ChannelMath::abs( float *x, unsigned int n ) { unary( x, n, AbsF(), level ); }
+void ChannelMath::sqrt( float *x, unsigned int n ) { unary( x, n, SqrtF(), level ); }
+
+void ChannelMath::add( int32 *x, const int32 *y, unsigned int n ) { binary( x, y, n, AddI(), level ); }
+void ChannelMath::subtract( int32 *x, const int32 *y, unsigned int n ) { binary( x, y, n, SubI(), level ); }
+void ChannelMath::multiply( int32 *x, const int32 *y, unsigned int n ) { binary( x, y, n, MulI(), level ); }
+void ChannelMath::add( int32 *x, int32 c, unsigned int n ) { unary( x, n, AddConstI( c ), level ); }
+void ChannelMath::scale( int32 *x, int32 c, unsigned int n ) { unary( x, n, ScaleI( c ), level ); }
+void ChannelMath::clamp( int32 *x, int32 lo, int32 hi, unsigned int n ) { unary( x, n, ClampI( lo, hi ), level ); }
+void ChannelMath::abs( int32 *x, unsigned int n ) { unary( x, n, AbsI(), level ); }
+void ChannelMath::sqrt( int32 *x, unsigned int n ) { unary( x, n, SqrtI(), level ); }
+
+
+/*
+ * Functions of the C library, computed in double precision like FloatValue
+ */
+
+void ChannelMath::log2( float *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = (float) ::log2( (double)x[i] );
+	}
+}
+
+
+void ChannelMath::exp( float *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = (float) ::exp( (double)x[i] );
+	}
+}
+
+
+void ChannelMath::sin( float *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = (float) ::sin( (double)x[i] );
+	}
+}
+
+
+void ChannelMath::cos( float *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = (float) ::cos( (double)x[i] );
+	}
+}
+
+
+void ChannelMath::atan2( float *y, const float *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		y[i] = (float) ::atan2( (double)y[i], (double)x[i] );
+	}
+}
+
+
+/*
+ * Reductions
+ */
+
+#ifdef CHANNELMATH_X86
+
+TARGET_SSE static double dotSse( const float *x, const float *y, unsigned int n )
+{
+	__m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		__m128 p = _mm_mul_ps( _mm_loadu_ps( x + i ), _mm_loadu_ps( y + i ) );
+		s0 = _mm_add_pd( s0, _mm_cvtps_pd( p ) );
+		s1 = _mm_add_pd( s1, _mm_cvtps_pd( _mm_movehl_ps( p, p ) ) );
+	}
+	double s[2];
+	_mm_storeu_pd( s, _mm_add_pd( s0, s1 ) );
+	double sum = s[0] + s[1];
+	for( ; i < n; i++ ) {
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+
+TARGET_AVX2 static double dotAvx2( const float *x, const float *y, unsigned int n )
+{
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		__m256 p = _mm256_mul_ps( _mm256_loadu_ps( x + i ), _mm256_loadu_ps( y + i ) );
+		s0 = _mm256_add_pd( s0, _mm256_cvtps_pd( _mm256_castps256_ps128( p ) ) );
+		s1 = _mm256_add_pd( s1, _mm256_cvtps_pd( _mm256_extractf128_ps( p, 1 ) ) );
+	}
+	double s[4];
+	_mm256_storeu_pd( s, _mm256_add_pd( s0, s1 ) );
+	double sum = s[0] + s[1] + s[2] + s[3];
+	for( ; i < n; i++ ) {
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+
+/// Sum of the products of the even and the odd lanes as 64 bit ints.
+TARGET_SSE static long long dotSse( const int32 *x, const int32 *y, unsigned int n )
+{
+	__m128i s = _mm_setzero_si128();
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		__m128i a = _mm_loadu_si128( (const __m128i *)(x + i) );
+		__m128i b = _mm_loadu_si128( (const __m128i *)(y + i) );
+		s = _mm_add_epi64( s, _mm_mul_epi32( a, b ) );
+		s = _mm_add_epi64( s, _mm_mul_epi32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) ) );
+	}
+	long long r[2];
+	_mm_storeu_si128( (__m128i *)r, s );
+	long long sum = r[0] + r[1];
+	for( ; i < n; i++ ) {
+		sum += (long long)x[i] * y[i];
+	}
+	return sum;
+}
+
+
+TARGET_AVX2 static long long dotAvx2( const int32 *x, const int32 *y, unsigned int n )
+{
+	__m256i s = _mm256_setzero_si256();
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		__m256i a = _mm256_loadu_si256( (const __m256i *)(x + i) );
+		__m256i b = _mm256_loadu_si256( (const __m256i *)(y + i) );
+		s = _mm256_add_epi64( s, _mm256_mul_epi32( a, b ) );
+		s = _mm256_add_epi64( s, _mm256_mul_epi32( _mm256_srli_epi64( a, 32 ), _mm256_srli_epi64( b, 32 ) ) );
+	}
+	long long r[4];
+	_mm256_storeu_si256( (__m256i *)r, s );
+	long long sum = r[0] + r[1] + r[2] + r[3];
+	for( ; i < n; i++ ) {
+		sum += (long long)x[i] * y[i];
+	}
+	return sum;
+}
+
+#endif	//CHANNELMATH_X86
+
+
+double ChannelMath::dot( const float *x, const float *y, unsigned int n )
+{
+#ifdef CHANNELMATH_X86
+	if( level == AVX2 ) {
+		return dotAvx2( x, y, n );
+	}
+	if( level == SSE ) {
+		return dotSse( x, y, n );
+	}
+#endif
+	double sum = 0;
+	for( unsigned int i = 0; i < n; i++ ) {
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+
+double ChannelMath::norm2( const float *x, unsigned int n )
+{
+	return ::sqrt( dot( x, x, n ) );
+}
+
+
+long long ChannelMath::dot( const int32 *x, const int32 *y, unsigned int n )
+{
+#ifdef CHANNELMATH_X86
+	if( level == AVX2 ) {
+		return dotAvx2( x, y, n );
+	}
+	if( level == SSE ) {
+		return dotSse( x, y, n );
+	}
+#endif
+	long long sum = 0;
+	for( unsigned int i = 0; i < n; i++ ) {
+		sum += (long long)x[i] * y[i];
+	}
+	return sum;
+}
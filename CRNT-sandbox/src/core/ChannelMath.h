@@ -0,0 +1,104 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelMath.h - channel-wise math on arrays of channel values
+
+#ifndef CHANNELMATH_H
+#define CHANNELMATH_H
+
+#include "Value.h"
+
+
+/**
+ * \ingroup core
+ * \brief Bulk math kernels over channel arrays.
+ *
+ * The kernels replace one virtual Value call per channel by a loop over a
+ * plain array, e.g. the channels of a typed packet
+ * (DataPacket::editFloatChannels(), ChannelBuffer::intData()) or a window
+ * of samples. Most operations work in place: \c x[i] = x[i] op y[i].
+ *
+ * The results are the same as those of the Value methods:
+ * - float kernels as FloatValue (single precision arithmetic; sqrt, log2,
+ *   exp, sin, cos and atan2 rounded from the double precision result),
+ * - int kernels as IntValue (32 bit arithmetic that wraps around, sqrt()
+ *   rounds down and gives 0 for negative values).
+ *
+ * add, multiply, scale, clamp, abs, sqrt and the reductions use SSE4.2 or
+ * AVX2 if the CPU has it (checked once with cpuid), with a scalar
+ * fallback. The transcendental functions are scalar loops over the C
+ * library, a vector approximation would not give the same results.
+ */
+class ChannelMath
+{
+	public:
+		/// Instruction sets.
+		enum Level {
+			SCALAR = 0,		///< plain C++
+			SSE = 1,		///< SSE up to 4.2
+			AVX2 = 2		///< AVX2
+		};
+
+		/// The instruction set used by the kernels.
+		static Level getLevel();
+
+		/**
+		 * \brief Limit the instruction set (e.g. for comparisons).
+		 * \return The level in use, at most the one the CPU supports.
+		 */
+		static Level setLevel( Level max );
+
+		// float kernels (FloatValue semantics)
+		static void add( float *x, const float *y, unsigned int n );			///< x += y
+		static void subtract( float *x, const float *y, unsigned int n );		///< x -= y
+		static void multiply( float *x, const float *y, unsigned int n );		///< x *= y
+		static void add( float *x, float c, unsigned int n );					///< x += c
+		static void scale( float *x, float c, unsigned int n );					///< x *= c
+		static void clamp( float *x, float lo, float hi, unsigned int n );		///< Limit x to [lo, hi], NaN stays NaN.
+		static void abs( float *x, unsigned int n );
+		static void sqrt( float *x, unsigned int n );
+		static void log2( float *x, unsigned int n );
+		static void exp( float *x, unsigned int n );
+		static void sin( float *x, unsigned int n );
+		static void cos( float *x, unsigned int n );
+		static void atan2( float *y, const float *x, unsigned int n );			///< y = atan2(y, x)
+
+		/// Sum of x[i] * y[i], accumulated in double precision.
+		static double dot( const float *x, const float *y, unsigned int n );
+
+		/// Euclidean norm of \p x.
+		static double norm2( const float *x, unsigned int n );
+
+		// int kernels (IntValue semantics)
+		static void add( int32 *x, const int32 *y, unsigned int n );			///< x += y
+		static void subtract( int32 *x, const int32 *y, unsigned int n );		///< x -= y
+		static void multiply( int32 *x, const int32 *y, unsigned int n );		///< x *= y
+		static void add( int32 *x, int32 c, unsigned int n );					///< x += c
+		static void scale( int32 *x, int32 c, unsigned int n );					///< x *= c
+		static void clamp( int32 *x, int32 lo, int32 hi, unsigned int n );		///< Limit x to [lo, hi].
+		static void abs( int32 *x, unsigned int n );
+		static void sqrt( int32 *x, unsigned int n );
+
+		/// Sum of x[i] * y[i] (64 bit).
+		static long long dot( const int32 *x, const int32 *y, unsigned int n );
+
+	private:
+		static Level detected;
+		static Level level;
+		static Level detect();
+};
+
+
+#endif	//CHANNELMATH_H
@@ -0,0 +1,158 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelValue.cpp
+
+#include "ChannelValue.h"
+#include "FloatValue.h"
+#include "IntValue.h"
+
+
+
+ChannelValue::ChannelValue( ChannelBuffer *buffer, unsigned int index )
+: buffer( buffer ), index( index ) {}
+ChannelValue::~ChannelValue() {}
+
+Value* ChannelValue::clone() const
+{
+	if( isInt() ) {
+		return new IntValue( buffer->getInt( index ), isValid() );
+	}
+	return new FloatValue( buffer->getFloat( index ), isValid() );
+}
+
+bool ChannelValue::isValid() const { return buffer->isValid( index ); }
+void ChannelValue::setValid( bool v ) { buffer->setValid( index, v ); }
+void ChannelValue::invalidate() { buffer->setValid( index, false ); }
+
+//access (read)
+int ChannelValue::getInt() const { return buffer->getInt( index ); }
+float ChannelValue::getFloat() const { return buffer->getFloat( index ); }
+fix ChannelValue::getFix() const
+{
+	if( isInt() ) {
+		return IntValue( buffer->getInt( index ) ).getFix();
+	}
+	return FloatValue( buffer->getFloat( index ) ).getFix();
+}
+void ChannelValue::toString( std::ostream &o ) const
+{
+	if( isInt() ) {
+		o << buffer->getInt( index );
+	}
+	else {
+		o << std::scientific << buffer->getFloat( index );
+	}
+}
+
+//access (write)
+void ChannelValue::setVal( int k ) { buffer->setInt( index, k ); }
+void ChannelValue::setVal( float f ) { buffer->setFloat( index, f ); }
+
+
+/**
+ * Applies the unary operation \p op with the semantics of FloatValue or
+ * IntValue (depending on the channel type) and stores the result.
+ */
+Value& ChannelValue::apply( Value& (Value::*op)() )
+{
+	if( isInt() ) {
+		IntValue v( buffer->getInt( index ) );
+		(v.*op)();
+		buffer->setInt( index, v.getInt() );
+	}
+	else {
+		FloatValue v( buffer->getFloat( index ) );
+		(v.*op)();
+		buffer->setFloat( index, v.getFloat() );
+	}
+	return *this;
+}
+
+//math ops
+Value& ChannelValue::operator+=( const Value& v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) + v.getInt() );
+	else buffer->setFloat( index, buffer->getFloat( index ) + v.getFloat() );
+	return *this;
+}
+Value& ChannelValue::operator-=( const Value& v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) - v.getInt() );
+	else buffer->setFloat( index, buffer->getFloat( index ) - v.getFloat() );
+	return *this;
+}
+Value& ChannelValue::operator*=( const Value& v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) * v.getInt() );
+	else buffer->setFloat( index, buffer->getFloat( index ) * v.getFloat() );
+	return *this;
+}
+Value& ChannelValue::operator/=( const Value& v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) / v.getInt() );
+	else buffer->setFloat( index, buffer->getFloat( index ) / v.getFloat() );
+	return *this;
+}
+Value& ChannelValue::operator+=( const int v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) + v );
+	else buffer->setFloat( index, buffer->getFloat( index ) + v );
+	return *this;
+}
+Value& ChannelValue::operator-=( const int v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) - v );
+	else buffer->setFloat( index, buffer->getFloat( index ) - v );
+	return *this;
+}
+Value& ChannelValue::operator*=( const int v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) * v );
+	else buffer->setFloat( index, buffer->getFloat( index ) * v );
+	return *this;
+}
+Value& ChannelValue::operator/=( const int v )
+{
+	if( isInt() ) buffer->setInt( index, buffer->getInt( index ) / v );
+	else buffer->setFloat( index, buffer->getFloat( index ) / v );
+	return *this;
+}
+
+Value& ChannelValue::sqrt() { return apply( &Value::sqrt ); }
+Value& ChannelValue::log2() { return apply( &Value::log2 ); }
+Value& ChannelValue::exp2() { return apply( &Value::exp2 ); }
+Value& ChannelValue::exp() { return apply( &Value::exp ); }
+Value& ChannelValue::sin() { return apply( &Value::sin ); }
+Value& ChannelValue::cos() { return apply( &Value::cos ); }
+Value& ChannelValue::tan() { return apply( &Value::tan ); }
+Value& ChannelValue::asin() { return apply( &Value::asin ); }
+Value& ChannelValue::acos() { return apply( &Value::acos ); }
+Value& ChannelValue::atan() { return apply( &Value::atan ); }
+Value& ChannelValue::abs() { return apply( &Value::abs ); }
+
+//comparison ops
+bool ChannelValue::operator<( const Value& v ) const
+{ return isInt() ? getInt() < v.getInt() : getFloat() < v.getFloat(); }
+bool ChannelValue::operator>( const Value& v ) const
+{ return isInt() ? getInt() > v.getInt() : getFloat() > v.getFloat(); }
+bool ChannelValue::operator==( const Value& v ) const
+{ return isInt() ? getInt() == v.getInt() : getFloat() == v.getFloat(); }
+bool ChannelValue::operator!=( const Value& v ) const
+{ return isInt() ? getInt() != v.getInt() : getFloat() != v.getFloat(); }
+bool ChannelValue::operator<=( const Value& v ) const
+{ return isInt() ? getInt() <= v.getInt() : getFloat() <= v.getFloat(); }
+bool ChannelValue::operator>=( const Value& v ) const
+{ return isInt() ? getInt() >= v.getInt() : getFloat() >= v.getFloat(); }
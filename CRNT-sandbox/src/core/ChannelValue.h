@@ -0,0 +1,99 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ChannelValue.h
+
+#ifndef CHANNELVALUE_H
+#define CHANNELVALUE_H
+
+#include "Value.h"
+#include "ChannelBuffer.h"
+
+
+
+/**
+ * \ingroup core
+ * \brief Value referring to a channel of a ChannelBuffer.
+ *
+ * Compatibility shim returned by DataPacket::getChannel() for packets
+ * with typed channel storage. Reads and writes go to the slot in the
+ * buffer and behave like a FloatValue or IntValue, depending on the
+ * channel type. The object is owned by the data packet; clone() returns
+ * a detached FloatValue or IntValue.
+ */
+class ChannelValue: public Value
+{
+	public:
+		ChannelValue( ChannelBuffer *buffer, unsigned int index );
+		virtual ~ChannelValue();
+
+		/// Clone this object (returns a FloatValue or IntValue)
+		virtual Value* clone() const;
+
+		virtual bool isValid() const;
+		virtual void setValid( bool valid );
+		virtual void invalidate();
+
+		//access (read)
+		virtual int getInt() const;
+		virtual float getFloat() const;
+		virtual fix getFix() const;
+		/// Print object to stream o.
+		virtual void toString( std::ostream &o ) const;
+
+		//access (write)
+		virtual void setVal( int k );
+		virtual void setVal( float f );
+		
+		//math ops
+		virtual Value& operator+=( const Value& v );
+		virtual Value& operator-=( const Value& v );
+		virtual Value& operator*=( const Value& v );
+		virtual Value& operator/=( const Value& v );
+		virtual Value& operator+=( const int v );
+		virtual Value& operator-=( const int v );
+		virtual Value& operator*=( const int v );
+		virtual Value& operator/=( const int v );
+		
+		virtual Value& sqrt();	///< square root
+		virtual Value& log2();	///< Logarithm to base 2.
+		virtual Value& exp2();	///< Raise 2 to-the-power of this value.
+		virtual Value& exp();	///< Raise e to-the-power of thie value.
+		virtual Value& sin();	///< Sine
+		virtual Value& cos();	///< Cosine
+		virtual Value& tan();	///< Tangent
+		virtual Value& asin();	///< Arc-Sine
+		virtual Value& acos();	///< Arc-Cosine
+		virtual Value& atan();	///< Arc-Tangent
+		virtual Value& abs();	///< ABS
+		
+		//comparison ops
+		virtual bool operator<( const Value& v ) const;
+		virtual bool operator>( const Value& v ) const;
+		virtual bool operator==( const Value& v ) const;
+		virtual bool operator!=( const Value& v ) const;
+		virtual bool operator<=( const Value& v ) const;
+		virtual bool operator>=( const Value& v ) const;
+
+	private:
+		ChannelBuffer *buffer;
+		unsigned int index;
+
+		bool isInt() const { return buffer->getType( index ) == ChannelBuffer::INT; }
+		Value& apply( Value& (Value::*op)() );
+};
+
+
+#endif	//CHANNELVALUE_H
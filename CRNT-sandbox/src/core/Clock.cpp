@@ -0,0 +1,85 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Clock.cpp
+
+#include "Clock.h"
+#include <pthread.h>
+
+
+long long Clock::offsetNs = 0;
+
+// packets may be created during static initialization
+static pthread_once_t clockOnce = PTHREAD_ONCE_INIT;
+
+
+void Clock::init()
+{
+	resync();
+}
+
+
+void Clock::resync()
+{
+	struct timespec mono, wall;
+	clock_gettime( CLOCK_MONOTONIC, &mono );
+	clock_gettime( CLOCK_REALTIME, &wall );
+	long long offset = (wall.tv_sec - mono.tv_sec) * 1000000000LL + (wall.tv_nsec - mono.tv_nsec);
+	__atomic_store_n( &offsetNs, offset, __ATOMIC_RELAXED );
+}
+
+
+long long Clock::wallOffset()
+{
+	pthread_once( &clockOnce, Clock::init );
+	return __atomic_load_n( &offsetNs, __ATOMIC_RELAXED );
+}
+
+
+void Clock::absoluteTimeout( long timeout, struct timespec *ts )
+{
+	toTimespec( nowNs() + timeout * 1000000ULL, ts );
+}
+
+
+void Clock::toTimespec( unsigned long long ns, struct timespec *ts )
+{
+	ts->tv_sec = ns / 1000000000ULL;
+	ts->tv_nsec = ns % 1000000000ULL;
+}
+
+
+void Clock::toTimeval( unsigned long long ns, struct timeval *tv )
+{
+	long long wall = (long long)ns + wallOffset();
+	tv->tv_sec = wall / 1000000000LL;
+	tv->tv_usec = (wall % 1000000000LL) / 1000;
+}
+
+
+unsigned long long Clock::fromTimeval( const struct timeval &tv )
+{
+	long long wall = tv.tv_sec * 1000000000LL + tv.tv_usec * 1000LL;
+	long long offset = wallOffset();
+	//before the monotonic epoch, it must not wrap around
+	return wall < offset ? 0 : wall - offset;
+}
+
+
+unsigned long long Clock::fromRelativeTimeval( const struct timeval &tv )
+{
+	long long ns = tv.tv_sec * 1000000000LL + tv.tv_usec * 1000LL;
+	return ns > 0 ? ns : 0;
+}
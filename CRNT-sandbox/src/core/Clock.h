@@ -0,0 +1,89 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Clock.h - monotonic time base of the toolbox
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <time.h>
+#include <sys/time.h>
+
+
+/**
+ * \ingroup core
+ * \brief Monotonic nanosecond clock.
+ *
+ * All time stamps and timeouts of the toolbox are taken from
+ * CLOCK_MONOTONIC, which is not affected by NTP steps or by setting
+ * the system time. On Linux, clock_gettime() of this clock is served by
+ * the vDSO (the kernel calibrated TSC is read in user space), so it does
+ * not enter the kernel.
+ *
+ * Wall clock time is only needed for display. It is derived from a
+ * monotonic time stamp by adding an offset that is sampled once (see
+ * resync()), so converting does not need a system call either.
+ */
+class Clock
+{
+	public:
+		/// Current monotonic time in nanoseconds.
+		static unsigned long long nowNs()
+		{
+			struct timespec ts;
+			clock_gettime( CLOCK_MONOTONIC, &ts );
+			return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+		}
+
+		/**
+		 * \brief Absolute deadline for Condition::wait().
+		 * \param timeout Relative timeout in milliseconds.
+		 * \param ts Monotonic time \p timeout ms from now.
+		 */
+		static void absoluteTimeout( long timeout, struct timespec *ts );
+
+		/// Convert monotonic nanoseconds to a timespec (e.g. for Condition::wait()).
+		static void toTimespec( unsigned long long ns, struct timespec *ts );
+
+		/// Convert a monotonic time stamp to wall clock time.
+		static void toTimeval( unsigned long long ns, struct timeval *tv );
+
+		/**
+		 * \brief Convert wall clock time to a monotonic time stamp.
+		 *
+		 * Times before the start of the monotonic clock are returned as 0.
+		 * Convert relative times with fromRelativeTimeval().
+		 */
+		static unsigned long long fromTimeval( const struct timeval &tv );
+
+		/// Convert a relative time (e.g. 0.5 s into a file) to nanoseconds, negative ones to 0.
+		static unsigned long long fromRelativeTimeval( const struct timeval &tv );
+
+		/**
+		 * \brief Sample the offset between wall clock and monotonic time again.
+		 *
+		 * Only affects time stamps converted afterwards, e.g. call it
+		 * after the system time was set.
+		 */
+		static void resync();
+
+	private:
+		static long long wallOffset();
+		static void init();
+		static long long offsetNs;	///< Wall clock minus monotonic time.
+};
+
+
+#endif	//CLOCK_H
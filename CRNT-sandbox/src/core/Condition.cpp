@@ -21,12 +21,17 @@
 
 Condition::Condition() : canceling(false)
 {
-	if( pthread_cond_init( &condition, NULL ) == 0 ) {
+	//timeouts are measured on the monotonic clock (see Clock)
+	pthread_condattr_t attr;
+	pthread_condattr_init( &attr );
+	pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+	if( pthread_cond_init( &condition, &attr ) == 0 ) {
 		//log( "Condition initialized." );
 	}
 	else {
 		log( "ERROR: condition variable not initialized properly." );
 	}
+	pthread_condattr_destroy( &attr );
 }
 
 
@@ -49,7 +49,7 @@ class Condition : TBObject
 		 * If \p timeout is specified this method will not block
 		 * longer than \p timeout (absolute time).
 		 *
-		 * \param timeout Absolute timestamp.
+		 * \param timeout Absolute CLOCK_MONOTONIC time, see Clock::absoluteTimeout().
 		 * \see See manpage for "pthread_cond_wait" for details.
 		 */
 		void wait( Mutex *m, const struct timespec *timeout = NULL );
@@ -21,6 +21,11 @@
 // 
 
 #include "DataPacket.h"
+#include "PacketPool.h"
+#include "FloatValue.h"
+#include "IntValue.h"
+#include "ChannelValue.h"
+#include "Clock.h"
 #include <math.h>
 #include <stdio.h>
 #include <typeinfo>
@@ -45,6 +50,19 @@ Mutex DataPacket::mutex;
 vector<Value> DataPacket::streamDescs;
 
 
+void *DataPacket::operator new( size_t size ) { return PacketPool::allocate( size ); }
+void DataPacket::operator delete( void *p, size_t size ) { PacketPool::release( p, size ); }
+
+
+void DataPacket::reservePool( unsigned int packets, unsigned int channels )
+{
+	size_t valueSize = sizeof( FloatValue ) > sizeof( IntValue ) ? sizeof( FloatValue ) : sizeof( IntValue );
+	PacketPool::reserve( sizeof( DataPacket ), packets );
+	PacketPool::reserve( valueSize, packets * channels );
+	ChannelBuffer::reservePool( packets, channels );
+}
+
+
 /// Default constructor.
 DataPacket::DataPacket( int streamId ) : streamId(streamId)
 {
@@ -53,9 +71,23 @@ DataPacket::DataPacket( int streamId ) : streamId(streamId)
   seqNr = 0;
   endOfStream = false;
 	
-  if( gettimeofday( &timestamp, NULL ) < 0 ) {
-    log( "ERROR: gettimeofday() failed." );
-  }
+  timestampNs = Clock::nowNs();
+  Clock::toTimeval( timestampNs, &timestamp );
+}
+
+
+
+/// Constructor for packets with typed channel storage.
+DataPacket::DataPacket( int streamId, unsigned int numChannels, ChannelBuffer::Type type )
+: streamId(streamId)
+{
+  number = counter++;
+  seqNr = 0;
+  endOfStream = false;
+  channels.resize( numChannels, type );
+
+  timestampNs = Clock::nowNs();
+  Clock::toTimeval( timestampNs, &timestamp );
 }
 
 
@@ -65,16 +97,18 @@ DataPacket::DataPacket( int streamId ) : streamId(streamId)
  * Creates a copy of an existing DataPacket
  */
  // mk added super packet support
-DataPacket::DataPacket( const DataPacket &p ){
+DataPacket::DataPacket( const DataPacket &p ) : channels( p.channels ), window( p.window ) {
 	
 	number = p.number;
   	seqNr = p.seqNr;
   	timestamp.tv_sec = p.timestamp.tv_sec;
   	timestamp.tv_usec = p.timestamp.tv_usec;
+  	timestampNs = p.timestampNs;
   	streamId = p.streamId;
 	endOfStream = p.endOfStream;
   
 	packetVector.clear();
+	packetVector.reserve( p.packetVector.size() );
     
     // copy segment data
     for( uint32 i=0; i<p.packetVector.size(); i++ ){
@@ -82,6 +116,7 @@ DataPacket::DataPacket( const DataPacket &p ){
     }  
   
   	dataVector.clear();
+	dataVector.reserve( p.dataVector.size() );
     
     // copy the Value objects
     for( uint32 i=0; i<p.dataVector.size(); i++ ) {
@@ -99,12 +134,13 @@ DataPacket::DataPacket( const DataPacket &p ){
  * @param channels Indexes of channels to copy.
  */
  // mk added super packet support
-DataPacket::DataPacket( DataPacket &p, vector<unsigned> channels ){ 
+DataPacket::DataPacket( DataPacket &p, vector<unsigned> channels ) : window( p.window ) { 
 
   	number = p.number;
   	seqNr = p.seqNr;
   	timestamp.tv_sec = p.timestamp.tv_sec;
   	timestamp.tv_usec = p.timestamp.tv_usec;
+  	timestampNs = p.timestampNs;
    	streamId = p.streamId;
 	endOfStream = p.endOfStream;
  
@@ -117,6 +153,12 @@ DataPacket::DataPacket( DataPacket &p, vector<unsigned> channels ){
   
     dataVector.clear();
     
+    if( p.isTyped() ) {
+    	this->channels = p.channels;
+    	this->channels.select( channels );
+    	return;
+    }
+
     //copy the Value objects
     for( uint32 i=0; i<channels.size(); i++ ) {
 		Value *v = p.dataVector.at( channels.at(i) );
@@ -141,6 +183,16 @@ DataPacket::~DataPacket() {
   	for( uint32 i=0; i<dataVector.size(); i++ ) {
    		delete dataVector.at(i);
   	}
+  	clearProxies();
+}
+
+
+void DataPacket::clearProxies()
+{
+	for( uint32 i=0; i<channelProxies.size(); i++ ) {
+		delete channelProxies[i];
+	}
+	channelProxies.clear();
 }
 
 
@@ -149,6 +201,20 @@ Value *DataPacket::getChannel( unsigned int i ) const
 {
 	Value *val = NULL;
 	
+	if( isTyped() ) {
+		if( i >= channels.size() ) {
+			log( "WARNING: channel does not exist:" ) << i << endl;
+			return NULL;
+		}
+		if( channelProxies.size() < channels.size() ) {
+			channelProxies.resize( channels.size(), NULL );
+		}
+		if( !channelProxies[i] ) {
+			channelProxies[i] = new ChannelValue( const_cast<ChannelBuffer *>( &channels ), i );
+		}
+		return channelProxies[i];
+	}
+
 	try{
 		val = dataVector.at( i );
 	}
@@ -161,6 +227,27 @@ Value *DataPacket::getChannel( unsigned int i ) const
 
 void DataPacket::setChannel( unsigned int i, Value *val )
 {
+	if( isTyped() ) {
+		if( i >= channels.size() ) {
+			log( "WARNING: channel does not exist:" ) << i << endl;
+			return;
+		}
+		if( i < channelProxies.size() && channelProxies[i] == val ) {
+			return;
+		}
+		if( dynamic_cast<IntValue *>( val ) ) {
+			channels.setType( i, ChannelBuffer::INT );
+			channels.setInt( i, val->getInt() );
+		}
+		else {
+			channels.setType( i, ChannelBuffer::FLOAT );
+			channels.setFloat( i, val->getFloat() );
+		}
+		channels.setValid( i, val->isValid() );
+		delete val;
+		return;
+	}
+
 	try{
 		Value *old = dataVector.at( i );
 		dataVector.at( i ) = val;
@@ -173,9 +260,61 @@ void DataPacket::setChannel( unsigned int i, Value *val )
 
 unsigned long int DataPacket::size() const
 {
-	return dataVector.size();
+	return isTyped() ? channels.size() : dataVector.size();
+}
+
+
+const float *DataPacket::getFloatChannels() const
+{
+	if( !channels.isHomogeneous( ChannelBuffer::FLOAT ) ) {
+		return NULL;
+	}
+	return channels.floatData();
+}
+
+
+float *DataPacket::editFloatChannels()
+{
+	if( !channels.isHomogeneous( ChannelBuffer::FLOAT ) ) {
+		return NULL;
+	}
+	return channels.floatData();
+}
+
+/**
+ * Value channels are converted in the order of dataVector: IntValue as
+ * ChannelBuffer::INT, all other Values (and NULL entries, marked invalid)
+ * as ChannelBuffer::FLOAT.
+ */
+const ChannelBuffer &DataPacket::getTypedChannels( ChannelBuffer &tmp ) const
+{
+	if( isTyped() || dataVector.empty() ) {
+		return channels;
+	}
+	tmp.clear();
+	tmp.reserve( dataVector.size() );
+	for( unsigned int i = 0; i < dataVector.size(); i++ ) {
+		const Value *v = dataVector[i];
+		if( v && dynamic_cast<const IntValue *>( v ) ) {
+			tmp.appendInt( v->getInt(), v->isValid() );
+		}
+		else {
+			tmp.appendFloat( v ? v->getFloat() : 0, v && v->isValid() );
+		}
+	}
+	return tmp;
 }
 
+
+void DataPacket::reportWindowLost() const
+{
+	static bool warned = false;
+	if( !__atomic_exchange_n( &warned, true, __ATOMIC_RELAXED ) ) {
+		log( "WARNING: window of packet not serialized, it exists in-process only (reported once)" );
+	}
+}
+
+
 void DataPacket::setStreamId( int id )
 {
 	if( id < 0 ) {
@@ -206,12 +345,21 @@ double DataPacket::getTimestampSec() const
 }
 
 
-void DataPacket::setTimestampSec(double seconds)
+void DataPacket::setTimestampSec(double seconds, bool relative)
 {
 	double integral;
 	double fractional = modf(seconds, &integral);
-	timestamp.tv_sec = integral;
-	timestamp.tv_usec = fractional * 1000000;
+	struct timeval tv;
+	tv.tv_sec = integral;
+	tv.tv_usec = fractional * 1000000;
+	setTimestamp( tv, relative );
+}
+
+
+void DataPacket::setTimestamp( const struct timeval &tv, bool relative )
+{
+	timestamp = tv;
+	timestampNs = relative ? Clock::fromRelativeTimeval( tv ) : Clock::fromTimeval( tv );
 }
 
 
@@ -237,6 +385,8 @@ void DataPacket::toString( ostream &o ){
   o << "\tstreamId          : " << streamId << endl;
   o << "\tpacketVector.size : " << packetVector.size() << endl; // mk
   o << "\tdataVector.size   : " << dataVector.size() << endl;   // mk
+  o << "\tchannels.size     : " << channels.size() << endl;
+  o << "\twindow.size       : " << window.size() << endl;
   o << "\ttimestamp         : " << timestamp.tv_sec << " sec, ";
   o << timestamp.tv_usec << " usec";
   o << ", addr " << &timestamp;
@@ -270,6 +420,12 @@ void DataPacket::toString( ostream &o ){
     o << dataVector[i] << " ";
   }
   o << endl;
+
+  if( isTyped() ) {
+    o << "\tchannels: ";
+    channels.toString( o );
+    o << endl;
+  }
   
 }
 
@@ -307,11 +463,17 @@ void DataPacket::dump_packet(char * filename) {
     	for( uint32 j=0; j<v.size(); j++ ){
 			fprintf(fp,"\t\tDataVector[%d] = %f\n",j,v.at( j )->getFloat());
       	}
+    	for( uint32 j=0; j<p->channels.size(); j++ ){
+			fprintf(fp,"\t\tDataVector[%d] = %f\n",j,p->channels.getFloat( j ));
+      	}
     }  
     
     for ( uint32 i=0; i<dataVector.size(); i++ ) {
     	fprintf(fp,"\tDataVector[%d] = %f\n",i,dataVector.at( i )->getFloat());
     }
+    for ( uint32 i=0; i<channels.size(); i++ ) {
+    	fprintf(fp,"\tDataVector[%d] = %f\n",i,channels.getFloat( i ));
+    }
     fclose( fp );
 }
 
@@ -329,11 +491,25 @@ DataPacket *DataPacket::clone( vector<unsigned> channels ){
 
 
 
+/// Append the content of Value \a v as a new channel of \a b.
+static void appendValue( ChannelBuffer &b, const Value *v )
+{
+  if( dynamic_cast<const IntValue *>( v ) ) {
+    b.appendInt( v->getInt(), v->isValid() );
+  }
+  else {
+    b.appendFloat( v->getFloat(), v->isValid() );
+  }
+}
+
+
+
 /**
  * All Values from packet p are moved (and appended) to this packet.
  * @note Packet p is empty after calling this method.
  * @note If the packet contains segmented data, the packet p must contain
  * segmented data of equal length in order to successfully merge the data
+ * @note If one of the packets uses typed storage, the result is typed.
  * @param[in] p DataPacket to move Values from.
  */
 void DataPacket::appendContentOf( DataPacket *p ){
@@ -354,6 +530,23 @@ void DataPacket::appendContentOf( DataPacket *p ){
       // no sync!
     }
   }
+  else if( isTyped() || p->isTyped() ){
+    // typed storage: convert whichever side is not typed yet
+    clearProxies();
+    p->clearProxies();
+    for( uint32 i=0; i<dataVector.size(); i++ ) {
+      appendValue( channels, dataVector[i] );
+      delete dataVector[i];
+    }
+    dataVector.clear();
+    channels.append( p->channels );
+    for( uint32 i=0; i<p->dataVector.size(); i++ ) {
+      appendValue( channels, p->dataVector[i] );
+      delete p->dataVector[i];
+    }
+    p->dataVector.clear();
+    p->channels.clear();
+  }
   else{
     for( uint32 i=0; i<p->dataVector.size(); i++ ) {
       dataVector.push_back( p->dataVector.at(i) );
@@ -373,6 +566,11 @@ void DataPacket::narrowData( vector<unsigned> channels ){
       packetVector[i]->narrowData(channels);
     }
   }
+  // typed data
+  else if( isTyped() ){
+    clearProxies();
+    this->channels.select( channels );
+  }
   // normal data
   else{
     vector<Value*> keep;
@@ -400,12 +598,15 @@ void DataPacket::empty(){
     delete dataVector[i];
   }
   dataVector.clear();
+  clearProxies();
+  channels.clear();
   
   // segment data
   for ( uint32 i=0; i<packetVector.size(); i++ ){
     packetVector[i]->empty();
   }
   packetVector.clear();
+  window.clear();
 }
 
 
@@ -416,6 +617,7 @@ void DataPacket::invalidateValues(){
   for( uint32 i=0; i < dataVector.size(); i++ ) {
     dataVector.at( i )->invalidate();
   }
+  channels.invalidateAll();
 
   // segment data
   for ( uint32 i=0; i<packetVector.size(); i++ ){
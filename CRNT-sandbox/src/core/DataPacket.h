@@ -20,6 +20,8 @@
 
 #include "TBObject.h"
 #include "Value.h"
+#include "ChannelBuffer.h"
+#include "WindowView.h"
 #include "Mutex.h"
 #include "OutOfMemoryException.h"
 //TODO
@@ -49,6 +51,12 @@ typedef std::vector<Value*> ValueVect; // mk::2oo6o6o6
  * 
  * The channels in the payload may be accessed by the getChannel()
  * and setChannel() methods
+ *
+ * A packet stores its channels either as Value objects in the dataVector
+ * or, if created with the typed constructor, in the contiguous
+ * ChannelBuffer \a channels. getChannel() and setChannel() work for both
+ * representations; hot tasks can use isTyped() and getFloatChannels()
+ * to read typed packets as a plain float array.
  */
 class DataPacket: public TBObject
 {
@@ -56,12 +64,43 @@ class DataPacket: public TBObject
 		DataPacket( int streamId = -1 );
 		DataPacket( const DataPacket &p );
 		DataPacket( DataPacket &p, std::vector<unsigned> channels );
+
+		/**
+		 * @brief Create a packet with typed channel storage.
+		 * @param streamId Stream identifier.
+		 * @param numChannels Number of channels (initialized to zero).
+		 * @param type Type of the channels.
+		 */
+		DataPacket( int streamId, unsigned int numChannels, ChannelBuffer::Type type );
 		virtual ~DataPacket();
 
+		/// Packets are allocated from the PacketPool.
+		static void *operator new( size_t size );
+		static void operator delete( void *p, size_t size );
+
+		/**
+		 * \brief Preallocate pool memory.
+		 *
+		 * Fills the PacketPool with blocks for \p packets data packets
+		 * carrying \p channels channels each (as Values or typed storage).
+		 * \see StreamTask::start()
+		 */
+		static void reservePool( unsigned int packets, unsigned int channels );
+
 		/**
-		 * @brief Time of creation.
+		 * @brief Time of creation (wall clock, for display).
+		 * @note Derived from timestampNs, it is not updated if
+		 * timestampNs is changed. Use setTimestamp() to set both.
 		 */
 		struct timeval timestamp;
+
+		/**
+		 * @brief Time of creation in monotonic nanoseconds (see Clock).
+		 *
+		 * Use this for measuring intervals, it is not affected by
+		 * changes of the system time.
+		 */
+		unsigned long long timestampNs;
 		
 		/**
 		 * @brief Sequence number.
@@ -77,11 +116,30 @@ class DataPacket: public TBObject
 		 * @brief Payload of the packet. The "channels".
 		 */
 		std::vector< Value* > dataVector;
+
+		/**
+		 * @brief Typed payload of the packet (used instead of dataVector).
+		 * @see isTyped()
+		 */
+		ChannelBuffer channels;
 		
 		/** 
 		 * @brief Payload of a "super packet".
 		 */
 		std::vector< DataPacket* > packetVector; // super packet // tm, mk
+
+		/**
+		 * @brief Samples of a window packet (see HistoryRing).
+		 *
+		 * Replaces packetVector for windows that overlap: the samples are
+		 * shared with the other windows instead of being cloned.
+		 * Copies of the packet share the view.
+		 *
+		 * \note The window exists in-process only. The encoders and
+		 * writers (BinaryEncoder, DeltaEncoder, RecordingWriter, ShmRing,
+		 * UdpWriter) serialize the channels only, see checkSerializable().
+		 */
+		WindowView window;
 		
 		
 		
@@ -109,9 +167,47 @@ class DataPacket: public TBObject
 		
 		/**
 		 * @brief Get the number of channels contained by this data packet.
-		 * @return Size of dataVector (number of channels).
+		 * @return Size of dataVector or channels (number of channels).
 		 */
 		unsigned long int size() const;
+
+		/**
+		 * @brief Check if the channels are stored in the ChannelBuffer.
+		 * @return \c true if \a channels is used instead of \a dataVector.
+		 */
+		bool isTyped() const { return !channels.empty(); }
+
+		/**
+		 * @brief Direct read access to the channels of a typed packet.
+		 * @return Pointer to the first channel, or NULL if the packet is not
+		 * typed or not all channels are of type ChannelBuffer::FLOAT.
+		 */
+		const float *getFloatChannels() const;
+
+		/**
+		 * @brief Direct write access to the channels of a typed packet.
+		 * @see getFloatChannels()
+		 */
+		float *editFloatChannels();
+
+		/**
+		 * @brief Get the channels as typed storage (e.g. for serialization).
+		 * @param tmp Receives the converted channels if the packet is not typed.
+		 * @return \a channels of a typed packet, otherwise \p tmp.
+		 */
+		const ChannelBuffer &getTypedChannels( ChannelBuffer &tmp ) const;
+
+		/**
+		 * @brief Called by serializers, which only write the channels.
+		 * @note Logs a warning (once per process) if the packet has a
+		 * non-empty \a window, as it is lost on serialization.
+		 */
+		void checkSerializable() const
+		{
+			if( !window.empty() ) {
+				reportWindowLost();
+			}
+		}
 		
 		/**
 		 * \brief Set the ID of the stream this packet is belonging to.
@@ -136,10 +232,23 @@ class DataPacket: public TBObject
 		
 		/**
 		 * \brief Set the timestamp from a decimal value.
-		 * \note For more precise timestamps set the timestamp member variable directly.
+		 * \note timestampNs is updated too, see setTimestamp().
 		 * \param seconds Timestamp in seconds.
+		 * \param relative \p seconds is a relative time, see setTimestamp().
+		 */
+		void setTimestampSec(double seconds, bool relative = false);
+
+		/**
+		 * \brief Set the timestamp and timestampNs consistently.
+		 *
+		 * \param tv The time stamp.
+		 * \param relative If \c false, \p tv is wall clock time and converted
+		 * with Clock::fromTimeval(). If \c true, \p tv is a relative time
+		 * (e.g. of a file that starts at 0) and timestampNs holds the same
+		 * time in nanoseconds, so intervals between packets are kept; it
+		 * cannot be compared with monotonic time stamps then.
 		 */
-		void setTimestampSec(double seconds);
+		void setTimestamp( const struct timeval &tv, bool relative );
 		
 		
 		virtual void toString( std::ostream &o );		///< Print object to stream o.
@@ -215,6 +324,15 @@ class DataPacket: public TBObject
 		
 		static Mutex mutex;
 		static std::vector<Value> streamDescs;
+
+		/**
+		 * \brief Value objects handed out by getChannel() for typed packets.
+		 * \note They are deleted when the channel layout changes.
+		 */
+		mutable std::vector<Value*> channelProxies;
+		void clearProxies();
+
+		void reportWindowLost() const;
 };
 
 
@@ -68,6 +68,15 @@ class Encoder : public TBObject
 		 * @note init() must be called first.
 		 */
 		virtual int encode( const DataPacket *p, unsigned char *buf, unsigned int size ) = 0;
+
+		/// Get the buffer size encode() needs for a data packet.
+		/**
+		 * Writers use it to tell a buffer that is too small from a packet
+		 * that cannot be encoded.
+		 * @param[in] p Data packet to be encoded.
+		 * @returns Upper bound of the encoded length of 'p', or 0 if unknown.
+		 */
+		virtual unsigned int getEncodedSizeBound( const DataPacket *p ) const { return 0; }
 		
 		/// Get the footer bytes.
 		/**
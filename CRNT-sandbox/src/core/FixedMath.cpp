@@ -0,0 +1,349 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// FixedMath.cpp
+
+#include "FixedMath.h"
+#include "ChannelLoops.h"
+#include <cmath>
+
+
+/*
+ * Lookup tables, filled during static initialization
+ */
+
+static const unsigned int SIN_BITS = 10;		///< log2 of the sine table size (one period)
+
+static struct FixedTables {
+	int32 sqrtTab[257];		///< sqrt(i * 2^24) * 2^8
+	int32 log2Tab[257];		///< log2(1 + i / 256) * 2^16
+	int32 sinTab[(1 << SIN_BITS) + 1];	///< sin(2 pi i / 1024) * 2^16
+
+	FixedTables()
+	{
+		for( int i = 0; i <= 256; i++ ) {
+			sqrtTab[i] = (int32)floor( ::sqrt( i * 16777216.0 ) * 256 + 0.5 );
+			log2Tab[i] = (int32)floor( ::log2( 1 + i / 256.0 ) * 65536 + 0.5 );
+		}
+		for( int i = 0; i <= 1 << SIN_BITS; i++ ) {
+			sinTab[i] = (int32)floor( ::sin( 2 * M_PI * i / (1 << SIN_BITS) ) * 65536 + 0.5 );
+		}
+	}
+} tables;
+
+
+/// Linear interpolation between t[i] and t[i + 1], \p frac in 1/65536, rounded.
+static inline int32 interpolate( const int32 *t, uint32 i, uint32 frac )
+{
+	return t[i] + (int32)(((long long)(t[i + 1] - t[i]) * frac + 0x8000) >> 16);
+}
+
+
+/**
+ * Shifts \p x left by an even number of bits into [2^30, 2^32). The table
+ * gives the square root of that with 8 fractional bits, which is shifted
+ * back by half the normalization: sqrt(x / 2^16) * 2^16 = sqrt(x) * 2^8.
+ * One Newton step on sqrt(x * 2^16) removes the interpolation error.
+ */
+fix FixedMath::sqrt( fix x )
+{
+	if( x <= 0 ) {
+		return 0;
+	}
+	unsigned int s = __builtin_clz( (uint32)x ) & ~1u;
+	uint32 m = (uint32)x << s;
+	uint32 v = interpolate( tables.sqrtTab, m >> 24, (m >> 8) & 0xffff );
+	s /= 2;
+	unsigned long long r = s ? (v + (1u << (s - 1))) >> s : v;
+	r = (r + (((unsigned long long)x << 16) + r / 2) / r) / 2;
+	return (fix)r;
+}
+
+
+/// The exponent comes from the leading zeros, the table covers the mantissa in [1, 2).
+fix FixedMath::log2( fix x )
+{
+	if( x <= 0 ) {
+		return FIX_MIN;
+	}
+	int lz = __builtin_clz( (uint32)x );
+	uint32 m = (uint32)x << lz;
+	return (15 - lz) * 65536 + interpolate( tables.log2Tab, (m >> 23) & 255, (m >> 7) & 0xffff );
+}
+
+
+/// \p phase is the angle in 1/2^32 of a full turn.
+fix FixedMath::sinPhase( uint32 phase )
+{
+	return interpolate( tables.sinTab, phase >> (32 - SIN_BITS), (phase >> (16 - SIN_BITS)) & 0xffff );
+}
+
+
+/**
+ * 2^32 / (2 pi) = 683565275.5764316 in two parts: the integer and 16 bits
+ * of the fraction. Rounded to an integer, the constant would shift the
+ * phase by up to 2^-17 turns for the largest arguments.
+ */
+static const long long TURNS_PER_RADIAN = 683565275LL;
+static const long long TURNS_PER_RADIAN_FRAC = 37777LL;	///< in 1/65536
+
+
+/// Radians in Q16.16 to the phase in 1/2^32 turns (modulo one turn).
+static inline uint32 toPhase( fix x )
+{
+	return (uint32)(((long long)x * TURNS_PER_RADIAN + (((long long)x * TURNS_PER_RADIAN_FRAC) >> 16)) >> 16);
+}
+
+
+fix FixedMath::sin( fix x )
+{
+	return sinPhase( toPhase( x ) );
+}
+
+
+fix FixedMath::cos( fix x )
+{
+	return sinPhase( toPhase( x ) + (1u << 30) );
+}
+
+
+/*
+ * Operations, see ChannelLoops.h
+ */
+
+#ifdef CHANNELMATH_X86
+
+/// Select \p sat in the lanes where the sign bit of \p overflow is set.
+TARGET_SSE static inline __m128i saturateSse( __m128i r, __m128i a, __m128i overflow )
+{
+	__m128i sat = _mm_xor_si128( _mm_srai_epi32( a, 31 ), _mm_set1_epi32( FixedMath::FIX_MAX ) );
+	return _mm_blendv_epi8( r, sat, _mm_srai_epi32( overflow, 31 ) );
+}
+
+TARGET_AVX2 static inline __m256i saturateAvx( __m256i r, __m256i a, __m256i overflow )
+{
+	__m256i sat = _mm256_xor_si256( _mm256_srai_epi32( a, 31 ), _mm256_set1_epi32( FixedMath::FIX_MAX ) );
+	return _mm256_blendv_epi8( r, sat, _mm256_srai_epi32( overflow, 31 ) );
+}
+
+/**
+ * The 64 bit products of the even and the odd lanes are clamped to the
+ * range whose bits 16..47 are a valid result, so taking these bits equals
+ * the saturated arithmetic shift.
+ */
+static const long long PRODUCT_MAX = 0x00007fffffffffffLL;
+static const long long PRODUCT_MIN = -0x0000800000000000LL;
+
+TARGET_SSE static inline __m128i clampProductSse( __m128i p )
+{
+	__m128i hi = _mm_set1_epi64x( PRODUCT_MAX ), lo = _mm_set1_epi64x( PRODUCT_MIN );
+	p = _mm_blendv_epi8( p, hi, _mm_cmpgt_epi64( p, hi ) );
+	return _mm_blendv_epi8( p, lo, _mm_cmpgt_epi64( lo, p ) );
+}
+
+TARGET_AVX2 static inline __m256i clampProductAvx( __m256i p )
+{
+	__m256i hi = _mm256_set1_epi64x( PRODUCT_MAX ), lo = _mm256_set1_epi64x( PRODUCT_MIN );
+	p = _mm256_blendv_epi8( p, hi, _mm256_cmpgt_epi64( p, hi ) );
+	return _mm256_blendv_epi8( p, lo, _mm256_cmpgt_epi64( lo, p ) );
+}
+
+TARGET_SSE static inline __m128i mulSse( __m128i a, __m128i b )
+{
+	__m128i even = clampProductSse( _mm_mul_epi32( a, b ) );
+	__m128i odd = clampProductSse( _mm_mul_epi32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) ) );
+	return _mm_blend_epi16( _mm_srli_epi64( even, 16 ), _mm_slli_epi64( odd, 16 ), 0xcc );
+}
+
+TARGET_AVX2 static inline __m256i mulAvx( __m256i a, __m256i b )
+{
+	__m256i even = clampProductAvx( _mm256_mul_epi32( a, b ) );
+	__m256i odd = clampProductAvx( _mm256_mul_epi32( _mm256_srli_epi64( a, 32 ), _mm256_srli_epi64( b, 32 ) ) );
+	return _mm256_blend_epi32( _mm256_srli_epi64( even, 16 ), _mm256_slli_epi64( odd, 16 ), 0xaa );
+}
+
+#endif	//CHANNELMATH_X86
+
+
+namespace {
+
+struct AddFix {
+	fix scalar( fix a, fix b ) const { return FixedMath::add( a, b ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a, __m128i b ) const
+	{
+		__m128i s = _mm_add_epi32( a, b );
+		return saturateSse( s, a, _mm_and_si128( _mm_xor_si128( a, s ), _mm_xor_si128( b, s ) ) );
+	}
+	TARGET_AVX2 __m256i avx( __m256i a, __m256i b ) const
+	{
+		__m256i s = _mm256_add_epi32( a, b );
+		return saturateAvx( s, a, _mm256_and_si256( _mm256_xor_si256( a, s ), _mm256_xor_si256( b, s ) ) );
+	}
+#endif
+};
+
+struct SubFix {
+	fix scalar( fix a, fix b ) const { return FixedMath::subtract( a, b ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a, __m128i b ) const
+	{
+		__m128i s = _mm_sub_epi32( a, b );
+		return saturateSse( s, a, _mm_and_si128( _mm_xor_si128( a, b ), _mm_xor_si128( a, s ) ) );
+	}
+	TARGET_AVX2 __m256i avx( __m256i a, __m256i b ) const
+	{
+		__m256i s = _mm256_sub_epi32( a, b );
+		return saturateAvx( s, a, _mm256_and_si256( _mm256_xor_si256( a, b ), _mm256_xor_si256( a, s ) ) );
+	}
+#endif
+};
+
+struct MulFix {
+	fix scalar( fix a, fix b ) const { return FixedMath::multiply( a, b ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a, __m128i b ) const { return mulSse( a, b ); }
+	TARGET_AVX2 __m256i avx( __m256i a, __m256i b ) const { return mulAvx( a, b ); }
+#endif
+};
+
+struct ScaleFix {
+	fix c;
+	ScaleFix( fix c ) : c(c) {}
+	fix scalar( fix a ) const { return FixedMath::multiply( a, c ); }
+#ifdef CHANNELMATH_X86
+	TARGET_SSE __m128i sse( __m128i a ) const { return mulSse( a, _mm_set1_epi32( c ) ); }
+	TARGET_AVX2 __m256i avx( __m256i a ) const { return mulAvx( a, _mm256_set1_epi32( c ) ); }
+#endif
+};
+
+}	//namespace
+
+
+void FixedMath::add( fix *x, const fix *y, unsigned int n ) { binary( x, y, n, AddFix(), ChannelMath::getLevel() ); }
+void FixedMath::subtract( fix *x, const fix *y, unsigned int n ) { binary( x, y, n, SubFix(), ChannelMath::getLevel() ); }
+void FixedMath::multiply( fix *x, const fix *y, unsigned int n ) { binary( x, y, n, MulFix(), ChannelMath::getLevel() ); }
+void FixedMath::scale( fix *x, fix c, unsigned int n ) { unary( x, n, ScaleFix( c ), ChannelMath::getLevel() ); }
+
+
+#ifdef CHANNELMATH_X86
+
+TARGET_SSE static void macSse( fix *acc, const fix *x, const fix *y, unsigned int n )
+{
+	AddFix add;
+	unsigned int i = 0;
+	for( ; i + 4 <= n; i += 4 ) {
+		__m128i *p = (__m128i *)(acc + i);
+		__m128i m = mulSse( _mm_loadu_si128( (const __m128i *)(x + i) ), _mm_loadu_si128( (const __m128i *)(y + i) ) );
+		_mm_storeu_si128( p, add.sse( _mm_loadu_si128( p ), m ) );
+	}
+	for( ; i < n; i++ ) {
+		acc[i] = FixedMath::add( acc[i], FixedMath::multiply( x[i], y[i] ) );
+	}
+}
+
+TARGET_AVX2 static void macAvx2( fix *acc, const fix *x, const fix *y, unsigned int n )
+{
+	AddFix add;
+	unsigned int i = 0;
+	for( ; i + 8 <= n; i += 8 ) {
+		__m256i *p = (__m256i *)(acc + i);
+		__m256i m = mulAvx( _mm256_loadu_si256( (const __m256i *)(x + i) ), _mm256_loadu_si256( (const __m256i *)(y + i) ) );
+		_mm256_storeu_si256( p, add.avx( _mm256_loadu_si256( p ), m ) );
+	}
+	for( ; i < n; i++ ) {
+		acc[i] = FixedMath::add( acc[i], FixedMath::multiply( x[i], y[i] ) );
+	}
+}
+
+#endif	//CHANNELMATH_X86
+
+
+void FixedMath::mac( fix *acc, const fix *x, const fix *y, unsigned int n )
+{
+#ifdef CHANNELMATH_X86
+	if( ChannelMath::getLevel() == ChannelMath::AVX2 ) {
+		macAvx2( acc, x, y, n );
+		return;
+	}
+	if( ChannelMath::getLevel() == ChannelMath::SSE ) {
+		macSse( acc, x, y, n );
+		return;
+	}
+#endif
+	for( unsigned int i = 0; i < n; i++ ) {
+		acc[i] = add( acc[i], multiply( x[i], y[i] ) );
+	}
+}
+
+
+/*
+ * Table functions and conversions
+ */
+
+void FixedMath::sqrt( fix *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = sqrt( x[i] );
+	}
+}
+
+
+void FixedMath::log2( fix *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = log2( x[i] );
+	}
+}
+
+
+void FixedMath::sin( fix *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = sin( x[i] );
+	}
+}
+
+
+void FixedMath::cos( fix *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = cos( x[i] );
+	}
+}
+
+
+void FixedMath::fromFloat( fix *x, const float *f, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = fromFloat( f[i] );
+	}
+}
+
+
+void FixedMath::toFloat( float *f, const fix *x, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		f[i] = toFloat( x[i] );
+	}
+}
+
+
+void FixedMath::fromInt( fix *x, const int32 *k, unsigned int n )
+{
+	for( unsigned int i = 0; i < n; i++ ) {
+		x[i] = fromInt( k[i] );
+	}
+}
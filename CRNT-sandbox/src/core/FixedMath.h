@@ -0,0 +1,105 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// FixedMath.h - Q16.16 fixed-point kernels
+
+#ifndef FIXEDMATH_H
+#define FIXEDMATH_H
+
+#include "Value.h"
+
+
+/**
+ * \ingroup core
+ * \brief Saturating Q16.16 kernels over channel arrays.
+ *
+ * Works on the \c fix type of Value.h (binary point between bits 15 and
+ * 16) for processors without a fast floating point unit. Results that do
+ * not fit saturate at FIX_MAX and FIX_MIN instead of wrapping around.
+ * Products are rounded towards minus infinity.
+ *
+ * add, subtract, multiply, scale and mac (multiply-accumulate) use SSE4.2
+ * or AVX2 like ChannelMath (see ChannelMath::setLevel()). sqrt, log2, sin
+ * and cos interpolate in lookup tables and use integer instructions only
+ * (sqrt refines the result with one integer division). Their error is
+ * below 1.25 units of the last place over the whole range (measured: sin
+ * and cos 1.22, log2 1.03, sqrt 0.75).
+ *
+ * Tasks that support it (e.g. WindowStatistics) select the fixed-point
+ * path with StreamTask::setFixedPoint().
+ */
+class FixedMath
+{
+	public:
+		static const fix FIX_ONE = 1 << 16;		///< 1.0
+		static const fix FIX_MAX = 0x7fffffff;
+		static const fix FIX_MIN = -0x7fffffff - 1;
+
+		/// Convert to fix, truncating like FloatValue::getFix() but saturating.
+		static fix fromFloat( float f )
+		{
+			float s = f * 65536.0f;
+			if( s >= 2147483648.0f ) {
+				return FIX_MAX;
+			}
+			if( s < -2147483648.0f ) {
+				return FIX_MIN;
+			}
+			return s == s ? (fix)s : 0;
+		}
+
+		/// Convert to float.
+		static float toFloat( fix x ) { return x * (1.0f / 65536); }
+
+		/// Convert an int, saturating.
+		static fix fromInt( int32 k )
+		{
+			return k > 32767 ? FIX_MAX : (k < -32768 ? FIX_MIN : (fix)((uint32)k << 16));
+		}
+
+		static fix add( fix a, fix b ) { return saturate( (long long)a + b ); }
+		static fix subtract( fix a, fix b ) { return saturate( (long long)a - b ); }
+		static fix multiply( fix a, fix b ) { return saturate( ((long long)a * b) >> 16 ); }
+		static fix sqrt( fix x );		///< 0 for negative values.
+		static fix log2( fix x );		///< FIX_MIN for values <= 0.
+		static fix sin( fix x );		///< \p x in radians.
+		static fix cos( fix x );		///< \p x in radians.
+
+		static void fromFloat( fix *x, const float *f, unsigned int n );
+		static void toFloat( float *f, const fix *x, unsigned int n );
+		static void fromInt( fix *x, const int32 *k, unsigned int n );
+
+		static void add( fix *x, const fix *y, unsigned int n );			///< x += y
+		static void subtract( fix *x, const fix *y, unsigned int n );		///< x -= y
+		static void multiply( fix *x, const fix *y, unsigned int n );		///< x *= y
+		static void scale( fix *x, fix c, unsigned int n );					///< x *= c
+		static void mac( fix *acc, const fix *x, const fix *y, unsigned int n );	///< acc += x * y
+		static void sqrt( fix *x, unsigned int n );
+		static void log2( fix *x, unsigned int n );
+		static void sin( fix *x, unsigned int n );
+		static void cos( fix *x, unsigned int n );
+
+		/// Clamp a 64 bit intermediate result to the range of fix.
+		static fix saturate( long long v )
+		{
+			return v > FIX_MAX ? FIX_MAX : (v < FIX_MIN ? FIX_MIN : (fix)v);
+		}
+
+	private:
+		static fix sinPhase( uint32 phase );
+};
+
+
+#endif	//FIXEDMATH_H
@@ -39,7 +39,11 @@ int FloatValue::getInt() const
 float FloatValue::getFloat() const { return val; }
 fix FloatValue::getFix() const
 {
-	log( "getFix() WARNING: conversion float->fix" );
+	//report once, the conversion is usually done for every sample
+	static bool warned = false;
+	if( !__atomic_exchange_n( &warned, true, __ATOMIC_RELAXED ) ) {
+		log( "getFix() WARNING: conversion float->fix (reported once)" );
+	}
 	return (int)(val*65536);
 }
 void FloatValue::toString( std::ostream &o ) const { o << std::scientific << val; }
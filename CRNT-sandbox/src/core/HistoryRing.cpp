@@ -0,0 +1,125 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// HistoryRing.cpp
+
+#include "HistoryRing.h"
+#include "DataPacket.h"
+
+using namespace std;
+
+
+HistoryRing::HistoryRing( unsigned int channels, unsigned int history, unsigned int blockFrames ) :
+	channels(channels),
+	history(history > 0 ? history : 1),
+	blockFrames(blockFrames > 0 ? blockFrames : this->history),
+	count(0),
+	allocated(0),
+	spare(NULL),
+	sample(channels)
+{
+}
+
+
+HistoryRing::~HistoryRing()
+{
+	for( unsigned int i = 0; i < blocks.size(); i++ ) {
+		WindowView::releaseBlock( blocks[i] );
+	}
+	WindowView::releaseBlock( spare );
+}
+
+
+/// Retire the blocks that left the history and start a block for frame \a count.
+void HistoryRing::startBlock()
+{
+	//frames count - history + 1 ... count have to stay available
+	while( !blocks.empty() && count >= history
+			&& blocks.front()->first + blocks.front()->capacity <= count - history + 1 ) {
+		Block *b = blocks.front();
+		blocks.pop_front();
+		//only the ring references it: reuse it (views are not created concurrently)
+		if( !spare && __atomic_load_n( &b->refs, __ATOMIC_ACQUIRE ) == 1 ) {
+			spare = b;
+		}
+		else {
+			WindowView::releaseBlock( b );
+		}
+	}
+
+	Block *b = spare;
+	spare = NULL;
+	if( !b ) {
+		b = WindowView::allocBlock( channels, blockFrames );
+		allocated++;
+	}
+	b->first = count;
+	b->next = NULL;
+	if( !blocks.empty() ) {
+		blocks.back()->next = b;
+	}
+	blocks.push_back( b );
+}
+
+
+void HistoryRing::append( const float *values, unsigned long long seqNr, unsigned long long timestampNs )
+{
+	if( blocks.empty() || count == blocks.back()->first + blockFrames ) {
+		startBlock();
+	}
+	Block *b = blocks.back();
+	unsigned int k = count - b->first;
+	b->seqNrs()[k] = seqNr;
+	b->timestamps()[k] = timestampNs;
+	float *o = b->values() + k * channels;
+	for( unsigned int c = 0; c < channels; c++ ) {
+		o[c] = values[c];
+	}
+	count++;
+}
+
+
+void HistoryRing::append( const DataPacket *p )
+{
+	const float *x = p->size() == channels ? p->getFloatChannels() : NULL;
+	if( !x ) {
+		unsigned int n = p->size() < channels ? p->size() : channels;
+		for( unsigned int c = 0; c < channels; c++ ) {
+			sample[c] = c < n ? p->getChannel( c )->getFloat() : 0;
+		}
+		x = channels ? &sample[0] : NULL;
+	}
+	append( x, p->seqNr, p->timestampNs );
+}
+
+
+WindowView HistoryRing::view( unsigned long long first, unsigned int length ) const
+{
+	if( length == 0 || first + length > count || blocks.empty() || first < blocks.front()->first ) {
+		return WindowView();
+	}
+	unsigned long long offset = first - blocks.front()->first;
+	unsigned int i = offset / blockFrames;
+	return WindowView( blocks[i], offset % blockFrames, length );
+}
+
+
+WindowView HistoryRing::last( unsigned int length ) const
+{
+	if( length > count ) {
+		length = count;
+	}
+	return view( count - length, length );
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// HistoryRing.h - recent samples of a stream for overlapping windows
+
+#ifndef HISTORYRING_H
+#define HISTORYRING_H
+
+#include "WindowView.h"
+#include <deque>
+#include <vector>
+
+class DataPacket;
+
+
+/**
+ * \ingroup core
+ * \brief Keeps the last samples of a stream and hands out windows of them.
+ *
+ * Every appended sample becomes a frame (channels as floats, sequence
+ * number, time stamp). The frames are stored in blocks of \a blockFrames
+ * frames; the ring keeps enough blocks to hold the last \a history frames
+ * and hands out WindowView objects that reference them without copying.
+ *
+ * A block that leaves the history is reused for new frames if no view
+ * references it anymore, otherwise it is left to the views (and freed by
+ * the last one) and a new block is allocated. The memory in use is thus
+ * the history plus the blocks pinned by windows still in flight.
+ *
+ * The ring itself is not thread safe: one thread appends and creates the
+ * views. The views may be copied, read and released in any thread.
+ */
+class HistoryRing
+{
+	public:
+		/**
+		 * \param channels Channels per frame.
+		 * \param history Frames that can be viewed (the longest window).
+		 * \param blockFrames Frames per block, 0 for \p history.
+		 */
+		HistoryRing( unsigned int channels, unsigned int history, unsigned int blockFrames = 0 );
+		~HistoryRing();
+
+		/// Append a frame of getChannels() values.
+		void append( const float *values, unsigned long long seqNr, unsigned long long timestampNs );
+
+		/**
+		 * \brief Append the channels of \p p as a frame.
+		 * \note Missing channels are set to 0, surplus channels are ignored.
+		 */
+		void append( const DataPacket *p );
+
+		/// Number of frames appended so far.
+		unsigned long long getCount() const { return count; }
+
+		unsigned int getChannels() const { return channels; }
+		unsigned int getHistory() const { return history; }
+
+		/**
+		 * \brief View of frames \p first to \p first + \p length - 1.
+		 * \return An empty view if the frames are not (or no longer) available.
+		 */
+		WindowView view( unsigned long long first, unsigned int length ) const;
+
+		/// View of the last \p length frames (at most getHistory()).
+		WindowView last( unsigned int length ) const;
+
+		/// Number of blocks allocated so far (the rest were reused).
+		unsigned long long getBlocksAllocated() const { return allocated; }
+
+	private:
+		typedef WindowView::Block Block;
+
+		unsigned int channels;
+		unsigned int history;
+		unsigned int blockFrames;
+		unsigned long long count;
+		unsigned long long allocated;
+		std::deque<Block *> blocks;		///< Oldest first, each with one reference of the ring.
+		Block *spare;					///< A retired block without views.
+		std::vector<float> sample;
+
+		HistoryRing( const HistoryRing &r );
+		HistoryRing& operator=( const HistoryRing &r );
+
+		void startBlock();
+};
+
+
+#endif	//HISTORYRING_H
@@ -18,17 +18,21 @@
 
 #include "InPort.h"
 #include "StreamTask.h"
+#include "WaitSet.h"
+#include "TaskScheduler.h"
 #include <stdio.h>
+#include <string.h>
 
 using namespace std;
 
 
 
-InPort::InPort() : mutex(), condition(), owner(NULL)
+InPort::InPort() : mutex(), condition(), owner(NULL), waitSet(NULL), scheduler(NULL)
 {
 	maxQueueSize = 0; //infinite queue size
 	lossless = false;
 	droppedPackets = 0;
+	memset( &stats, 0, sizeof( stats ) );
 }
 
 
@@ -41,8 +45,11 @@ InPort::InPort( const InPort& p )
 	maxQueueSize = p.maxQueueSize;
 	lossless = p.lossless;
 	droppedPackets = p.droppedPackets;
+	memset( &stats, 0, sizeof( stats ) );
 	inPortID = -1;
 	owner = NULL;
+	waitSet = NULL;
+	scheduler = NULL;
 	// OAM REVISIT
 	errQueueCounter = 0;
 }
@@ -55,6 +62,36 @@ InPort::~InPort()
 int InPort::getInPortID() const { return inPortID; }
 unsigned int InPort::getMaxQueueSize() const { return maxQueueSize; }
 
+InPortStats InPort::getStats()
+{
+	mutex.lock();
+	InPortStats s = stats;
+	s.depth = packetQueue.size();
+	s.capacity = maxQueueSize;
+	mutex.unlock();
+	return s;
+}
+
+void InPort::setWaitSet( WaitSet *ws )
+{
+	waitSet = ws;
+}
+
+void InPort::setScheduler( TaskScheduler *s )
+{
+	scheduler = s;
+}
+
+void InPort::notifyReceiver()
+{
+	if( waitSet ) {
+		waitSet->notify();
+	}
+	if( scheduler && owner ) {
+		scheduler->schedule( owner );
+	}
+}
+
 void InPort::setInPortID( StreamTask *t, int i )
 {
 	owner = t;
@@ -91,13 +128,16 @@ void InPort::setLossless( bool flag )
 
 bool InPort::notEmpty()
 {
-	return !packetQueue.empty();
+	mutex.lock();
+	bool ret = !packetQueue.empty();
+	mutex.unlock();
+	return ret;
 }
 
 
 bool InPort::isEmpty()
 {
-	return packetQueue.empty();
+	return !notEmpty();
 }
 
 
@@ -106,30 +146,25 @@ DataPacket* InPort::receive( long timeout )
 	mutex.lock();
 	DataPacket *p = NULL;
 	try{
-		if( timeout > 0 && packetQueue.empty() ) {
-			
-			//create absolute timeout from relative time
-			struct timeval tv;
-			struct timespec ts;
-			gettimeofday( &tv, NULL );
-			ts.tv_sec = tv.tv_sec + timeout / 1000;;
-			ts.tv_nsec = tv.tv_usec * 1000 + (timeout % 1000) * 1000000;
-			if( ts.tv_nsec >= 1000000000 ) {
-				ts.tv_sec++;
-				ts.tv_nsec %= 1000000000;
+		if( packetQueue.empty() ) {
+			unsigned long long t0 = Metrics::nowNs();
+			if( timeout > 0 ) {
+				struct timespec ts;
+				Clock::absoluteTimeout( timeout, &ts );
+				condition.wait( &mutex, &ts );
 			}
-			
-			condition.wait( &mutex, &ts );
-		}
-		else {
-			while( packetQueue.empty() ) {
-				condition.wait( &mutex );	//mutex will be unlocked while waiting
+			else {
+				while( packetQueue.empty() ) {
+					condition.wait( &mutex );	//mutex will be unlocked while waiting
+				}
 			}
+			Metrics::add( &stats.waitNs, Metrics::nowNs() - t0 );
 		}
 		
 		if( !packetQueue.empty() ) {
 			p = packetQueue.front();
 			packetQueue.pop();
+			Metrics::add( &stats.received, 1 );
 		}
 	}
 	catch( char const* msg ) {
@@ -147,6 +182,9 @@ void InPort::cancel_receive()
 	mutex.lock();
 	condition.cancel();
 	mutex.unlock();
+	if( waitSet ) {
+		waitSet->cancel();
+	}
 	log("canceled.")
 		<< "\tpackets left in queue: " << packetQueue.size() << endl
 		<< "\tdropped packets since start: " << droppedPackets << endl;
@@ -157,43 +195,186 @@ void InPort::enqueue( DataPacket *p )
 {
 	mutex.lock();
 	
+	bool overrun = false;
 	if( lossless && maxQueueSize > 0 ) {
-		while( !(packetQueue.size() < maxQueueSize) ) {
-			condition.wait(&mutex);
+		try {
+			overrun = waitWhileFull();
+		}
+		catch( char const* msg ) {
+			//canceled by cancel_receive()
+			mutex.unlock();
+			delete p;
+			throw msg;
 		}
 	}
 	
-	if( maxQueueSize == 0 || packetQueue.size() < maxQueueSize ) {
+	if( overrun || maxQueueSize == 0 || packetQueue.size() < maxQueueSize ) {
 		packetQueue.push( p );
+		Metrics::add( &stats.enqueued, 1 );
+		Metrics::max( &stats.maxDepth, packetQueue.size() );
 		// OAM REVISIT
 		errQueueCounter = 0;
 	}
 	else {
-		//discard packet
-		if (!silent && !errQueueCounter) {
-			log( "maximal queue size reached" );
+		discard( p );
+	}
+	condition.signal();
+	mutex.unlock();
+	notifyReceiver();
+}
+
+
+/**
+ * Blocks a lossless sender as long as the queue is full. The mutex must
+ * be locked. A worker of the TaskScheduler does not sleep (the receiver
+ * may need the same worker) but runs other queued tasks. If there is
+ * nothing left to run, the receiver is blocked further down the stack of
+ * this worker, so the packet has to be queued beyond the limit.
+ *
+ * A scheduled or WaitSet receiver is notified before the sender blocks,
+ * it may not know yet about the packets of the current batch.
+ * @return \c true if the packet must be queued although the queue is full.
+ * @throws "condition canceled" if cancel_receive() was called (mutex locked).
+ */
+bool InPort::waitWhileFull()
+{
+	if( packetQueue.size() < maxQueueSize ) {
+		return false;
+	}
+	unsigned long long t0 = Metrics::nowNs();
+	bool overrun = false;
+	bool notified = false;
+	while( !(packetQueue.size() < maxQueueSize) ) {
+		condition.signal();
+		if( !notified ) {
+			mutex.unlock();
+			notifyReceiver();
+			mutex.lock();
+			notified = true;
+			continue;
 		}
-		else {
-			if (!silent && errQueueCounter % maxQueueSize == 0) {
-				log("Maximal queue size reached.") 
-					<< "  packets discarded: " << errQueueCounter << endl << endl;
+		if( TaskScheduler::isWorkerThread() ) {
+			mutex.unlock();
+			bool helped = TaskScheduler::helpOne();
+			mutex.lock();
+			if( !helped ) {
+				//the receiver waits further down this stack, the bound cannot hold
+				if( !stats.overruns && !silent ) {
+					log( "WARNING: lossless queue overrun by a scheduler worker, maximal size " ) << maxQueueSize << endl;
+				}
+				Metrics::add( &stats.overruns, 1 );
+				overrun = true;
+				break;
 			}
 		}
-		
-		// OAM REVISIT			
-		errQueueCounter++;
+		else {
+			condition.wait(&mutex);
+		}
+	}
+	Metrics::add( &stats.blockedNs, Metrics::nowNs() - t0 );
+	return overrun;
+}
+
+
+void InPort::discard( DataPacket *p )
+{
+	//discard packet
+	if (!silent && !errQueueCounter) {
+		log( "maximal queue size reached" );
+	}
+	else {
+		if (!silent && errQueueCounter % maxQueueSize == 0) {
+			log("Maximal queue size reached.") 
+				<< "  packets discarded: " << errQueueCounter << endl << endl;
+		}
+	}
+	
+	// OAM REVISIT			
+	errQueueCounter++;
 
 // mk			
 //			<< "[inport " << inPortID << "]"
 //			<< ", queuesize= " << maxQueueSize
 //			<< ", discarding packet:" << endl
 //			<< p << endl;
-			
-		delete p;
-		droppedPackets++;
+		
+	delete p;
+	droppedPackets++;
+	Metrics::add( &stats.dropped, 1 );
+}
+
+
+void InPort::enqueueBatch( const vector<DataPacket*> &packets )
+{
+	mutex.lock();
+	
+	for( unsigned int i = 0; i < packets.size(); i++ ) {
+		bool overrun = false;
+		if( lossless && maxQueueSize > 0 ) {
+			//let the receiver drain what we have pushed so far
+			try {
+				overrun = waitWhileFull();
+			}
+			catch( char const* msg ) {
+				//canceled by cancel_receive(), the packets not queued are deleted
+				mutex.unlock();
+				for( ; i < packets.size(); i++ ) {
+					delete packets[i];
+				}
+				throw msg;
+			}
+		}
+		
+		if( overrun || maxQueueSize == 0 || packetQueue.size() < maxQueueSize ) {
+			packetQueue.push( packets[i] );
+			Metrics::add( &stats.enqueued, 1 );
+			Metrics::max( &stats.maxDepth, packetQueue.size() );
+			errQueueCounter = 0;
+		}
+		else {
+			discard( packets[i] );
+		}
+	}
+	condition.signal();
+	mutex.unlock();
+	notifyReceiver();
+}
+
+
+unsigned int InPort::receiveBatch( vector<DataPacket*> &out, unsigned int maxN, long timeout )
+{
+	mutex.lock();
+	unsigned int n = 0;
+	try{
+		if( packetQueue.empty() ) {
+			unsigned long long t0 = Metrics::nowNs();
+			if( timeout > 0 ) {
+				struct timespec ts;
+				Clock::absoluteTimeout( timeout, &ts );
+				condition.wait( &mutex, &ts );
+			}
+			else {
+				while( packetQueue.empty() ) {
+					condition.wait( &mutex );	//mutex will be unlocked while waiting
+				}
+			}
+			Metrics::add( &stats.waitNs, Metrics::nowNs() - t0 );
+		}
+		
+		while( n < maxN && !packetQueue.empty() ) {
+			out.push_back( packetQueue.front() );
+			packetQueue.pop();
+			n++;
+		}
+		Metrics::add( &stats.received, n );
+	}
+	catch( char const* msg ) {
+		mutex.unlock();
+		throw msg;
 	}
 	condition.signal();
 	mutex.unlock();
+	return n;
 }
 
 
@@ -25,12 +25,16 @@
 #include "DataPacket.h"
 #include "Mutex.h"
 #include "Condition.h"
+#include "Metrics.h"
 //#include "StreamTask.h"
 
 #include <queue>
+#include <vector>
 
 //StreamTask-dummy
 class StreamTask;
+class WaitSet;
+class TaskScheduler;
 
 /**
  * \ingroup core
@@ -60,6 +64,23 @@ class InPort: public TBObject
 		 */
 		virtual DataPacket* receive( long timeout = 0 );
 
+		/**
+		 * \brief Pop several packets from the receive queue.
+		 *
+		 * Like receive() but takes up to \p maxN packets at once, with a
+		 * single lock acquisition and a single wakeup of a blocked sender.
+		 * The method blocks until at least one packet is available or the
+		 * timeout expired.
+		 *
+		 * \param[out] out The packets are appended to this vector.
+		 * \param maxN Maximal number of packets to take.
+		 * \param timeout Maximum time in milliseconds to wait for a packet
+		 * (zero waits infinitely).
+		 * \return Number of packets appended to \p out (zero on timeout).
+		 * \throws "condition canceled" if the method cancel_receive() was called.
+		 */
+		virtual unsigned int receiveBatch( std::vector<DataPacket*> &out, unsigned int maxN, long timeout = 0 );
+
 		/**
 		 * \brief Cancel a call of the receive() method.
 		 * 
@@ -81,6 +102,20 @@ class InPort: public TBObject
 		 * \param p The data packet to be enqueued.
 		 */
 		virtual void enqueue( DataPacket *p );
+
+		/**
+		 * \brief Push several packets to the receive queue.
+		 *
+		 * Same as calling enqueue() for every packet, but the queue is
+		 * locked only once and the receiver is woken up once (and before
+		 * a lossless sender blocks on the full queue).
+		 * This method is called from the OutPort::sendBatch() method.
+		 *
+		 * \param packets The data packets to be enqueued.
+		 * \throws "condition canceled" if a lossless sender is canceled by
+		 * cancel_receive(); the packets not queued are deleted.
+		 */
+		virtual void enqueueBatch( const std::vector<DataPacket*> &packets );
 		
 		/**
 		 * \brief Check if queue is not empty.
@@ -137,20 +172,62 @@ class InPort: public TBObject
 		 * In lossless mode the enqueue() method will block as long as
 		 * the queue is full, to ensure that no packet will be discarded.
 		 * (default: disabled)
+		 *
+		 * A sender that is a worker of the TaskScheduler runs other queued
+		 * tasks instead of blocking. If none is left, the receiver can only
+		 * run after this worker returns, so the packet is queued beyond the
+		 * maximal queue size: the bound does not hold for such senders.
 		 * \param flag desired state of lossless mode (enable/disable)
 		 * \see StreamTask::inPortLossless()
 		 */
 		virtual void setLossless( bool flag );
 
+		/**
+		 * \brief Get a snapshot of the counters of this in-port.
+		 *
+		 * The counters are always maintained; wait and block times are
+		 * only measured when a thread actually has to wait.
+		 */
+		virtual InPortStats getStats();
+
+		/**
+		 * \brief Attach this in-port to a WaitSet.
+		 *
+		 * The WaitSet is notified whenever packets are enqueued and
+		 * canceled by cancel_receive(). Called by WaitSet::addInPort().
+		 * \param ws The WaitSet or NULL to detach.
+		 */
+		virtual void setWaitSet( WaitSet *ws );
+
+		/**
+		 * \brief Let \p s schedule the owner task when packets arrive.
+		 *
+		 * Called by StreamTask::start() for scheduled tasks.
+		 * \param s The scheduler or NULL to disable.
+		 */
+		virtual void setScheduler( TaskScheduler *s );
+
 	protected:
+		/// Discard a packet because the queue is full (called by the sender).
+		void discard( DataPacket *p );
+
+		/// Wait until the queue is not full (lossless mode, mutex locked).
+		bool waitWhileFull();
+
+		/// Wake up the WaitSet or the scheduler of the receiver (if any).
+		void notifyReceiver();
+
 		Mutex mutex;
 		Condition condition;
 		std::queue<DataPacket *> packetQueue;
 		unsigned int maxQueueSize;
 		unsigned int droppedPackets;
+		InPortStats stats;
 		bool lossless;
 		bool silent;
 		StreamTask *owner;
+		WaitSet *waitSet;
+		TaskScheduler *scheduler;
 		int inPortID;
 		// OAM REVISIT
 		int errQueueCounter;
@@ -36,7 +36,11 @@ float IntValue::getFloat() const
 }
 fix IntValue::getFix() const
 {
-	log( "getFix() WARNING: conversion int->fix" );
+	//report once, the conversion is usually done for every sample
+	static bool warned = false;
+	if( !__atomic_exchange_n( &warned, true, __ATOMIC_RELAXED ) ) {
+		log( "getFix() WARNING: conversion int->fix (reported once)" );
+	}
 	return val<<16;
 }
 void IntValue::toString( std::ostream &o ) const { o << val; }
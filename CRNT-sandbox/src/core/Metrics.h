@@ -0,0 +1,108 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Metrics.h - runtime counters of ports and tasks
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include "Clock.h"
+
+
+/**
+ * \ingroup core
+ * \brief Counters of an in-port.
+ * \see InPort::getStats()
+ */
+struct InPortStats {
+	unsigned long long enqueued;	///< Packets put into the queue.
+	unsigned long long received;	///< Packets taken out by the task.
+	unsigned long long dropped;		///< Packets discarded because the queue was full.
+	unsigned long long overruns;	///< Packets queued beyond the maximal size by a lossless worker (see InPort::setLossless()).
+	unsigned int depth;				///< Current queue length.
+	unsigned int maxDepth;			///< Longest queue seen so far.
+	unsigned int capacity;			///< Maximal queue size (0 = infinite).
+	unsigned long long blockedNs;	///< Time lossless senders were blocked [ns].
+	unsigned long long waitNs;		///< Time the receiver waited for packets [ns].
+};
+
+
+/**
+ * \ingroup core
+ * \brief Counters of an out-port.
+ * \see OutPort::getStats()
+ */
+struct OutPortStats {
+	unsigned long long sent;		///< Packets sent (not counting clones).
+	unsigned int receivers;			///< Number of connected in-ports.
+};
+
+
+/**
+ * \ingroup core
+ * \brief Counters of a stream task and its ports.
+ * \see StreamTask::getStats()
+ */
+struct TaskStats {
+	std::string id;
+	std::string type;
+	bool running;
+	bool scheduled;
+	unsigned long long processCalls;	///< Calls of process() (scheduled tasks).
+	unsigned long long busyNs;			///< Time spent in process() [ns].
+	std::vector<InPortStats> inPorts;
+	std::vector<OutPortStats> outPorts;
+};
+
+
+/**
+ * \ingroup core
+ * \brief Helpers for updating the counters.
+ *
+ * Counters have a single writer (the sender or the receiver of a port, or
+ * a thread holding the port mutex), so they are updated with plain atomic
+ * stores and can be read at any time without a lock.
+ */
+class Metrics
+{
+	public:
+		/// Monotonic time in nanoseconds.
+		static unsigned long long nowNs() { return Clock::nowNs(); }
+
+		/// Add \p d to counter \p c (single writer).
+		static void add( unsigned long long *c, unsigned long long d )
+		{
+			__atomic_store_n( c, *c + d, __ATOMIC_RELAXED );
+		}
+
+		/// Raise \p m to \p v (single writer).
+		static void max( unsigned int *m, unsigned int v )
+		{
+			if( v > *m ) {
+				__atomic_store_n( m, v, __ATOMIC_RELAXED );
+			}
+		}
+
+		/// Read a counter.
+		static unsigned long long get( const unsigned long long *c )
+		{
+			return __atomic_load_n( c, __ATOMIC_RELAXED );
+		}
+};
+
+
+#endif	//METRICS_H
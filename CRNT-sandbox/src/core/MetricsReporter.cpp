@@ -0,0 +1,297 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// MetricsReporter.cpp
+
+#include "MetricsReporter.h"
+#include "StreamTask.h"
+#include "Clock.h"
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <stdio.h>
+#include <sys/time.h>
+
+using namespace std;
+
+
+/// Quote a string for JSON.
+static string jsonString( const string &s )
+{
+	string out = "\"";
+	for( unsigned int i = 0; i < s.size(); i++ ) {
+		char c = s[i];
+		if( c == '"' || c == '\\' ) {
+			out += '\\';
+			out += c;
+		}
+		else if( (unsigned char)c < 0x20 ) {
+			char buf[8];
+			sprintf( buf, "\\u%04x", c );
+			out += buf;
+		}
+		else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+
+MetricsReporter::MetricsReporter( long p, Format f, const string &fileName ) :
+	period(p), format(f), file(fileName), lastTime(Metrics::nowNs())
+{
+	setId( "MetricsReporter" );
+}
+
+
+MetricsReporter::~MetricsReporter()
+{
+	stop();
+}
+
+
+void MetricsReporter::addTask( StreamTask *task )
+{
+	mutex.lock();
+	tasks.push_back( task );
+	last.push_back( task->getStats() );
+	mutex.unlock();
+}
+
+
+void MetricsReporter::start()
+{
+	init();
+}
+
+
+void MetricsReporter::stop()
+{
+	if( isInitialized() ) {
+		exitNow();
+		mutex.lock();
+		condition.signal();
+		mutex.unlock();
+		joinMe();
+	}
+}
+
+
+string MetricsReporter::identify()
+{
+	return getId();
+}
+
+
+void MetricsReporter::run()
+{
+	while( !exiting() ) {
+		struct timespec ts;
+		Clock::absoluteTimeout( period, &ts );
+		mutex.lock();
+		if( !exiting() ) {
+			condition.wait( &mutex, &ts );
+		}
+		mutex.unlock();
+
+		if( !exiting() ) {
+			output( report() );
+		}
+	}
+}
+
+
+string MetricsReporter::report()
+{
+	mutex.lock();
+	unsigned long long now = Metrics::nowNs();
+	double elapsed = (now - lastTime) * 1e-9;
+	double elapsedNs = elapsed > 0 ? (now - lastTime) : 1;
+	if( elapsed <= 0 ) {
+		elapsed = 1e-9;
+	}
+
+	vector<TaskStats> stats;
+	vector<Rates> rates;
+	for( unsigned int i = 0; i < tasks.size(); i++ ) {
+		TaskStats s = tasks[i]->getStats();
+		const TaskStats &p = last[i];
+		Rates r;
+		unsigned long long received = 0, wait = 0, blocked = 0;
+		r.congested = false;
+		for( unsigned int k = 0; k < s.inPorts.size(); k++ ) {
+			const InPortStats &in = s.inPorts[k];
+			received += in.received;
+			wait += in.waitNs;
+			blocked += in.blockedNs;
+			if( k < p.inPorts.size() ) {
+				received -= p.inPorts[k].received;
+				wait -= p.inPorts[k].waitNs;
+				blocked -= p.inPorts[k].blockedNs;
+				if( in.dropped > p.inPorts[k].dropped ) {
+					r.congested = true;
+				}
+			}
+			if( in.capacity > 0 && in.depth * 10 >= in.capacity * 9 ) {
+				r.congested = true;
+			}
+		}
+		r.packetsPerSec = received / elapsed;
+		r.waitPct = 100.0 * wait / elapsedNs / (s.inPorts.empty() ? 1 : s.inPorts.size());
+		r.blockPct = 100.0 * blocked / elapsedNs;
+		r.busyPct = 100.0 * (s.busyNs - p.busyNs) / elapsedNs;
+		stats.push_back( s );
+		rates.push_back( r );
+	}
+	last = stats;
+	lastTime = now;
+	mutex.unlock();
+
+	ostringstream o;
+	if( format == JSON ) {
+		writeJson( o, stats, rates );
+	}
+	else {
+		writeText( o, stats, rates );
+	}
+	return o.str();
+}
+
+
+void MetricsReporter::writeText( ostream &o, const vector<TaskStats> &stats, const vector<Rates> &rates )
+{
+	o << setw(22) << left << "task" << right
+	  << setw(11) << "pkt/s"
+	  << setw(7) << "queue"
+	  << setw(7) << "max"
+	  << setw(7) << "cap"
+	  << setw(9) << "dropped"
+	  << setw(7) << "wait%"
+	  << setw(8) << "block%"
+	  << setw(7) << "busy%" << endl;
+
+	o << fixed << setprecision(1);
+	for( unsigned int i = 0; i < stats.size(); i++ ) {
+		const TaskStats &s = stats[i];
+		unsigned int depth = 0, maxDepth = 0, capacity = 0;
+		unsigned long long dropped = 0;
+		for( unsigned int k = 0; k < s.inPorts.size(); k++ ) {
+			if( s.inPorts[k].depth >= depth ) {
+				depth = s.inPorts[k].depth;
+				capacity = s.inPorts[k].capacity;
+			}
+			if( s.inPorts[k].maxDepth > maxDepth ) {
+				maxDepth = s.inPorts[k].maxDepth;
+			}
+			dropped += s.inPorts[k].dropped;
+		}
+
+		string name = s.id.empty() ? s.type : s.id;
+		if( name.size() > 20 ) {
+			name = name.substr( 0, 20 );
+		}
+		o << (rates[i].congested ? '*' : ' ')
+		  << setw(21) << left << name << right
+		  << setw(11) << rates[i].packetsPerSec
+		  << setw(7) << depth
+		  << setw(7) << maxDepth
+		  << setw(7) << capacity
+		  << setw(9) << dropped
+		  << setw(7) << rates[i].waitPct
+		  << setw(8) << rates[i].blockPct;
+		if( s.scheduled ) {
+			o << setw(7) << rates[i].busyPct;
+		}
+		else {
+			o << setw(7) << "-";
+		}
+		o << endl;
+	}
+}
+
+
+void MetricsReporter::writeJson( ostream &o, const vector<TaskStats> &stats, const vector<Rates> &rates )
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+
+	o << "{\"time\":" << tv.tv_sec << "." << setw(3) << setfill('0') << tv.tv_usec / 1000
+	  << setfill(' ') << ",\"tasks\":[";
+	o << fixed << setprecision(1);
+	for( unsigned int i = 0; i < stats.size(); i++ ) {
+		const TaskStats &s = stats[i];
+		const Rates &r = rates[i];
+		o << (i ? "," : "") << "\n {"
+		  << "\"id\":" << jsonString( s.id )
+		  << ",\"type\":" << jsonString( s.type )
+		  << ",\"running\":" << (s.running ? "true" : "false")
+		  << ",\"scheduled\":" << (s.scheduled ? "true" : "false")
+		  << ",\"packetsPerSec\":" << r.packetsPerSec
+		  << ",\"waitPct\":" << r.waitPct
+		  << ",\"blockPct\":" << r.blockPct
+		  << ",\"busyPct\":" << r.busyPct
+		  << ",\"congested\":" << (r.congested ? "true" : "false")
+		  << ",\"processCalls\":" << s.processCalls
+		  << ",\"busyNs\":" << s.busyNs
+		  << ",\"inPorts\":[";
+		for( unsigned int k = 0; k < s.inPorts.size(); k++ ) {
+			const InPortStats &in = s.inPorts[k];
+			o << (k ? "," : "") << "{"
+			  << "\"enqueued\":" << in.enqueued
+			  << ",\"received\":" << in.received
+			  << ",\"dropped\":" << in.dropped
+			  << ",\"overruns\":" << in.overruns
+			  << ",\"depth\":" << in.depth
+			  << ",\"maxDepth\":" << in.maxDepth
+			  << ",\"capacity\":" << in.capacity
+			  << ",\"blockedNs\":" << in.blockedNs
+			  << ",\"waitNs\":" << in.waitNs << "}";
+		}
+		o << "],\"outPorts\":[";
+		for( unsigned int k = 0; k < s.outPorts.size(); k++ ) {
+			o << (k ? "," : "") << "{"
+			  << "\"sent\":" << s.outPorts[k].sent
+			  << ",\"receivers\":" << s.outPorts[k].receivers << "}";
+		}
+		o << "]}";
+	}
+	o << "\n]}" << endl;
+}
+
+
+/**
+ * Writes to the log or replaces the output file (write to a temporary
+ * file and rename it, so readers never see a partial report).
+ */
+void MetricsReporter::output( const string &text )
+{
+	if( file.empty() ) {
+		log( "metrics" ) << text << flush;
+		return;
+	}
+
+	string tmp = file + ".tmp";
+	ofstream f( tmp.c_str() );
+	if( !f.is_open() ) {
+		log( "ERROR: cannot open metrics file" ) << "\t" << tmp << endl;
+		return;
+	}
+	f << text;
+	f.close();
+	if( rename( tmp.c_str(), file.c_str() ) != 0 ) {
+		log( "ERROR: cannot rename metrics file" ) << "\t" << file << endl;
+	}
+}
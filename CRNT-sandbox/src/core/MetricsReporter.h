@@ -0,0 +1,116 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// MetricsReporter.h - periodic dump of task and port counters
+
+#ifndef METRICSREPORTER_H
+#define METRICSREPORTER_H
+
+#include "Thread.h"
+#include "Mutex.h"
+#include "Condition.h"
+#include "Metrics.h"
+#include <string>
+#include <vector>
+
+class StreamTask;
+
+
+/**
+ * \ingroup core
+ * \brief Periodically writes the counters of a set of tasks.
+ *
+ * Every period a snapshot of all registered tasks is taken (see
+ * StreamTask::getStats()) and rates are computed from the difference to
+ * the previous snapshot. The report is written to the log (TEXT) or to a
+ * file, which is replaced atomically each period so it can be watched.
+ *
+ * The text format has one line per task:
+ * \code
+ * task                     pkt/s  queue   max   cap  dropped  wait%  block%  busy%
+ * filter1                 1200.0     12    40   100        0   85.3     0.0    9.1
+ * \endcode
+ * \c pkt/s counts packets taken from the in-ports, \c queue and \c max are
+ * the longest current and maximal queue of the in-ports, \c wait% is the
+ * time the task waited for input, \c block% the time lossless senders were
+ * blocked by its full in-ports and \c busy% the time in process()
+ * (scheduled tasks only). Tasks with a nearly full in-port or new drops
+ * are marked with '*': look for the first marked task downstream.
+ *
+ * The JSON format contains the raw counters of every port plus the rates.
+ */
+class MetricsReporter : public Thread
+{
+	public:
+		/// Output formats.
+		enum Format {
+			TEXT,
+			JSON
+		};
+
+		/**
+		 * \param period Report interval in milliseconds.
+		 * \param format Output format.
+		 * \param file Output file; empty writes to the log.
+		 */
+		MetricsReporter( long period = 1000, Format format = TEXT, const std::string &file = "" );
+		virtual ~MetricsReporter();
+
+		/// Add a task to the report.
+		void addTask( StreamTask *task );
+
+		/// Start reporting in a background thread.
+		void start();
+
+		/// Stop the background thread.
+		void stop();
+
+		/**
+		 * \brief Take a snapshot now and format it.
+		 *
+		 * Rates are computed relative to the previous call (or to the
+		 * start of the reporter).
+		 */
+		std::string report();
+
+		void run();
+		std::string identify();
+
+	private:
+		/// Values derived from two snapshots.
+		struct Rates {
+			double packetsPerSec;
+			double waitPct;
+			double blockPct;
+			double busyPct;
+			bool congested;
+		};
+
+		void writeText( std::ostream &o, const std::vector<TaskStats> &stats, const std::vector<Rates> &rates );
+		void writeJson( std::ostream &o, const std::vector<TaskStats> &stats, const std::vector<Rates> &rates );
+		void output( const std::string &text );
+
+		long period;
+		Format format;
+		std::string file;
+		std::vector<StreamTask *> tasks;
+		std::vector<TaskStats> last;
+		unsigned long long lastTime;
+		Mutex mutex;
+		Condition condition;
+};
+
+
+#endif	//METRICSREPORTER_H
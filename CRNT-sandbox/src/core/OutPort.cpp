@@ -26,14 +26,14 @@ using namespace std;
 
 
 OutPort::OutPort()
-: owner(NULL)
+: owner(NULL), sentPackets(0)
 {
 	receivers.clear();
 }
 
 
 OutPort::OutPort( const OutPort& p )
-: receivers(p.receivers), owner(NULL)
+: receivers(p.receivers), owner(NULL), sentPackets(0)
 {
 }
 
@@ -60,6 +60,8 @@ void OutPort::setOutPortID( StreamTask *t, int i )
  * Sends the data packet to all connected in-ports.
  * The packet will be cloned if more than one in-port
  * is connected such that every task will get separate copy.
+ * The channels of typed packets are not copied but shared until a
+ * receiver modifies them (see ChannelBuffer).
  * 
  * @note The calling thread must not access the DataPacket p
  * anymore after calling this method. Therefore the pointer
@@ -69,6 +71,7 @@ void OutPort::setOutPortID( StreamTask *t, int i )
  */
 void OutPort::send( DataPacket *p )
 {
+	Metrics::add( &sentPackets, 1 );
 	if( receivers.empty() ) {
 		log( "send(): no receivers registered, discarding packet:" )
 			<< "[outport " << outPortID << "]" << endl
@@ -88,6 +91,54 @@ void OutPort::send( DataPacket *p )
 }
 
 
+/**
+ * Sends the data packets to all connected in-ports, handing them over
+ * with a single InPort::enqueueBatch() call per receiver.
+ * Packets are cloned for additional receivers as in send().
+ *
+ * @note The packets are owned by the receivers after the call.
+ * The vector \p packets is cleared.
+ *
+ * @param packets The data packets to send.
+ */
+void OutPort::sendBatch( vector<DataPacket *> &packets )
+{
+	if( packets.empty() ) {
+		return;
+	}
+	Metrics::add( &sentPackets, packets.size() );
+	if( receivers.empty() ) {
+		log( "sendBatch(): no receivers registered, discarding packets:" )
+			<< "[outport " << outPortID << "] " << packets.size() << endl;
+		for( unsigned int i = 0; i < packets.size(); i++ ) {
+			delete packets[i];
+		}
+	}
+	else {
+		//process receivers backwards
+		vector<DataPacket *> copies;
+		copies.reserve( packets.size() );
+		for( unsigned int i = receivers.size()-1; i > 0; i-- ) {
+			copies.clear();
+			for( unsigned int k = 0; k < packets.size(); k++ ) {
+				copies.push_back( packets[k]->clone() );
+			}
+			receivers[i]->enqueueBatch( copies );
+		}
+		//first receiver gets original packets
+		try {
+			receivers[0]->enqueueBatch( packets );
+		}
+		catch( char const* msg ) {
+			//the in-port queued or deleted all of them
+			packets.clear();
+			throw msg;
+		}
+	}
+	packets.clear();
+}
+
+
 /**
  * Connects an in-port to this object.
  * It's not secure to use this method after the toolbox
@@ -128,3 +179,10 @@ void OutPort::disconnect( InPort *port )
 }
 
 
+OutPortStats OutPort::getStats() const
+{
+	OutPortStats s;
+	s.sent = Metrics::get( &sentPackets );
+	s.receivers = receivers.size();
+	return s;
+}
@@ -50,17 +50,30 @@ class OutPort: public TBObject
 
 		/// Send packet to connected in-ports.
 		virtual void send( DataPacket *p );
+
+		/**
+		 * \brief Send several packets to connected in-ports at once.
+		 *
+		 * \p packets is cleared. If a lossless in-port throws "condition
+		 * canceled", \p packets holds the packets still owned by the caller
+		 * (none, if it was the first in-port).
+		 */
+		virtual void sendBatch( std::vector<DataPacket *> &packets );
 		
 		/// Connect an in-port.
 		virtual void connect( InPort *port );
 		
 		/// Disconnect an in-port.
 		virtual void disconnect( InPort *port );
+
+		/// Get a snapshot of the counters of this out-port.
+		virtual OutPortStats getStats() const;
 	
 	protected:
 		std::vector<InPort *> receivers;
 		StreamTask *owner;
 		int outPortID;
+		unsigned long long sentPackets;
 };
 	
 
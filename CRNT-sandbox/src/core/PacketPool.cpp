@@ -0,0 +1,299 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// PacketPool.cpp
+
+#include "PacketPool.h"
+#include "OutOfMemoryException.h"
+#include "Metrics.h"
+#include <stdlib.h>
+#include <new>
+
+using namespace std;
+
+
+static const unsigned int NUM_CLASSES = PacketPool::MAX_BLOCK_SIZE / 16;
+
+/// Size class of a request (0 for 1..16 bytes, 1 for 17..32 bytes, ...)
+static inline unsigned int sizeClass( size_t size )
+{
+	return size ? (unsigned int)((size - 1) >> 4) : 0;
+}
+
+/// A free block is linked to the next one through its first word.
+static inline void *&nextBlock( void *block )
+{
+	return *static_cast<void **>(block);
+}
+
+
+/// Per-thread free lists and counters.
+struct PacketPool::ThreadCache {
+	void *head[NUM_CLASSES];
+	unsigned int count[NUM_CLASSES];
+	unsigned long long hits;			///< Written by the owning thread only (Metrics::add()).
+	unsigned long long misses;
+	unsigned long long releases;
+	ThreadCache *prev;
+	ThreadCache *next;
+};
+
+
+Mutex PacketPool::mutex;
+PacketPool::ThreadCache *PacketPool::caches = NULL;
+
+// depot and counters of exited threads, protected by PacketPool::mutex
+static void *depotHead[NUM_CLASSES];
+static unsigned int depotCount[NUM_CLASSES];
+static unsigned long long retiredHits = 0;
+static unsigned long long retiredMisses = 0;
+static unsigned long long retiredReleases = 0;
+
+static pthread_key_t cacheKey;
+static pthread_once_t cacheKeyOnce = PTHREAD_ONCE_INIT;
+
+
+void PacketPool::createKey()
+{
+	pthread_key_create( &cacheKey, PacketPool::destroyThreadCache );
+}
+
+
+PacketPool::ThreadCache *PacketPool::getThreadCache()
+{
+	pthread_once( &cacheKeyOnce, PacketPool::createKey );
+	ThreadCache *tc = static_cast<ThreadCache *>( pthread_getspecific( cacheKey ) );
+	if( tc ) {
+		return tc;
+	}
+
+	tc = static_cast<ThreadCache *>( calloc( 1, sizeof( ThreadCache ) ) );
+	if( !tc ) {
+		throw OutOfMemoryException();
+	}
+	mutex.lock();
+	tc->next = caches;
+	if( caches ) {
+		caches->prev = tc;
+	}
+	caches = tc;
+	mutex.unlock();
+	pthread_setspecific( cacheKey, tc );
+	return tc;
+}
+
+
+/**
+ * Called on thread exit (pthread key destructor). All free blocks of the
+ * exiting thread are moved to the depot and its counters are retired.
+ */
+void PacketPool::destroyThreadCache( void *cache )
+{
+	ThreadCache *tc = static_cast<ThreadCache *>( cache );
+
+	for( unsigned int cls = 0; cls < NUM_CLASSES; cls++ ) {
+		if( tc->count[cls] ) {
+			pushDepot( cls, tc->head[cls], tc->count[cls] );
+		}
+	}
+
+	mutex.lock();
+	retiredHits += tc->hits;
+	retiredMisses += tc->misses;
+	retiredReleases += tc->releases;
+	if( tc->prev ) {
+		tc->prev->next = tc->next;
+	}
+	else {
+		caches = tc->next;
+	}
+	if( tc->next ) {
+		tc->next->prev = tc->prev;
+	}
+	mutex.unlock();
+
+	free( tc );
+}
+
+
+/**
+ * Appends the chain of \p count blocks starting at \p head to the depot.
+ */
+void PacketPool::pushDepot( unsigned int cls, void *head, unsigned int count )
+{
+	void *tail = head;
+	for( unsigned int i = 1; i < count; i++ ) {
+		tail = nextBlock( tail );
+	}
+
+	mutex.lock();
+	nextBlock( tail ) = depotHead[cls];
+	depotHead[cls] = head;
+	depotCount[cls] += count;
+	mutex.unlock();
+}
+
+
+/**
+ * Takes up to BATCH_SIZE blocks from the depot.
+ * @return Number of blocks stored in \p head.
+ */
+unsigned int PacketPool::popDepot( unsigned int cls, void **head )
+{
+	mutex.lock();
+	unsigned int n = depotCount[cls] < BATCH_SIZE ? depotCount[cls] : BATCH_SIZE;
+	if( n ) {
+		void *first = depotHead[cls];
+		void *last = first;
+		for( unsigned int i = 1; i < n; i++ ) {
+			last = nextBlock( last );
+		}
+		depotHead[cls] = nextBlock( last );
+		depotCount[cls] -= n;
+		nextBlock( last ) = NULL;
+		*head = first;
+	}
+	mutex.unlock();
+	return n;
+}
+
+
+void *PacketPool::allocate( size_t size )
+{
+	if( size > MAX_BLOCK_SIZE ) {
+		return ::operator new( size );
+	}
+
+	unsigned int cls = sizeClass( size );
+	ThreadCache *tc = getThreadCache();
+
+	if( !tc->count[cls] ) {
+		tc->count[cls] = popDepot( cls, &tc->head[cls] );
+	}
+
+	if( tc->count[cls] ) {
+		void *block = tc->head[cls];
+		tc->head[cls] = nextBlock( block );
+		tc->count[cls]--;
+		Metrics::add( &tc->hits, 1 );
+		return block;
+	}
+
+	Metrics::add( &tc->misses, 1 );
+	void *block = malloc( (cls + 1) << 4 );
+	if( !block ) {
+		throw OutOfMemoryException();
+	}
+	return block;
+}
+
+
+void PacketPool::release( void *p, size_t size )
+{
+	if( !p ) {
+		return;
+	}
+	if( size > MAX_BLOCK_SIZE ) {
+		::operator delete( p );
+		return;
+	}
+
+	unsigned int cls = sizeClass( size );
+	ThreadCache *tc = getThreadCache();
+
+	nextBlock( p ) = tc->head[cls];
+	tc->head[cls] = p;
+	tc->count[cls]++;
+	Metrics::add( &tc->releases, 1 );
+
+	// keep the cache bounded, surplus goes to the allocating threads
+	if( tc->count[cls] >= 2 * BATCH_SIZE ) {
+		void *batch = tc->head[cls];
+		void *last = batch;
+		for( unsigned int i = 1; i < BATCH_SIZE; i++ ) {
+			last = nextBlock( last );
+		}
+		tc->head[cls] = nextBlock( last );
+		tc->count[cls] -= BATCH_SIZE;
+		pushDepot( cls, batch, BATCH_SIZE );
+	}
+}
+
+
+void PacketPool::reserve( size_t size, unsigned int count )
+{
+	if( size > MAX_BLOCK_SIZE || count == 0 ) {
+		return;
+	}
+
+	unsigned int cls = sizeClass( size );
+	mutex.lock();
+	unsigned int available = depotCount[cls];
+	mutex.unlock();
+
+	while( available < count ) {
+		unsigned int n = count - available < BATCH_SIZE ? count - available : BATCH_SIZE;
+		void *head = NULL;
+		for( unsigned int i = 0; i < n; i++ ) {
+			void *block = malloc( (cls + 1) << 4 );
+			if( !block ) {
+				throw OutOfMemoryException();
+			}
+			nextBlock( block ) = head;
+			head = block;
+		}
+		pushDepot( cls, head, n );
+		available += n;
+	}
+}
+
+
+void PacketPool::flushThreadCache()
+{
+	ThreadCache *tc = getThreadCache();
+	for( unsigned int cls = 0; cls < NUM_CLASSES; cls++ ) {
+		if( tc->count[cls] ) {
+			pushDepot( cls, tc->head[cls], tc->count[cls] );
+			tc->head[cls] = NULL;
+			tc->count[cls] = 0;
+		}
+	}
+}
+
+
+/**
+ * The counters of running threads are single-writer relaxed atomics
+ * (see Metrics), so the result is a consistent sum per counter but not a
+ * snapshot across counters while the toolbox is running.
+ */
+PacketPool::Stats PacketPool::getStats()
+{
+	Stats s;
+	mutex.lock();
+	s.hits = retiredHits;
+	s.misses = retiredMisses;
+	s.releases = retiredReleases;
+	for( ThreadCache *tc = caches; tc; tc = tc->next ) {
+		s.hits += Metrics::get( &tc->hits );
+		s.misses += Metrics::get( &tc->misses );
+		s.releases += Metrics::get( &tc->releases );
+	}
+	s.depotBlocks = 0;
+	for( unsigned int cls = 0; cls < NUM_CLASSES; cls++ ) {
+		s.depotBlocks += depotCount[cls];
+	}
+	mutex.unlock();
+	return s;
+}
@@ -0,0 +1,103 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// PacketPool.h - memory pool for DataPacket and Value objects
+
+#ifndef PACKETPOOL_H
+#define PACKETPOOL_H
+
+#include "Mutex.h"
+#include <stddef.h>
+
+
+/**
+ * \ingroup core
+ * \brief Memory pool for small, frequently allocated objects.
+ *
+ * DataPacket and Value objects (and the channel storage of typed packets)
+ * are allocated through this pool instead of the global heap. Blocks are
+ * grouped in size classes of 16 bytes up to MAX_BLOCK_SIZE; larger requests
+ * are passed to the global operator new.
+ *
+ * Every thread owns a private cache of free blocks per size class, so
+ * allocation and release do not need any lock in the common case. If a
+ * thread frees more blocks than it allocates (e.g. the consumer of a port)
+ * its surplus is handed to a shared depot in batches of BATCH_SIZE blocks
+ * where the allocating threads pick it up again (cross-thread return).
+ */
+class PacketPool
+{
+	public:
+		static const size_t MAX_BLOCK_SIZE = 1024;	///< Largest pooled block.
+		static const unsigned int BATCH_SIZE = 32;	///< Blocks moved per depot transfer.
+
+		/**
+		 * \brief Pool counters.
+		 *
+		 * A hit is an allocation served from a free list, a miss had to
+		 * fall back to the global heap.
+		 */
+		struct Stats {
+			unsigned long long hits;		///< Allocations served by the pool.
+			unsigned long long misses;		///< Allocations served by the heap.
+			unsigned long long releases;	///< Blocks given back to the pool.
+			unsigned long long depotBlocks;	///< Blocks currently held in the depot.
+		};
+
+		/**
+		 * \brief Allocate a block of \p size bytes.
+		 * \throws OutOfMemoryException if the heap is exhausted.
+		 */
+		static void *allocate( size_t size );
+
+		/**
+		 * \brief Return a block obtained by allocate().
+		 * \param p The block (may be NULL).
+		 * \param size The size that was passed to allocate().
+		 */
+		static void release( void *p, size_t size );
+
+		/**
+		 * \brief Preallocate blocks.
+		 *
+		 * Makes sure the depot holds at least \p count free blocks of
+		 * the size class of \p size. Called from StreamTask::start().
+		 */
+		static void reserve( size_t size, unsigned int count );
+
+		/**
+		 * \brief Move the free blocks of the calling thread to the depot.
+		 *
+		 * This is done automatically when a thread exits.
+		 */
+		static void flushThreadCache();
+
+		/// Get a snapshot of the pool counters (summed over all threads).
+		static Stats getStats();
+
+	private:
+		struct ThreadCache;
+		static ThreadCache *getThreadCache();
+		static void destroyThreadCache( void *cache );
+		static void createKey();
+		static void pushDepot( unsigned int cls, void *head, unsigned int count );
+		static unsigned int popDepot( unsigned int cls, void **head );
+
+		static Mutex mutex;
+		static ThreadCache *caches;	///< Registry of all thread caches.
+};
+
+
+#endif	//PACKETPOOL_H
@@ -0,0 +1,43 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SharedBuffer.cpp
+
+#include "SharedBuffer.h"
+#include "PacketPool.h"
+
+
+SharedBuffer *SharedBuffer::create( unsigned int capacity )
+{
+	SharedBuffer *b = static_cast<SharedBuffer *>( PacketPool::allocate( sizeof( SharedBuffer ) + capacity ) );
+	b->refs = 1;
+	b->capacity = capacity;
+	b->length = 0;
+	return b;
+}
+
+
+void SharedBuffer::retain()
+{
+	__sync_add_and_fetch( &refs, 1 );
+}
+
+
+void SharedBuffer::release()
+{
+	if( __sync_sub_and_fetch( &refs, 1 ) == 0 ) {
+		PacketPool::release( this, sizeof( SharedBuffer ) + capacity );
+	}
+}
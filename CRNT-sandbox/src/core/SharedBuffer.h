@@ -0,0 +1,68 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SharedBuffer.h - reference counted byte buffer
+
+#ifndef SHAREDBUFFER_H
+#define SHAREDBUFFER_H
+
+#include <stddef.h>
+
+
+/**
+ * \ingroup core
+ * \brief Reference counted block of bytes.
+ *
+ * Used to hand the same bytes (e.g. an encoded packet) to several
+ * consumers without copying, see SocketReactor::Connection::send(). The
+ * creator fills the buffer, then it is read-only while shared. It is
+ * freed when the last reference is released. The memory comes from the
+ * PacketPool.
+ */
+class SharedBuffer
+{
+	public:
+		/// Create a buffer of \p capacity bytes with one reference.
+		static SharedBuffer *create( unsigned int capacity );
+
+		unsigned char *data() { return reinterpret_cast<unsigned char *>( this + 1 ); }
+		const unsigned char *data() const { return reinterpret_cast<const unsigned char *>( this + 1 ); }
+
+		/// Number of valid bytes.
+		unsigned int size() const { return length; }
+
+		/// Set the number of valid bytes (at most getCapacity()).
+		void setSize( unsigned int n ) { length = n < capacity ? n : capacity; }
+
+		unsigned int getCapacity() const { return capacity; }
+
+		/// Check if other references exist.
+		bool isShared() const { return __atomic_load_n( &refs, __ATOMIC_ACQUIRE ) > 1; }
+
+		void retain();
+		void release();
+
+	private:
+		int refs;
+		unsigned int capacity;
+		unsigned int length;
+		unsigned int reserved;	///< keeps the data 16 byte aligned
+
+		SharedBuffer();
+		~SharedBuffer();
+};
+
+
+#endif	//SHAREDBUFFER_H
@@ -20,15 +20,18 @@
 
 #include "Socket.h"
 #include "SocketException.h"
+#include "Clock.h"
 #include <string.h>
 #include <iostream>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <poll.h>
+#include <sys/uio.h>
 
 
 
-Socket::Socket() : m_sock ( -1 ), mutex(), condition()
+Socket::Socket() : m_sock ( -1 ), _wbuf_len( 0 ), _wbuf_delay( 1000 ), _wbuf_since( 0 ), _wbuf_timeout( 5000 ), mutex(), condition()
 {
 	_buf_pos = 0;
 	_buf_len = 0;
@@ -36,7 +39,7 @@ Socket::Socket() : m_sock ( -1 ), mutex(), condition()
 }
 
 
-Socket::Socket( const Socket &s ) : m_sock ( -1 ), mutex(), condition()
+Socket::Socket( const Socket &s ) : m_sock ( -1 ), _wbuf_len( 0 ), _wbuf_delay( 1000 ), _wbuf_since( 0 ), _wbuf_timeout( 5000 ), mutex(), condition()
 {
 	_buf_pos = 0;
 	_buf_len = 0;
@@ -118,13 +121,17 @@ unsigned short Socket::getPortNumber()
 	return ntohs(sa.sin_port);
 }
 
-bool Socket::listen() const
+/**
+ * @param backlog Maximal number of pending connections (the kernel limits
+ * it to net.core.somaxconn). Servers with many clients should use SOMAXCONN.
+ */
+bool Socket::listen( int backlog ) const
 {
 	if( !is_valid() ) {
 		return false;
 	}
 	
-	int listen_return = ::listen( m_sock, MAXCONNECTIONS );
+	int listen_return = ::listen( m_sock, backlog );
 	
 	if( listen_return == -1 ) {
 		return false;
@@ -153,9 +160,24 @@ int Socket::close() {
 	//reset internal buffer
 	_buf_pos = 0;
 	_buf_len = 0;
+
+	//one attempt without waiting, a peer that does not read loses the rest
+	mutex.lock();
+	if( is_valid() && _wbuf_len > 0 ) {
+		try {
+			writeAll( NULL, 0, 0 );
+		}
+		catch( SocketException &e ) {
+			//discarded
+		}
+	}
+	_wbuf_len = 0;
+	mutex.unlock();
 	
 	if( is_valid() ) {
-		return ::close( m_sock );
+		int ret = ::close( m_sock );
+		m_sock = -1;
+		return ret;
 	}
 	else {
 		return -1;
@@ -163,6 +185,13 @@ int Socket::close() {
 }
 
 
+void Socket::attach( int fd )
+{
+	close();
+	m_sock = fd;
+}
+
+
 bool Socket::send( const std::string s ) const
 {
 	int status = ::send( m_sock, s.c_str(), s.size(), MSG_NOSIGNAL );
@@ -184,6 +213,148 @@ void Socket::send( const unsigned char *buf, unsigned int len ) const
 }
 
 
+void Socket::setWriteBuffer( unsigned int bytes, unsigned int maxDelayUs, long timeoutMs )
+{
+	mutex.lock();
+	try {
+		if( _wbuf_len > 0 ) {
+			writeAll( NULL, 0, _wbuf_timeout );
+		}
+	}
+	catch( SocketException &e ) {
+		//discarded, like in close()
+	}
+	_wbuf.resize( bytes );
+	_wbuf_delay = maxDelayUs;
+	_wbuf_timeout = timeoutMs;
+	mutex.unlock();
+}
+
+
+/**
+ * Writes the write buffer followed by \p len bytes of \p buf with as
+ * few writev() calls as possible (mutex locked). The socket is written
+ * without blocking, so the mutex is held at most \p timeout milliseconds.
+ * \throws SocketException on an error or timeout, the write buffer is
+ * empty afterwards.
+ */
+void Socket::writeAll( const unsigned char *buf, unsigned int len, long timeout )
+{
+	struct iovec iov[2];
+	int n = 0;
+	if( _wbuf_len > 0 ) {
+		iov[n].iov_base = &_wbuf[0];
+		iov[n].iov_len = _wbuf_len;
+		n++;
+	}
+	if( len > 0 ) {
+		iov[n].iov_base = (void *)buf;
+		iov[n].iov_len = len;
+		n++;
+	}
+	_wbuf_len = 0;
+
+	struct msghdr msg;
+	memset( &msg, 0, sizeof( msg ) );
+	msg.msg_iov = iov;
+	msg.msg_iovlen = n;
+	unsigned long long deadline = Clock::nowNs() + timeout * 1000000ULL;
+	while( msg.msg_iovlen > 0 ) {
+		ssize_t ret = ::sendmsg( m_sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT );
+		if( ret < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+				//wait until it is writable, but not longer than the timeout
+				unsigned long long now = Clock::nowNs();
+				struct pollfd pfd = { m_sock, POLLOUT, 0 };
+				if( now >= deadline || poll( &pfd, 1, (deadline - now + 999999) / 1000000 ) == 0 ) {
+					throw SocketException( "Timeout writing to socket." );
+				}
+				continue;
+			}
+			throw SocketException( "Could not write to socket." );
+		}
+		//skip what was written
+		while( msg.msg_iovlen > 0 && (size_t)ret >= msg.msg_iov->iov_len ) {
+			ret -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if( msg.msg_iovlen > 0 ) {
+			msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + ret;
+			msg.msg_iov->iov_len -= ret;
+		}
+	}
+}
+
+
+void Socket::write( const unsigned char *buf, unsigned int len )
+{
+	mutex.lock();
+	try {
+		unsigned long long now = Clock::nowNs();
+		if( _wbuf_len > 0 && now - _wbuf_since >= _wbuf_delay * 1000ULL ) {
+			writeAll( buf, len, _wbuf_timeout );
+		}
+		else if( len > 0 && _wbuf_len + len <= _wbuf.size() ) {
+			if( _wbuf_len == 0 ) {
+				_wbuf_since = now;
+			}
+			memcpy( &_wbuf[_wbuf_len], buf, len );
+			_wbuf_len += len;
+			if( _wbuf_len == _wbuf.size() ) {
+				writeAll( NULL, 0, _wbuf_timeout );
+			}
+		}
+		else {
+			//does not fit: buffer and data with one call
+			writeAll( buf, len, _wbuf_timeout );
+		}
+	}
+	catch( SocketException &e ) {
+		mutex.unlock();
+		throw;
+	}
+	mutex.unlock();
+}
+
+
+void Socket::flush()
+{
+	mutex.lock();
+	try {
+		if( _wbuf_len > 0 ) {
+			writeAll( NULL, 0, _wbuf_timeout );
+		}
+	}
+	catch( SocketException &e ) {
+		mutex.unlock();
+		throw;
+	}
+	mutex.unlock();
+}
+
+
+long Socket::flushIfDue()
+{
+	mutex.lock();
+	long remaining = -1;
+	if( _wbuf_len > 0 ) {
+		unsigned long long waited = Clock::nowNs() - _wbuf_since;
+		if( waited >= _wbuf_delay * 1000ULL ) {
+			mutex.unlock();
+			flush();
+			return -1;
+		}
+		remaining = (_wbuf_delay * 1000ULL - waited + 999999) / 1000000;
+	}
+	mutex.unlock();
+	return remaining;
+}
+
+
 /**
  * @warning This is an unbuffered access method. It does not use
  * the internal buffer and, therefore, it may not be used together
@@ -211,25 +382,18 @@ int Socket::recv( unsigned char *buf, unsigned int len ) const
  */
 int Socket::recv( std::string& s ) const
 {
-	char buf[ MAXRECV + 1 ];
+	//receive into the string directly instead of a copy on the stack
+	s.resize( MAXRECV );
 	
-	s = "";
-	
-	memset( buf, 0, MAXRECV + 1 );
-	
-	int status = ::recv( m_sock, buf, MAXRECV, 0 );
+	int status = ::recv( m_sock, &s[0], MAXRECV, 0 );
 	
 	if( status == -1 ) {
 		std::cout << "status == -1   errno == " << errno << "  in Socket::recv\n";
+		s.clear();
 		return 0;
 	}
-	else if( status == 0 ) {
-		return 0;
-	}
-	else {
-		s = buf;
-		return status;
-	}
+	s.resize( status );
+	return status;
 }
 
 
@@ -288,25 +452,48 @@ void Socket::set_non_blocking( const bool b )
 
 
 
+void Socket::setReadBufferSize( unsigned int bytes )
+{
+	//keep the buffered bytes
+	if( _buf_pos > 0 ) {
+		memmove( &_buf[0], &_buf[_buf_pos], _buf_len - _buf_pos );
+		_buf_len -= _buf_pos;
+		_buf_pos = 0;
+	}
+	_buf.resize( bytes > (unsigned int)_buf_len ? bytes : _buf_len );
+}
+
+
+/**
+ * Refills the empty internal buffer with one read operation.
+ * @return \c false on an error or if the peer closed the connection.
+ */
+bool Socket::fill()
+{
+	if( _buf.empty() ) {
+		_buf.resize( DEFAULT_READ_BUFFER );
+	}
+	_buf_pos = 0;
+	_buf_len = ::recv( m_sock, &_buf[0], _buf.size(), 0 );
+	if( _buf_len < 1 ) {
+		_buf_len = 0;
+		return false;
+	}
+	return true;
+}
+
+
 /**
  * Returns one character from the internal buffer.
  * A read operation on the socket is only
  * performed if the internal buffer is empty.
  * @return Next character in stream.
  */
-inline char Socket::getChar()
+char Socket::getChar()
 {
-	if( _buf_pos < _buf_len ) {
-		//buffer is not empty
-	}
-	else {
-		//buffer is empty, try to refill it!
-		_buf_pos = 0;
-		_buf_len = ::recv( m_sock, _buf, BUFSIZE1, 0 );
-		if( _buf_len < 1 ) {
-			//std::cerr << "Socket::getChar(): ERROR: " << errno << std::endl;
-			throw SocketException("error while reading from socket");
-		}
+	if( _buf_pos >= _buf_len && !fill() ) {
+		//std::cerr << "Socket::getChar(): ERROR: " << errno << std::endl;
+		throw SocketException("error while reading from socket");
 	}
 
 	return _buf[_buf_pos++];
@@ -338,6 +525,7 @@ int Socket::readBuf( unsigned char *buf, int size )
 		_buf_pos += pos;
 	}
 	
+	//the rest goes directly to the caller's buffer
 	while( pos < size ) {
 		ret = ::recv( m_sock, &buf[pos], size - pos, 0 );
 		if( ret > 0 ) {
@@ -359,7 +547,7 @@ int Socket::readBuf( unsigned char *buf, int size )
  * omitted (default). A string termination character (0x0) will
  * be inserted after the last character.
  * The internal buffer is used to reduce read operations on
- * the socket.
+ * the socket, it is searched for the separator with memchr().
  *
  * @param[out] buf The buffer for the received characters.
  * Must be at least \p size bytes long.
@@ -371,17 +559,33 @@ int Socket::readBuf( unsigned char *buf, int size )
 int Socket::readLine( unsigned char *buf, int size, char sep, bool keepSep )
 {
 	int pos = 0;
-	unsigned char ch = 0;
 	
-	while( (pos < size-1) && ((ch = getChar()) != sep) ) {
-		buf[pos++] = ch;
-	}
-	if( keepSep && (ch == sep) ) {
-		buf[pos++] = ch;
+	while( pos < size-1 ) {
+		if( _buf_pos >= _buf_len && !fill() ) {
+			throw SocketException("error while reading from socket");
+		}
+		int n = _buf_len - _buf_pos;
+		if( n > size-1 - pos ) {
+			n = size-1 - pos;
+		}
+		const unsigned char *start = &_buf[_buf_pos];
+		const unsigned char *end = (const unsigned char *)memchr( start, sep, n );
+		if( end ) {
+			n = end - start;
+		}
+		memcpy( &buf[pos], start, n );
+		pos += n;
+		_buf_pos += n;
+		if( end ) {
+			//consume the separator
+			_buf_pos++;
+			if( keepSep ) {
+				buf[pos++] = sep;
+			}
+			break;
+		}
 	}
 	buf[pos] = '\0';
 	
 	return pos;
 }
-
-
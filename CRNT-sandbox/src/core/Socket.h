@@ -32,6 +32,7 @@
 
 #include "Mutex.h"
 #include "Condition.h"
+#include <vector>
 
 
 const int MAXHOSTNAME = 200;
@@ -43,12 +44,29 @@ const int MAXRECV = 500;
  * \ingroup core
  * \brief Wrapper for TCP sockets.
  *
+ * The buffered read methods (getChar(), readBuf(), readLine()) refill an
+ * internal buffer of setReadBufferSize() bytes (64 KB by default) with one
+ * recv() call; readLine() scans it with memchr().
+ *
+ * write() coalesces small writes (e.g. encoded packets) into a write
+ * buffer. It is written when it is full, when a write does not fit (the
+ * buffer and the new data go out with one writev() call) or when its
+ * oldest byte waited longer than the latency bound.
+ *
+ * The latency bound is only checked by write() and flushIfDue(), there is
+ * no timer. Owners that may stop writing for a while must poll
+ * flushIfDue(), e.g. using its return value as the timeout of
+ * WaitSet::wait(), or call flush().
+ *
+ * A write waits at most the write timeout for a peer that does not read;
+ * then it throws and the unwritten bytes are discarded. close() makes a
+ * single non-blocking attempt to write the buffer and discards the rest.
  */
 class Socket
 {
-	static const int BUFSIZE1 = 50;
-
 	public:
+		static const int DEFAULT_READ_BUFFER = 65536;	///< Default size of the read buffer.
+
 		Socket();
 		Socket( const Socket &s );
 		virtual ~Socket();
@@ -56,10 +74,18 @@ class Socket
 		// Server initialization
 		bool create();
 		bool bind( const int port );
-		bool listen() const;
+		bool listen( int backlog = MAXCONNECTIONS ) const;
 		bool accept( Socket& ) const;
 		
 		int close();
+
+		/**
+		 * \brief Take over the connected descriptor \p fd.
+		 *
+		 * A descriptor held before is closed. Used for sockets accepted
+		 * by other means, e.g. in the SocketReactor.
+		 */
+		void attach( int fd );
 		
 		// Client initialization
 		bool connect( const std::string host, const int port );
@@ -67,6 +93,33 @@ class Socket
 		// Data Transimission
 		bool send( const std::string ) const;
 		void send( const unsigned char *buf, unsigned int len ) const;
+
+		/**
+		 * \brief Buffered write (see setWriteBuffer()).
+		 * \throws SocketException if the socket cannot be written within
+		 * the write timeout. The unwritten bytes are discarded, the
+		 * socket should be closed.
+		 */
+		void write( const unsigned char *buf, unsigned int len );
+
+		/// Write the write buffer now (see write() for errors).
+		void flush();
+
+		/**
+		 * \brief Write the write buffer if its latency bound is reached.
+		 * \return Milliseconds until the buffer is due (e.g. as timeout for
+		 * WaitSet::wait()), -1 if it is empty.
+		 */
+		long flushIfDue();
+
+		/**
+		 * \brief Configure write().
+		 * \param bytes Size of the write buffer, 0 writes through.
+		 * \param maxDelayUs Maximal time bytes stay in the buffer (see flushIfDue()).
+		 * \param timeoutMs Maximal time write() and flush() wait for the
+		 * peer to accept data before they throw.
+		 */
+		void setWriteBuffer( unsigned int bytes, unsigned int maxDelayUs = 1000, long timeoutMs = 5000 );
 		int recv( std::string& ) const;
 		int recv( unsigned char *buf, unsigned int len ) const;
 		
@@ -74,6 +127,12 @@ class Socket
 		char getChar();
 		int readBuf( unsigned char *buf, int size );
 		int readLine( unsigned char *buf, int size, char sep, bool keepSep = false );
+
+		/**
+		 * \brief Set the size of the internal read buffer.
+		 * \note Buffered bytes are kept, the buffer does not shrink below them.
+		 */
+		void setReadBufferSize( unsigned int bytes );
 		
 		/**
 		 * Set the TCP_NODELAY flag for reducing delay.
@@ -85,6 +144,13 @@ class Socket
 		
 		bool is_valid() const { return m_sock != -1; }
 
+		/**
+		 * \brief Get the file descriptor, e.g. for WaitSet::addFd().
+		 * \note Data already read into the internal buffer (by getChar(),
+		 * readBuf() or readLine()) does not make the descriptor readable.
+		 */
+		int getFd() const { return m_sock; }
+
 		/**
 		 * \brief This method gets the port to which the socket is bound to.
 		 * 
@@ -101,13 +167,20 @@ class Socket
 	private:
 		int m_sock;
 		sockaddr_in m_addr;
-		unsigned char _buf[BUFSIZE1];	///< Internal buffer.
+		std::vector<unsigned char> _buf;	///< Internal buffer.
 		int _buf_pos;					///< Current position in internal buffer.
 		int _buf_len;					///< Length of internal buffer.
+		std::vector<unsigned char> _wbuf;	///< Write buffer (capacity is its size).
+		unsigned int _wbuf_len;			///< Bytes in the write buffer.
+		unsigned int _wbuf_delay;		///< Latency bound of the write buffer in microseconds.
+		unsigned long long _wbuf_since;	///< Time the write buffer was started.
+		long _wbuf_timeout;				///< Write timeout in milliseconds.
 		Mutex mutex;
 		Condition condition;
 		
 		bool setOptions();
+		bool fill();
+		void writeAll( const unsigned char *buf, unsigned int len, long timeout );
 		
 };
 
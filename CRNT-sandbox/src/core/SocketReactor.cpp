@@ -0,0 +1,576 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SocketReactor.cpp
+
+#include "SocketReactor.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+
+/// Bytes read at once (and initial size of the input buffer).
+static const unsigned int READ_SIZE = 16384;
+
+
+/*
+ * Connection
+ */
+
+SocketReactor::Connection::Connection( SocketReactor *reactor, unsigned int loop ) :
+	userData(NULL),
+	reactor(reactor),
+	loop(loop),
+	handler(NULL),
+	listening(false),
+	refs(1),
+	closing(0),
+	registered(false),
+	writing(false),
+	inputPos(0),
+	inputLen(0),
+	pending(0)
+{
+}
+
+
+SocketReactor::Connection::~Connection()
+{
+}
+
+
+void SocketReactor::Connection::retain()
+{
+	__sync_add_and_fetch( &refs, 1 );
+}
+
+
+void SocketReactor::Connection::release()
+{
+	if( __sync_sub_and_fetch( &refs, 1 ) == 0 ) {
+		delete this;
+	}
+}
+
+
+void SocketReactor::Connection::consume( unsigned int n )
+{
+	inputPos += n < size() ? n : size();
+	if( inputPos == inputLen ) {
+		inputPos = 0;
+		inputLen = 0;
+	}
+}
+
+
+unsigned int SocketReactor::Connection::getPending()
+{
+	outputMutex.lock();
+	unsigned int n = pending;
+	outputMutex.unlock();
+	return n;
+}
+
+
+/// Set the epoll events (outputMutex locked).
+void SocketReactor::Connection::watch( bool out )
+{
+	writing = out;
+	if( !registered ) {
+		return;
+	}
+	struct epoll_event ev;
+	ev.events = EPOLLIN | (out ? EPOLLOUT : 0);
+	ev.data.ptr = this;
+	epoll_ctl( reactor->loops[loop]->epollFd, EPOLL_CTL_MOD, getFd(), &ev );
+}
+
+
+/**
+ * Queue \p len bytes at \p buf, which belong to \p buffer or, if it is
+ * NULL, are copied (outputMutex locked).
+ */
+bool SocketReactor::Connection::queue( SharedBuffer *buffer, const unsigned char *buf, unsigned int len )
+{
+	if( closing || pending + len > reactor->outputLimit ) {
+		return false;
+	}
+	if( pending == 0 && registered ) {
+		//nothing queued: try to write right away
+		ssize_t n = ::send( getFd(), buf, len, MSG_NOSIGNAL | MSG_DONTWAIT );
+		if( n > 0 ) {
+			buf += n;
+			len -= n;
+		}
+		//on errors the loop gets EPOLLERR and closes the connection
+	}
+	if( len == 0 ) {
+		return true;
+	}
+
+	if( buffer ) {
+		buffer->retain();
+		Segment seg = { buffer, (unsigned int)(buf - buffer->data()) };
+		output.push_back( seg );
+	}
+	else {
+		//append to the last buffer if it is our own copy with room left
+		SharedBuffer *last = output.empty() ? NULL : output.back().buffer;
+		if( !last || last->isShared() || last->getCapacity() - last->size() < len ) {
+			last = SharedBuffer::create( len > READ_SIZE ? len : READ_SIZE );
+			Segment seg = { last, 0 };
+			output.push_back( seg );
+		}
+		memcpy( last->data() + last->size(), buf, len );
+		last->setSize( last->size() + len );
+	}
+	pending += len;
+	if( !writing ) {
+		watch( true );
+	}
+	return true;
+}
+
+
+bool SocketReactor::Connection::send( const unsigned char *buf, unsigned int len )
+{
+	outputMutex.lock();
+	bool ok = queue( NULL, buf, len );
+	outputMutex.unlock();
+	return ok;
+}
+
+
+bool SocketReactor::Connection::send( SharedBuffer *buffer )
+{
+	outputMutex.lock();
+	bool ok = queue( buffer, buffer->data(), buffer->size() );
+	outputMutex.unlock();
+	return ok;
+}
+
+
+void SocketReactor::Connection::close()
+{
+	outputMutex.lock();
+	if( !closing ) {
+		__atomic_store_n( &closing, 1, __ATOMIC_RELEASE );
+		//the loop closes the socket once it is writable and the output is written
+		watch( true );
+	}
+	outputMutex.unlock();
+}
+
+
+void SocketReactor::Connection::abort()
+{
+	outputMutex.lock();
+	if( closing < 2 ) {
+		__atomic_store_n( &closing, 1, __ATOMIC_RELEASE );
+		discardOutput();
+		//wakes up the loop with EPOLLHUP, even if the peer does not read
+		shutdown( getFd(), SHUT_RDWR );
+	}
+	outputMutex.unlock();
+}
+
+
+/// Release the queued output (outputMutex locked).
+void SocketReactor::Connection::discardOutput()
+{
+	for( unsigned int i = 0; i < output.size(); i++ ) {
+		output[i].buffer->release();
+	}
+	output.clear();
+	pending = 0;
+}
+
+
+/**
+ * Write queued output (loop thread).
+ * @return \c false on a socket error.
+ */
+bool SocketReactor::Connection::flush()
+{
+	outputMutex.lock();
+	while( pending > 0 ) {
+		struct iovec iov[64];
+		unsigned int n = 0;
+		for( ; n < 64 && n < output.size(); n++ ) {
+			Segment &seg = output[n];
+			iov[n].iov_base = seg.buffer->data() + seg.offset;
+			iov[n].iov_len = seg.buffer->size() - seg.offset;
+		}
+		struct msghdr msg;
+		memset( &msg, 0, sizeof( msg ) );
+		msg.msg_iov = iov;
+		msg.msg_iovlen = n;
+		ssize_t ret = ::sendmsg( getFd(), &msg, MSG_NOSIGNAL | MSG_DONTWAIT );
+		if( ret < 0 ) {
+			bool again = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+			outputMutex.unlock();
+			return again;
+		}
+		pending -= ret;
+		while( ret > 0 ) {
+			Segment &seg = output.front();
+			unsigned int left = seg.buffer->size() - seg.offset;
+			if( (size_t)ret < left ) {
+				seg.offset += ret;
+				break;
+			}
+			ret -= left;
+			seg.buffer->release();
+			output.pop_front();
+		}
+	}
+	if( !closing ) {
+		watch( false );
+	}
+	outputMutex.unlock();
+	return true;
+}
+
+
+/*
+ * Loop
+ */
+
+SocketReactor::Loop::Loop( SocketReactor *reactor, unsigned int index ) : reactor(reactor), index(index)
+{
+	epollFd = epoll_create1( EPOLL_CLOEXEC );
+	eventFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	if( epollFd < 0 || eventFd < 0 ) {
+		log( "ERROR: cannot create epoll set." );
+		return;
+	}
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl( epollFd, EPOLL_CTL_ADD, eventFd, &ev );
+}
+
+
+SocketReactor::Loop::~Loop()
+{
+	if( epollFd >= 0 ) {
+		close( epollFd );
+	}
+	if( eventFd >= 0 ) {
+		close( eventFd );
+	}
+}
+
+
+void SocketReactor::Loop::wakeup()
+{
+	unsigned long long one = 1;
+	if( write( eventFd, &one, sizeof( one ) ) < 0 ) {
+		log( "ERROR: writing to eventfd failed." );
+	}
+}
+
+
+void SocketReactor::Loop::run()
+{
+	struct epoll_event events[64];
+	while( !exiting() ) {
+		int n = epoll_wait( epollFd, events, 64, -1 );
+		if( n < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			log( "ERROR: epoll_wait() failed: " ) << strerror( errno ) << endl;
+			break;
+		}
+		for( int i = 0; i < n; i++ ) {
+			if( events[i].data.ptr == NULL ) {
+				unsigned long long count;
+				if( read( eventFd, &count, sizeof( count ) ) < 0 ) {
+					//counter was reset by another wakeup
+				}
+				continue;
+			}
+			reactor->handle( static_cast<Connection *>( events[i].data.ptr ), events[i].events );
+		}
+	}
+}
+
+
+string SocketReactor::Loop::identify()
+{
+	char num[16];
+	sprintf( num, "%u", index );
+	return reactor->getId() + ":loop" + num;
+}
+
+
+/*
+ * SocketReactor
+ */
+
+SocketReactor::SocketReactor( unsigned int threads ) :
+	nextLoop(0),
+	clients(0),
+	inputLimit(1 << 20),
+	outputLimit(4 << 20),
+	running(false)
+{
+	setId( "socketreactor" );
+	for( unsigned int i = 0; i < (threads > 0 ? threads : 1); i++ ) {
+		loops.push_back( new Loop( this, i ) );
+	}
+}
+
+
+SocketReactor::~SocketReactor()
+{
+	stop();
+	for( unsigned int i = 0; i < loops.size(); i++ ) {
+		delete loops[i];
+	}
+}
+
+
+void SocketReactor::setBufferLimits( unsigned int input, unsigned int output )
+{
+	inputLimit = input > READ_SIZE ? input : READ_SIZE;
+	outputLimit = output;
+}
+
+
+unsigned int SocketReactor::getConnectionCount()
+{
+	return __atomic_load_n( &clients, __ATOMIC_SEQ_CST );
+}
+
+
+void SocketReactor::start()
+{
+	if( running ) {
+		return;
+	}
+	running = true;
+	for( unsigned int i = 0; i < loops.size(); i++ ) {
+		loops[i]->init();
+	}
+}
+
+
+void SocketReactor::stop()
+{
+	if( running ) {
+		for( unsigned int i = 0; i < loops.size(); i++ ) {
+			loops[i]->exitNow();
+			loops[i]->wakeup();
+			loops[i]->joinMe();
+		}
+		running = false;
+	}
+
+	mutex.lock();
+	vector<Connection *> open( connections.begin(), connections.end() );
+	mutex.unlock();
+	for( unsigned int i = 0; i < open.size(); i++ ) {
+		teardown( open[i] );
+	}
+}
+
+
+int SocketReactor::listen( int port, Handler *handler, int backlog )
+{
+	Connection *c = new Connection( this, 0 );
+	Socket &s = c->socket;
+	if( !s.create() || !s.bind( port ) || !s.listen( backlog ) ) {
+		log( "ERROR: cannot listen on port " ) << port << ": " << strerror( errno ) << endl;
+		c->release();
+		return -1;
+	}
+	s.set_non_blocking( true );
+	port = s.getPortNumber();
+	return attach( c, handler, true ) ? port : -1;
+}
+
+
+SocketReactor::Connection *SocketReactor::add( int fd, Handler *handler )
+{
+	mutex.lock();
+	Connection *c = new Connection( this, nextLoop++ % loops.size() );
+	mutex.unlock();
+	c->socket.attach( fd );
+	c->socket.set_non_blocking( true );
+	return attach( c, handler, false );
+}
+
+
+/// Add \p c to the epoll set of its loop.
+SocketReactor::Connection *SocketReactor::attach( Connection *c, Handler *handler, bool listening )
+{
+	c->handler = handler;
+	c->listening = listening;
+	mutex.lock();
+	connections.insert( c );
+	mutex.unlock();
+
+	c->outputMutex.lock();
+	struct epoll_event ev;
+	ev.events = EPOLLIN | (c->writing ? EPOLLOUT : 0);
+	ev.data.ptr = c;
+	c->registered = epoll_ctl( loops[c->loop]->epollFd, EPOLL_CTL_ADD, c->getFd(), &ev ) == 0;
+	c->outputMutex.unlock();
+
+	if( !c->registered ) {
+		log( "ERROR: cannot add socket to epoll set: " ) << strerror( errno ) << endl;
+		mutex.lock();
+		connections.erase( c );
+		mutex.unlock();
+		c->release();
+		return NULL;
+	}
+	if( !listening ) {
+		__sync_add_and_fetch( &clients, 1 );
+	}
+	return c;
+}
+
+
+/// Dispatch the epoll \p events of \p c (loop thread).
+void SocketReactor::handle( Connection *c, unsigned int events )
+{
+	if( c->listening ) {
+		accept( c );
+		return;
+	}
+	if( events & (EPOLLIN | EPOLLHUP | EPOLLERR) ) {
+		if( !receive( c ) ) {
+			return;
+		}
+	}
+	if( events & EPOLLOUT ) {
+		if( !c->flush() ) {
+			teardown( c );
+		}
+		else if( c->isClosed() ) {
+			if( c->getPending() == 0 ) {
+				teardown( c );
+			}
+		}
+		else if( c->handler ) {
+			c->handler->onWritable( c );
+		}
+	}
+}
+
+
+void SocketReactor::accept( Connection *listener )
+{
+	for( ;; ) {
+		int fd = ::accept4( listener->getFd(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC );
+		if( fd < 0 ) {
+			if( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) {
+				log( "ERROR: accept() failed: " ) << strerror( errno ) << endl;
+			}
+			return;
+		}
+
+		mutex.lock();
+		Connection *c = new Connection( this, nextLoop++ % loops.size() );
+		mutex.unlock();
+		c->socket.attach( fd );
+		//registered after onAccept(), so no other callback can run before
+		Handler *h = listener->handler ? listener->handler->onAccept( c ) : NULL;
+		if( !h ) {
+			c->release();
+			continue;
+		}
+		attach( c, h, false );
+	}
+}
+
+
+/**
+ * Read from \p c and call the handler (loop thread).
+ * @return \c false if the connection was closed.
+ */
+bool SocketReactor::receive( Connection *c )
+{
+	vector<unsigned char> &in = c->input;
+	if( in.size() - c->inputLen < READ_SIZE ) {
+		if( c->inputPos > 0 ) {
+			memmove( &in[0], &in[c->inputPos], c->inputLen - c->inputPos );
+			c->inputLen -= c->inputPos;
+			c->inputPos = 0;
+		}
+		if( in.size() - c->inputLen < READ_SIZE ) {
+			if( in.size() >= inputLimit ) {
+				log( "ERROR: input buffer full, closing connection " ) << c->getFd() << endl;
+				teardown( c );
+				return false;
+			}
+			unsigned int size = in.size() < READ_SIZE ? READ_SIZE : 2 * in.size();
+			in.resize( size < inputLimit ? size : inputLimit );
+		}
+	}
+
+	ssize_t n = ::recv( c->getFd(), &in[c->inputLen], in.size() - c->inputLen, 0 );
+	if( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ) {
+		return true;
+	}
+	if( n <= 0 ) {
+		//closed by the peer or error
+		teardown( c );
+		return false;
+	}
+	c->inputLen += n;
+	if( c->isClosed() ) {
+		c->consume( c->size() );
+	}
+	else if( c->handler ) {
+		c->handler->onData( c );
+	}
+	return true;
+}
+
+
+/// Remove \p c from the reactor and close its socket.
+void SocketReactor::teardown( Connection *c )
+{
+	c->outputMutex.lock();
+	__atomic_store_n( &c->closing, 2, __ATOMIC_RELEASE );
+	if( c->registered ) {
+		epoll_ctl( loops[c->loop]->epollFd, EPOLL_CTL_DEL, c->getFd(), NULL );
+		c->registered = false;
+	}
+	c->socket.close();
+	c->discardOutput();
+	c->outputMutex.unlock();
+
+	if( !c->listening ) {
+		__sync_sub_and_fetch( &clients, 1 );
+		if( c->handler ) {
+			c->handler->onClose( c );
+		}
+	}
+	mutex.lock();
+	connections.erase( c );
+	mutex.unlock();
+	c->release();
+}
@@ -0,0 +1,249 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SocketReactor.h - event loop for many non-blocking sockets
+
+#ifndef SOCKETREACTOR_H
+#define SOCKETREACTOR_H
+
+#include "Thread.h"
+#include "Mutex.h"
+#include "Socket.h"
+#include "SharedBuffer.h"
+#include <deque>
+#include <set>
+#include <vector>
+
+
+/**
+ * \ingroup core
+ * \brief Serves many TCP connections from one or a few threads.
+ *
+ * The reactor owns non-blocking sockets and waits for them with epoll.
+ * Instead of a blocking thread per connection, a Handler is called when
+ * a connection was accepted, received data, drained its output or was
+ * closed. Every Connection has an input buffer (filled by the reactor,
+ * consumed by the handler) and an output queue (filled by send(), written
+ * by the reactor with one sendmsg() call per wakeup when the socket is
+ * writable). The output queue holds SharedBuffer references, so the same
+ * bytes can be queued for many connections without copying.
+ *
+ * Connections are distributed round-robin over \a threads event loops.
+ * The callbacks of a connection are always called from the same loop
+ * thread, one at a time; they should not block. send() and close() may be
+ * called from any thread.
+ *
+ * Example:
+ * \code
+ * class Echo : public SocketReactor::Handler {
+ *     void onData( SocketReactor::Connection *c ) {
+ *         c->send( c->data(), c->size() );
+ *         c->consume( c->size() );
+ *     }
+ * };
+ * Echo echo;
+ * SocketReactor reactor;
+ * reactor.listen( 4242, &echo );
+ * reactor.start();
+ * \endcode
+ */
+class SocketReactor : public TBObject
+{
+	public:
+		class Connection;
+
+		/// Callbacks of the connections, called by the loop threads.
+		class Handler {
+			public:
+				virtual ~Handler() {}
+
+				/**
+				 * \brief A listening socket accepted connection \p c.
+				 * \return The handler of \p c, or NULL to close it.
+				 */
+				virtual Handler *onAccept( Connection *c ) { return this; }
+
+				/// New data is in the input buffer of \p c (see Connection::data()).
+				virtual void onData( Connection *c ) {}
+
+				/// The output buffer of \p c was written completely.
+				virtual void onWritable( Connection *c ) {}
+
+				/**
+				 * \brief Connection \p c was closed (by the peer, an error or close()).
+				 *
+				 * No further callbacks follow. Connections retained by the
+				 * handler must be released.
+				 */
+				virtual void onClose( Connection *c ) {}
+		};
+
+		/**
+		 * \brief A socket served by the reactor.
+		 *
+		 * Connections are reference counted. The reactor holds a reference
+		 * until onClose() returned; code that keeps a pointer beyond that
+		 * (e.g. to send from another thread) must retain() it.
+		 */
+		class Connection {
+			public:
+				/// The socket (non-blocking).
+				Socket &getSocket() { return socket; }
+				int getFd() const { return socket.getFd(); }
+
+				/// Received bytes not consumed yet (loop thread only).
+				const unsigned char *data() const { return input.empty() ? NULL : &input[inputPos]; }
+
+				/// Number of bytes in data().
+				unsigned int size() const { return inputLen - inputPos; }
+
+				/// Remove \p n bytes from the input buffer (loop thread only).
+				void consume( unsigned int n );
+
+				/**
+				 * \brief Queue \p len bytes for sending.
+				 *
+				 * Writes immediately if nothing is queued, otherwise when
+				 * the socket is writable.
+				 * \return \c false if the connection is closed or the
+				 * output buffer would exceed the limit (nothing is queued).
+				 */
+				bool send( const unsigned char *buf, unsigned int len );
+
+				/**
+				 * \brief Queue the bytes of \p buffer for sending, without copying.
+				 *
+				 * The connection holds a reference until the bytes are
+				 * written; \p buffer must not be changed anymore.
+				 * \return See send( const unsigned char *, unsigned int ).
+				 */
+				bool send( SharedBuffer *buffer );
+
+				/// Close the connection once the queued output is written.
+				void close();
+
+				/// Close the connection now, the queued output is discarded.
+				void abort();
+
+				/// Check if the connection is closed or closing.
+				bool isClosed() const { return __atomic_load_n( &closing, __ATOMIC_ACQUIRE ) != 0; }
+
+				/// Number of bytes queued for sending.
+				unsigned int getPending();
+
+				void retain();
+				void release();
+
+				/// Free for use by the handler.
+				void *userData;
+
+			private:
+				friend class SocketReactor;
+
+				Connection( SocketReactor *reactor, unsigned int loop );
+				~Connection();
+
+				SocketReactor *reactor;
+				unsigned int loop;			///< Index of the serving loop.
+				Handler *handler;
+				Socket socket;
+				bool listening;
+				int refs;
+				int closing;
+				bool registered;			///< Added to the epoll set.
+				bool writing;				///< Waiting for EPOLLOUT.
+				std::vector<unsigned char> input;
+				unsigned int inputPos, inputLen;
+				/// Queued bytes: data() + offset to the end of the buffer.
+				struct Segment {
+					SharedBuffer *buffer;
+					unsigned int offset;
+				};
+
+				Mutex outputMutex;
+				std::deque<Segment> output;
+				unsigned int pending;		///< Bytes queued.
+
+				bool queue( SharedBuffer *buffer, const unsigned char *buf, unsigned int len );
+				void discardOutput();
+				bool flush();
+				void watch( bool out );
+		};
+
+		/// \param threads Number of event loops (threads).
+		SocketReactor( unsigned int threads = 1 );
+		virtual ~SocketReactor();
+
+		/**
+		 * \brief Accept connections on \p port.
+		 *
+		 * The accepted connections are passed to Handler::onAccept() of
+		 * \p handler.
+		 * \param port TCP port, 0 for any free port.
+		 * \param backlog Length of the queue of pending connections.
+		 * \return The port or -1 on an error.
+		 */
+		int listen( int port, Handler *handler, int backlog = SOMAXCONN );
+
+		/**
+		 * \brief Serve a connected socket.
+		 * \param fd Connected socket, owned by the reactor from now on.
+		 */
+		Connection *add( int fd, Handler *handler );
+
+		/// Start the event loops.
+		void start();
+
+		/// Stop the event loops and close all connections.
+		void stop();
+
+		/// Maximal bytes buffered per connection for input and output (default 1 MB and 4 MB).
+		void setBufferLimits( unsigned int input, unsigned int output );
+
+		/// Number of open connections (without listening sockets).
+		unsigned int getConnectionCount();
+
+	private:
+		class Loop : public Thread {
+			public:
+				Loop( SocketReactor *reactor, unsigned int index );
+				virtual ~Loop();
+				void run();
+				std::string identify();
+				void wakeup();
+				SocketReactor *reactor;
+				unsigned int index;
+				int epollFd;
+				int eventFd;
+		};
+
+		std::vector<Loop *> loops;
+		Mutex mutex;
+		std::set<Connection *> connections;
+		unsigned int nextLoop;
+		unsigned int clients;
+		unsigned int inputLimit;
+		unsigned int outputLimit;
+		bool running;
+
+		Connection *attach( Connection *c, Handler *handler, bool listening );
+		void handle( Connection *c, unsigned int events );
+		void accept( Connection *listener );
+		bool receive( Connection *c );
+		void teardown( Connection *c );
+};
+
+
+#endif	//SOCKETREACTOR_H
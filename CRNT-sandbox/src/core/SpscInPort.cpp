@@ -0,0 +1,340 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "SpscInPort.h"
+#include "WaitSet.h"
+#include "TaskScheduler.h"
+
+using namespace std;
+
+
+
+SpscInPort::SpscInPort() : InPort(), ring(NULL), head(0), consumerParked(0), tail(0), producerParked(0)
+{
+	resizeRing( 0 );
+}
+
+
+/**
+ * Copy constructor.
+ * @note The packet queue is not copied, i.e. it will be empty.
+ */
+SpscInPort::SpscInPort( const SpscInPort& p )
+: InPort( p ), ring(NULL), head(0), consumerParked(0), tail(0), producerParked(0)
+{
+	resizeRing( p.maxQueueSize );
+}
+
+
+SpscInPort::~SpscInPort()
+{
+	delete[] ring;
+}
+
+
+void SpscInPort::resizeRing( unsigned int size )
+{
+	unsigned long capacity = 1;
+	unsigned long wanted = size ? size : DEFAULT_CAPACITY;
+	while( capacity < wanted ) {
+		capacity <<= 1;
+	}
+	delete[] ring;
+	ring = new DataPacket*[capacity];
+	mask = capacity - 1;
+	maxQueueSize = wanted;
+}
+
+
+void SpscInPort::setMaxQueueSize( unsigned int size )
+{
+	mutex.lock();
+	if( head == tail ) {
+		resizeRing( size );
+	}
+	else {
+		log( "WARNING: queue not empty, ring is not resized" );
+	}
+	mutex.unlock();
+}
+
+
+void SpscInPort::setLossless( bool flag )
+{
+	if( flag && scheduler ) {
+		log( "ERROR: a lossless SpscInPort cannot be scheduled, staying lossy" );
+		flag = false;
+	}
+	InPort::setLossless( flag );
+}
+
+
+void SpscInPort::setScheduler( TaskScheduler *s )
+{
+	if( s && lossless ) {
+		log( "ERROR: a lossless SpscInPort cannot be scheduled, switching to lossy mode" );
+		InPort::setLossless( false );
+	}
+	InPort::setScheduler( s );
+}
+
+
+/**
+ * The counters are read without a lock, the snapshot is not atomic.
+ */
+InPortStats SpscInPort::getStats()
+{
+	InPortStats s;
+	s.enqueued = Metrics::get( &stats.enqueued );
+	s.received = Metrics::get( &stats.received );
+	s.dropped = Metrics::get( &stats.dropped );
+	s.overruns = 0;		//never queued beyond the capacity, see setLossless()
+	s.blockedNs = Metrics::get( &stats.blockedNs );
+	s.waitNs = Metrics::get( &stats.waitNs );
+	s.maxDepth = __atomic_load_n( &stats.maxDepth, __ATOMIC_RELAXED );
+	unsigned long h = __atomic_load_n( &head, __ATOMIC_ACQUIRE );
+	unsigned long t = __atomic_load_n( &tail, __ATOMIC_ACQUIRE );
+	s.depth = t > h ? t - h : 0;
+	s.capacity = maxQueueSize;
+	return s;
+}
+
+
+bool SpscInPort::notEmpty()
+{
+	return __atomic_load_n( &tail, __ATOMIC_ACQUIRE ) != __atomic_load_n( &head, __ATOMIC_RELAXED );
+}
+
+
+bool SpscInPort::isEmpty()
+{
+	return !notEmpty();
+}
+
+
+/**
+ * Parks the sender until the receiver has taken a packet out of
+ * the full ring.
+ * @throws "condition canceled" if cancel_receive() was called.
+ */
+void SpscInPort::waitForSpace( unsigned long t )
+{
+	//the receiver is a thread (see setLossless()), a worker of the
+	//TaskScheduler runs other tasks meanwhile and checks every millisecond
+	bool worker = TaskScheduler::isWorkerThread();
+	if( worker && TaskScheduler::helpOne() ) {
+		return;
+	}
+
+	mutex.lock();
+	__atomic_store_n( &producerParked, 1, __ATOMIC_SEQ_CST );
+	if( t - __atomic_load_n( &head, __ATOMIC_SEQ_CST ) >= maxQueueSize ) {
+		unsigned long long t0 = Metrics::nowNs();
+		try {
+			if( worker ) {
+				struct timespec ts;
+				Clock::absoluteTimeout( 1, &ts );
+				spaceCondition.wait( &mutex, &ts );
+			}
+			else {
+				spaceCondition.wait( &mutex );
+			}
+		}
+		catch( char const* msg ) {
+			//canceled by cancel_receive()
+			__atomic_store_n( &producerParked, 0, __ATOMIC_RELAXED );
+			mutex.unlock();
+			throw msg;
+		}
+		Metrics::add( &stats.blockedNs, Metrics::nowNs() - t0 );
+	}
+	__atomic_store_n( &producerParked, 0, __ATOMIC_RELAXED );
+	mutex.unlock();
+}
+
+
+void SpscInPort::cancel_receive()
+{
+	InPort::cancel_receive();
+	mutex.lock();
+	spaceCondition.cancel();
+	mutex.unlock();
+}
+
+
+/**
+ * Parks the receiver until the sender published packets behind
+ * index \p h or the timeout (milliseconds, zero means infinite) expired.
+ * @return \c false on timeout.
+ */
+bool SpscInPort::waitForData( unsigned long h, long timeout )
+{
+	struct timespec ts;
+	if( timeout > 0 ) {
+		Clock::absoluteTimeout( timeout, &ts );
+	}
+
+	bool waited = false;
+	while( __atomic_load_n( &tail, __ATOMIC_ACQUIRE ) == h ) {
+		if( waited && timeout > 0 ) {
+			return false;
+		}
+
+		mutex.lock();
+		__atomic_store_n( &consumerParked, 1, __ATOMIC_SEQ_CST );
+		try{
+			if( __atomic_load_n( &tail, __ATOMIC_SEQ_CST ) == h ) {
+				unsigned long long t0 = Metrics::nowNs();
+				condition.wait( &mutex, timeout > 0 ? &ts : NULL );
+				Metrics::add( &stats.waitNs, Metrics::nowNs() - t0 );
+				waited = true;
+			}
+		}
+		catch( char const* msg ) {
+			__atomic_store_n( &consumerParked, 0, __ATOMIC_RELAXED );
+			mutex.unlock();
+			throw msg;
+		}
+		__atomic_store_n( &consumerParked, 0, __ATOMIC_RELAXED );
+		mutex.unlock();
+	}
+	return true;
+}
+
+
+/// Signal the receiver, but only if it is sleeping.
+void SpscInPort::wakeReceiver()
+{
+	if( __atomic_load_n( &consumerParked, __ATOMIC_SEQ_CST ) ) {
+		mutex.lock();
+		condition.signal();
+		mutex.unlock();
+	}
+	notifyReceiver();
+}
+
+
+/// Signal a lossless sender, but only if it is sleeping.
+void SpscInPort::wakeSender()
+{
+	if( __atomic_load_n( &producerParked, __ATOMIC_SEQ_CST ) ) {
+		mutex.lock();
+		spaceCondition.signal();
+		mutex.unlock();
+	}
+}
+
+
+void SpscInPort::enqueue( DataPacket *p )
+{
+	unsigned long t = tail;
+
+	while( t - __atomic_load_n( &head, __ATOMIC_ACQUIRE ) >= maxQueueSize ) {
+		if( !lossless ) {
+			discard( p );
+			return;
+		}
+		try {
+			waitForSpace( t );
+		}
+		catch( char const* msg ) {
+			delete p;
+			throw msg;
+		}
+	}
+
+	ring[t & mask] = p;
+	errQueueCounter = 0;
+	__atomic_store_n( &tail, t + 1, __ATOMIC_SEQ_CST );
+	Metrics::add( &stats.enqueued, 1 );
+	Metrics::max( &stats.maxDepth, t + 1 - __atomic_load_n( &head, __ATOMIC_RELAXED ) );
+	wakeReceiver();
+}
+
+
+void SpscInPort::enqueueBatch( const vector<DataPacket*> &packets )
+{
+	unsigned long t = tail;
+	unsigned int i = 0;
+
+	while( i < packets.size() ) {
+		unsigned long free = maxQueueSize - (t - __atomic_load_n( &head, __ATOMIC_ACQUIRE ));
+		if( free == 0 ) {
+			if( !lossless ) {
+				for( ; i < packets.size(); i++ ) {
+					discard( packets[i] );
+				}
+				break;
+			}
+			try {
+				waitForSpace( t );
+			}
+			catch( char const* msg ) {
+				for( ; i < packets.size(); i++ ) {
+					delete packets[i];
+				}
+				throw msg;
+			}
+			continue;
+		}
+
+		unsigned int first = i;
+		for( ; free > 0 && i < packets.size(); free--, i++ ) {
+			ring[t++ & mask] = packets[i];
+		}
+		errQueueCounter = 0;
+		__atomic_store_n( &tail, t, __ATOMIC_SEQ_CST );
+		Metrics::add( &stats.enqueued, i - first );
+		Metrics::max( &stats.maxDepth, t - __atomic_load_n( &head, __ATOMIC_RELAXED ) );
+		wakeReceiver();
+	}
+}
+
+
+DataPacket* SpscInPort::receive( long timeout )
+{
+	unsigned long h = head;
+
+	if( !waitForData( h, timeout ) ) {
+		return NULL;	//timeout
+	}
+
+	DataPacket *p = ring[h & mask];
+	__atomic_store_n( &head, h + 1, __ATOMIC_SEQ_CST );
+	Metrics::add( &stats.received, 1 );
+	wakeSender();
+	return p;
+}
+
+
+unsigned int SpscInPort::receiveBatch( vector<DataPacket*> &out, unsigned int maxN, long timeout )
+{
+	unsigned long h = head;
+
+	if( maxN == 0 || !waitForData( h, timeout ) ) {
+		return 0;
+	}
+
+	unsigned long available = __atomic_load_n( &tail, __ATOMIC_ACQUIRE ) - h;
+	unsigned int n = available < maxN ? available : maxN;
+	for( unsigned int i = 0; i < n; i++ ) {
+		out.push_back( ring[(h + i) & mask] );
+	}
+	__atomic_store_n( &head, h + n, __ATOMIC_SEQ_CST );
+	Metrics::add( &stats.received, n );
+	wakeSender();
+	return n;
+}
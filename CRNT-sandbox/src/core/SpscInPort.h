@@ -0,0 +1,114 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SpscInPort.h - lock-free single-producer/single-consumer in-port
+
+#ifndef SPSCINPORT_H
+#define SPSCINPORT_H
+
+#include "InPort.h"
+
+
+/**
+ * \ingroup core
+ * \brief Lock-free In-Port for one sender and one receiver.
+ *
+ * The packets are kept in a bounded ring buffer. enqueue() and receive()
+ * do not take a lock as long as the ring is neither empty (receiver side)
+ * nor full (sender side in lossless mode). The mutex and condition are
+ * only used for parking a thread, and a sender only signals the receiver
+ * if it is actually parked.
+ *
+ * Drop and lossless semantics are the same as for InPort, but a lossless
+ * SpscInPort never queues beyond its capacity. It therefore cannot be used
+ * by a scheduled task: a sending worker could wait for a receiver that is
+ * further down its own stack. setLossless() and setScheduler() reject the
+ * combination and keep the port lossy.
+ *
+ * \warning Only one thread may call enqueue() and only one thread may call
+ * receive(), i.e. the port must be connected to a single OutPort.
+ */
+class SpscInPort: public InPort
+{
+	public:
+		/// Ring capacity used if the maximal queue size is zero (infinite).
+		static const unsigned int DEFAULT_CAPACITY = 4096;
+
+		SpscInPort();
+		SpscInPort( const SpscInPort& p );
+		virtual ~SpscInPort();
+
+		virtual DataPacket* receive( long timeout = 0 );
+		virtual unsigned int receiveBatch( std::vector<DataPacket*> &out, unsigned int maxN, long timeout = 0 );
+		virtual void enqueue( DataPacket *p );
+		virtual void enqueueBatch( const std::vector<DataPacket*> &packets );
+		virtual bool notEmpty();
+		virtual bool isEmpty();
+		virtual InPortStats getStats();
+
+		/**
+		 * \brief Cancel the receiver and a lossless sender parked on the full ring.
+		 *
+		 * The sender throws "condition canceled" like the receiver; the
+		 * packets it could not queue are deleted.
+		 */
+		virtual void cancel_receive();
+
+		/**
+		 * \brief Set the maximal number of packets the in-port queue allows.
+		 *
+		 * The ring is resized if it is empty. A value of 0 selects
+		 * DEFAULT_CAPACITY, as the ring is always bounded.
+		 */
+		virtual void setMaxQueueSize( unsigned int size );
+
+		/**
+		 * \brief Set lossless mode, see InPort::setLossless().
+		 *
+		 * Rejected with an error if the port has a scheduler.
+		 */
+		virtual void setLossless( bool flag );
+
+		/**
+		 * \brief Let \p s schedule the owner task, see InPort::setScheduler().
+		 *
+		 * A lossless port is switched to lossy mode with an error.
+		 */
+		virtual void setScheduler( TaskScheduler *s );
+
+	protected:
+		DataPacket **ring;
+		unsigned long mask;
+
+		// consumer and producer indices on separate cache lines
+		char pad0[64];
+		unsigned long head;			///< Next slot to read (receiver).
+		int consumerParked;
+		char pad1[64];
+		unsigned long tail;			///< Next slot to write (sender).
+		int producerParked;
+		char pad2[64];
+
+		Condition spaceCondition;	///< Lossless sender waits here.
+
+		void resizeRing( unsigned int size );
+		bool waitForData( unsigned long h, long timeout );
+		void waitForSpace( unsigned long t );
+		void wakeReceiver();
+		void wakeSender();
+};
+
+
+#endif	//SPSCINPORT_H
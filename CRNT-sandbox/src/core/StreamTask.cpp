@@ -17,17 +17,26 @@
 
 
 #include "StreamTask.h"
+#include "SpscInPort.h"
+#include "TaskScheduler.h"
 
 #include <iostream>
 #include <fstream>
 
 using namespace std;
 
-StreamTask::StreamTask( unsigned int inports, unsigned int outports ) : running(false), parent(NULL)
+StreamTask::StreamTask( unsigned int inports, unsigned int outports ) :
+	running(false), parent(NULL), schedState(TASK_STOPPED), schedStopping(0),
+	processCalls(0), busyNs(0)
 {
 	inPortBufferSize= 9999;
 	inPortLossless= false;
+	inPortSingleProducer = false;
 	inPortSilent = false;
+	scheduled = false;
+	poolPackets = 64;
+	poolChannels = 8;
+	fixedPoint = false;
 	disabled = false;
 	std::string descriptionURL ="";
 
@@ -46,7 +55,8 @@ StreamTask::StreamTask( unsigned int inports, unsigned int outports ) : running(
 
 
 /// Copy constructor.
-StreamTask::StreamTask( const StreamTask& s )
+StreamTask::StreamTask( const StreamTask& s ) :
+	schedState(TASK_STOPPED), schedStopping(0), processCalls(0), busyNs(0)
 {
 	unsigned int inports = s.inPorts.size();
 	unsigned int outports = s.outPorts.size();
@@ -55,13 +65,18 @@ StreamTask::StreamTask( const StreamTask& s )
 		<< "\tinports: " << inports 
 		<< ", outports: " << outports << endl;
 	
+	inPortSingleProducer = s.inPortSingleProducer;
 	for( unsigned int i = 0; i < inports; i++ ) {
-		inPorts.push_back( new InPort() );
+		inPorts.push_back( newInPort() );
 	}
 	for( unsigned int i = 0; i < outports; i++ ) {
 		outPorts.push_back( new OutPort() );
 	}
 
+	poolPackets = s.poolPackets;
+	poolChannels = s.poolChannels;
+	scheduled = s.scheduled;
+	fixedPoint = s.fixedPoint;
 	running = false;
 }
 
@@ -104,6 +119,18 @@ void StreamTask::initPorts()
 }
 
 
+/**
+ * \brief Create an in-port of the type selected by inPortSingleProducer.
+ */
+InPort *StreamTask::newInPort()
+{
+	if( inPortSingleProducer ) {
+		return new SpscInPort();
+	}
+	return new InPort();
+}
+
+
 /**
  * \brief Add in-ports to this task.
  *
@@ -113,7 +140,7 @@ void StreamTask::initPorts()
 int StreamTask::addInPorts( unsigned int n )
 {
 	for( unsigned int i = 0; i < n; i++ ) {
-		inPorts.push_back( new InPort() );
+		inPorts.push_back( newInPort() );
 	}
 	initPorts();
 	return inPorts.size();
@@ -150,7 +177,7 @@ void StreamTask::setInPortNum( unsigned int n )
 	inPorts.clear();
 
 	for( unsigned int i = 0; i < n; i++ ) {
-		inPorts.push_back( new InPort() );
+		inPorts.push_back( newInPort() );
 	}
 	initPorts();
 }
@@ -195,8 +222,18 @@ void StreamTask::start()
 	}
 	
 	if( !running ) {
+		DataPacket::reservePool( poolPackets, poolChannels );
 		running = true;
-		init();
+		if( scheduled ) {
+			TaskScheduler *scheduler = TaskScheduler::getInstance();
+			for( unsigned int i = 0; i < inPorts.size(); i++ ) {
+				inPorts[i]->setScheduler( scheduler );
+			}
+			scheduler->add( this );
+		}
+		else {
+			init();
+		}
 		log( "start(): started." );
 	}
 	else {
@@ -215,9 +252,19 @@ void StreamTask::stop()
 		return;
 	}
 	
-	exitNow();
 	running = false;
 	log( "stop(): stopping..." );
+
+	if( scheduled ) {
+		TaskScheduler::getInstance()->remove( this );
+		for( unsigned int i = 0; i < inPorts.size(); i++ ) {
+			inPorts[i]->setScheduler( NULL );
+		}
+		log( "stop(): done." );
+		return;
+	}
+
+	exitNow();
 	
 	// cancel inports
 	for( unsigned int i = 0; i < inPorts.size(); i++ ) {
@@ -270,9 +317,43 @@ string StreamTask::identify()
 
 bool StreamTask::isStopped()
 {
+	if( scheduled ) {
+		return __atomic_load_n( &schedState, __ATOMIC_SEQ_CST ) == TASK_STOPPED;
+	}
 	return !isInitialized();
 }
 
+
+TaskStats StreamTask::getStats()
+{
+	TaskStats s;
+	s.id = getId();
+	s.type = getTypeName();
+	s.running = running;
+	s.scheduled = scheduled;
+	s.processCalls = Metrics::get( &processCalls );
+	s.busyNs = Metrics::get( &busyNs );
+	for( unsigned int i = 0; i < inPorts.size(); i++ ) {
+		s.inPorts.push_back( inPorts[i]->getStats() );
+	}
+	for( unsigned int i = 0; i < outPorts.size(); i++ ) {
+		s.outPorts.push_back( outPorts[i]->getStats() );
+	}
+	return s;
+}
+
+
+/// Check if any in-port has data (used by the TaskScheduler).
+bool StreamTask::hasInput()
+{
+	for( unsigned int i = 0; i < inPorts.size(); i++ ) {
+		if( inPorts[i]->notEmpty() ) {
+			return true;
+		}
+	}
+	return false;
+}
+
 string StreamTask::getDescriptionURL()
 {
 	return descriptionURL;
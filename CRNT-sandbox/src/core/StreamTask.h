@@ -68,8 +68,32 @@ class StreamTask : public Thread
 		virtual std::string readDescription();
 
 		virtual void setParent(StreamTaskContainer *parent);
+
+		/// Select the fixed-point execution mode, see #fixedPoint.
+		void setFixedPoint( bool on ) { fixedPoint = on; }
+
+		/// Check if the task computes in fixed point.
+		bool isFixedPoint() const { return fixedPoint; }
+
+		/**
+		 * \brief Get a snapshot of the counters of this task and its ports.
+		 * \see MetricsReporter
+		 */
+		virtual TaskStats getStats();
 	
 	protected:
+		/**
+		 * \brief Process the packets that are available.
+		 *
+		 * Used instead of run() if the task is #scheduled. The method is
+		 * called by a worker of the TaskScheduler whenever an in-port of
+		 * the task received data. It must not block: take the packets
+		 * that are queued (InPort::notEmpty(), InPort::receiveBatch()),
+		 * handle them and return. If packets are left in the in-ports the
+		 * task is queued again.
+		 */
+		virtual void process() {};
+
 		/**
 		 * Cancel all calls that might be blocking this task in the run() method.
 		 * It allows a task to stop execution. This method is called from the stop() method.
@@ -81,6 +105,7 @@ class StreamTask : public Thread
 		
 		void paramsChanged();
 		
+		InPort *newInPort();
 		int addInPorts( unsigned int n );
 		int addOutPorts( unsigned int n );
 		void setInPortNum( unsigned int n );
@@ -104,6 +129,18 @@ class StreamTask : public Thread
 		 */
 		bool inPortLossless; //(false);
 
+		/**
+		 * \brief Use lock-free single-producer in-ports.
+		 *
+		 * If set, in-ports created by addInPorts() and setInPortNum() are
+		 * SpscInPort objects. Only set this for tasks whose in-ports are
+		 * connected to exactly one out-port each. Subclasses set the flag in
+		 * their constructor and then call setInPortNum(). Such in-ports
+		 * cannot be lossless in a #scheduled task.
+		 * \see SpscInPort
+		 */
+		bool inPortSingleProducer; //(false);
+
 		/**
 		 * \brief Silent mode to use for each in-port.
 		 * 
@@ -112,6 +149,41 @@ class StreamTask : public Thread
 		 */
 		bool inPortSilent; //(false);
 
+		/**
+		 * \brief Execute the task on the TaskScheduler.
+		 *
+		 * If set, start() does not create a thread for this task. Instead
+		 * process() is called by a shared worker pool whenever the in-ports
+		 * have data. Only set this flag in the constructor of subclasses that
+		 * implement process(). Tasks that need to block (e.g. readers)
+		 * keep their own thread and run() method.
+		 * \see TaskScheduler
+		 */
+		bool scheduled; //(false);
+
+		/**
+		 * \brief Number of data packets to preallocate in the PacketPool.
+		 *
+		 * The pool is filled when the task is started.
+		 * \see DataPacket::reservePool()
+		 */
+		unsigned int poolPackets; //(64);
+
+		/**
+		 * \brief Number of channels per preallocated data packet.
+		 */
+		unsigned int poolChannels; //(8);
+
+		/**
+		 * \brief Compute in Q16.16 fixed point instead of float.
+		 *
+		 * Tasks that support it (e.g. WindowStatistics) process their
+		 * channels with FixedMath when the flag is set, e.g. on processors
+		 * without a fast FPU. Other tasks ignore it.
+		 * \see setFixedPoint()
+		 */
+		bool fixedPoint; //(false);
+
 		/**
 		 * \brief Do not start task if 'true'.
 		 */
@@ -133,6 +205,24 @@ class StreamTask : public Thread
 		void initPorts();
 		
 		StreamTaskContainer *parent;
+
+	private:
+		friend class TaskScheduler;
+
+		/// States of a scheduled task.
+		enum {
+			TASK_STOPPED,	///< not added to the scheduler
+			TASK_IDLE,		///< waiting for data
+			TASK_QUEUED,	///< in a queue of the scheduler
+			TASK_RUNNING,	///< process() is executed
+			TASK_NOTIFIED	///< running, new data arrived meanwhile
+		};
+		int schedState;
+		int schedStopping;
+		unsigned long long processCalls;
+		unsigned long long busyNs;
+
+		bool hasInput();
 };
 
 
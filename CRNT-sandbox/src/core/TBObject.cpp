@@ -17,7 +17,7 @@
 
 #include <typeinfo>
 #include "TBObject.h"
-#include "Mutex.h"
+#include "AsyncLog.h"
 
 using namespace std;
 
@@ -36,34 +36,35 @@ void TBObject::setId( string id ) { this->id = id; paramsChanged(); }
 
 string TBObject::getType() const
 {
-	string crypticName = typeid(*this).name();
-	size_t startPos = crypticName.find_first_not_of("0123456789");
-	return crypticName.substr(startPos);
+	return getTypeName();
+}
+
+
+/**
+ * The name is taken from the (static) mangled name of the type, so no
+ * memory is allocated. It is looked up on every call because the dynamic
+ * type changes while base class constructors are running.
+ */
+const char *TBObject::getTypeName() const
+{
+	const char *name = typeid(*this).name();
+	while( *name >= '0' && *name <= '9' ) {
+		name++;
+	}
+	return name;
 }
 
 
 /**
  * Writes the Message msg to the standard error output.
- * A reference to the used output-stream is returned.
+ * The message is written asynchronously by the AsyncLog.
+ * A reference to the stream for additional text is returned,
+ * this text is committed at every endl.
  * @param msg The log message.
  * @return The ostream used for the output.
  */
 ostream& TBObject::log( const char *msg ) const
 {
-	time_t rawtime;
-	time( &rawtime );
-	char timestring[20];
-	
-	//need mutex because localtime() is not thread-safe
-	//also nice to sync log messages (at least the first line)
-	Mutex::GLOBAL_MUTEX.lock();
-		struct tm *timeinfo = localtime( &rawtime );
-		strftime( timestring, 20, "%b %d %X", timeinfo );
-		clog << timestring << " [" << id << "] ::: "
-			 << this->getType()
-			 << " @ " << this << ": " << msg << endl;
-	Mutex::GLOBAL_MUTEX.unlock();
-	
-	return clog;
+	return AsyncLog::write( id.c_str(), getTypeName(), this, msg );
 }
 
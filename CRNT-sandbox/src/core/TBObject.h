@@ -37,6 +37,7 @@ class TBObject
 		virtual void setId( std::string id );	///< Set the id string.
 		virtual std::string getId() const;		///< Get the id string.
 		virtual std::string getType() const;		///< Get the name of the actual type.
+		const char *getTypeName() const;		///< Like getType(), without allocation.
 //		void setParams( Json::Value &jval ) { GIBN::setParams( jval ); }
 
 	protected:
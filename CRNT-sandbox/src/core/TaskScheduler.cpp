@@ -0,0 +1,430 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// TaskScheduler.cpp
+
+#include "TaskScheduler.h"
+#include "StreamTask.h"
+#include "SocketException.h"
+#include <unistd.h>
+#include <sched.h>
+#include <stdio.h>
+#include <exception>
+
+using namespace std;
+
+
+TaskScheduler *TaskScheduler::instance = NULL;
+Mutex TaskScheduler::instanceMutex;
+
+static pthread_key_t workerKey;
+static pthread_once_t workerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void createWorkerKey()
+{
+	pthread_key_create( &workerKey, NULL );
+}
+
+
+/*
+ * Work-stealing deque
+ *
+ * The owner pushes and pops at the bottom, thieves take from the top.
+ * Only the last element is contended, which is resolved with a CAS on top.
+ */
+
+bool TaskScheduler::WorkDeque::push( StreamTask *t )
+{
+	long b = __atomic_load_n( &bottom, __ATOMIC_RELAXED );
+	long tp = __atomic_load_n( &top, __ATOMIC_ACQUIRE );
+	if( b - tp >= CAPACITY ) {
+		return false;
+	}
+	__atomic_store_n( &buffer[b & (CAPACITY - 1)], t, __ATOMIC_RELAXED );
+	__atomic_store_n( &bottom, b + 1, __ATOMIC_RELEASE );
+	return true;
+}
+
+
+StreamTask *TaskScheduler::WorkDeque::pop()
+{
+	long b = __atomic_load_n( &bottom, __ATOMIC_RELAXED ) - 1;
+	__atomic_store_n( &bottom, b, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	long tp = __atomic_load_n( &top, __ATOMIC_RELAXED );
+
+	if( tp > b ) {
+		//empty
+		__atomic_store_n( &bottom, b + 1, __ATOMIC_RELAXED );
+		return NULL;
+	}
+
+	StreamTask *t = __atomic_load_n( &buffer[b & (CAPACITY - 1)], __ATOMIC_RELAXED );
+	if( tp == b ) {
+		//last element, race against thieves
+		if( !__atomic_compare_exchange_n( &top, &tp, tp + 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) ) {
+			t = NULL;
+		}
+		__atomic_store_n( &bottom, b + 1, __ATOMIC_RELAXED );
+	}
+	return t;
+}
+
+
+StreamTask *TaskScheduler::WorkDeque::steal()
+{
+	long tp = __atomic_load_n( &top, __ATOMIC_ACQUIRE );
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	long b = __atomic_load_n( &bottom, __ATOMIC_ACQUIRE );
+
+	if( tp >= b ) {
+		return NULL;
+	}
+	StreamTask *t = __atomic_load_n( &buffer[tp & (CAPACITY - 1)], __ATOMIC_RELAXED );
+	if( !__atomic_compare_exchange_n( &top, &tp, tp + 1, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) ) {
+		return NULL;	//lost the race
+	}
+	return t;
+}
+
+
+long TaskScheduler::WorkDeque::size() const
+{
+	long n = __atomic_load_n( &bottom, __ATOMIC_SEQ_CST ) - __atomic_load_n( &top, __ATOMIC_SEQ_CST );
+	return n > 0 ? n : 0;
+}
+
+
+/*
+ * Worker
+ */
+
+void TaskScheduler::Worker::run()
+{
+	pthread_setspecific( workerKey, this );
+	while( !exiting() ) {
+		StreamTask *t = scheduler->findWork( this );
+		if( t ) {
+			scheduler->execute( this, t );
+		}
+		else {
+			scheduler->park();
+		}
+	}
+}
+
+
+string TaskScheduler::Worker::identify()
+{
+	char num[16];
+	sprintf( num, "%u", index );
+	return scheduler->getId() + ":worker" + num;
+}
+
+
+/*
+ * TaskScheduler
+ */
+
+TaskScheduler::TaskScheduler( unsigned int n ) : sleepers(0), shuttingDown(false)
+{
+	pthread_once( &workerKeyOnce, createWorkerKey );
+
+	if( n == 0 ) {
+		long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+		n = cpus > 0 ? cpus : 1;
+	}
+	for( unsigned int i = 0; i < n; i++ ) {
+		workers.push_back( new Worker( this, i ) );
+	}
+	for( unsigned int i = 0; i < n; i++ ) {
+		workers[i]->init();
+	}
+	log( "started" ) << "\tworkers: " << n << endl;
+}
+
+
+/**
+ * All tasks must have been removed before.
+ */
+TaskScheduler::~TaskScheduler()
+{
+	mutex.lock();
+	shuttingDown = true;
+	for( unsigned int i = 0; i < workers.size(); i++ ) {
+		workers[i]->exitNow();
+		condition.signal();
+	}
+	mutex.unlock();
+
+	for( unsigned int i = 0; i < workers.size(); i++ ) {
+		workers[i]->joinMe();
+		delete workers[i];
+	}
+}
+
+
+TaskScheduler *TaskScheduler::getInstance()
+{
+	instanceMutex.lock();
+	if( !instance ) {
+		instance = new TaskScheduler();
+		instance->setId( "TaskScheduler" );
+	}
+	instanceMutex.unlock();
+	return instance;
+}
+
+
+TaskScheduler::Worker *TaskScheduler::currentWorker()
+{
+	//the key is created with the first scheduler, it may be asked for before
+	pthread_once( &workerKeyOnce, createWorkerKey );
+	return static_cast<Worker *>( pthread_getspecific( workerKey ) );
+}
+
+
+bool TaskScheduler::helpOne()
+{
+	Worker *w = currentWorker();
+	if( !w ) {
+		return false;
+	}
+	StreamTask *t = w->scheduler->findWork( w );
+	if( !t ) {
+		return false;
+	}
+	w->scheduler->execute( w, t );
+	return true;
+}
+
+
+void TaskScheduler::add( StreamTask *task )
+{
+	__atomic_store_n( &task->schedStopping, 0, __ATOMIC_SEQ_CST );
+	__atomic_store_n( &task->schedState, StreamTask::TASK_IDLE, __ATOMIC_SEQ_CST );
+	if( task->hasInput() ) {
+		schedule( task );
+	}
+}
+
+
+void TaskScheduler::remove( StreamTask *task )
+{
+	__atomic_store_n( &task->schedStopping, 1, __ATOMIC_SEQ_CST );
+
+	//stopped from within its own process() on this worker: nobody else will finish it
+	Worker *w = currentWorker();
+	if( w ) {
+		for( unsigned int i = 0; i < w->running.size(); i++ ) {
+			if( w->running[i] == task ) {
+				__atomic_store_n( &task->schedState, StreamTask::TASK_STOPPED, __ATOMIC_SEQ_CST );
+				return;
+			}
+		}
+	}
+
+	for( ;; ) {
+		int s = __atomic_load_n( &task->schedState, __ATOMIC_SEQ_CST );
+		if( s == StreamTask::TASK_STOPPED ) {
+			break;
+		}
+		if( s == StreamTask::TASK_IDLE
+				&& __atomic_compare_exchange_n( &task->schedState, &s, StreamTask::TASK_STOPPED,
+						false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) {
+			break;
+		}
+		//queued or running, a worker will mark it stopped; the task may be
+		//queued in the deque of this worker, so run queued tasks meanwhile
+		if( w ) {
+			if( !helpOne() ) {
+				sched_yield();
+			}
+		}
+		else {
+			usleep( 1000 );
+		}
+	}
+}
+
+
+/**
+ * A task that is running already is only marked, the worker queues it
+ * again when process() returns.
+ */
+void TaskScheduler::schedule( StreamTask *task )
+{
+	for( ;; ) {
+		if( __atomic_load_n( &task->schedStopping, __ATOMIC_SEQ_CST ) ) {
+			return;
+		}
+		int s = __atomic_load_n( &task->schedState, __ATOMIC_SEQ_CST );
+		if( s == StreamTask::TASK_IDLE ) {
+			if( __atomic_compare_exchange_n( &task->schedState, &s, StreamTask::TASK_QUEUED,
+					false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) {
+				submit( task );
+				return;
+			}
+		}
+		else if( s == StreamTask::TASK_RUNNING ) {
+			if( __atomic_compare_exchange_n( &task->schedState, &s, StreamTask::TASK_NOTIFIED,
+					false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) {
+				return;
+			}
+		}
+		else {
+			return;	//queued, notified or stopped
+		}
+	}
+}
+
+
+/**
+ * Pushes a queued task to the deque of the calling worker or to the
+ * injection queue and wakes up a sleeping worker, unless the caller is a
+ * worker that runs the task next anyway: it returned from process() and
+ * has nothing else queued. A send() inside a (possibly long) process()
+ * always wakes a sleeper.
+ */
+void TaskScheduler::submit( StreamTask *task )
+{
+	Worker *w = currentWorker();
+	bool wake = true;
+	if( w && w->scheduler == this && w->deque.push( task ) ) {
+		wake = w->deque.size() > 1 || !w->running.empty();
+	}
+	else {
+		mutex.lock();
+		injected.push_back( task );
+		mutex.unlock();
+	}
+
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	if( wake && __atomic_load_n( &sleepers, __ATOMIC_SEQ_CST ) > 0 ) {
+		mutex.lock();
+		condition.signal();
+		mutex.unlock();
+	}
+}
+
+
+StreamTask *TaskScheduler::findWork( Worker *w )
+{
+	StreamTask *t = w->deque.pop();
+	if( t ) {
+		return t;
+	}
+
+	mutex.lock();
+	if( !injected.empty() ) {
+		t = injected.front();
+		injected.pop_front();
+	}
+	mutex.unlock();
+	if( t ) {
+		return t;
+	}
+
+	for( unsigned int k = 1; k < workers.size(); k++ ) {
+		Worker *victim = workers[(w->index + k) % workers.size()];
+		t = victim->deque.steal();
+		if( t ) {
+			return t;
+		}
+	}
+	return NULL;
+}
+
+
+/// Check for queued tasks, the mutex must be locked.
+bool TaskScheduler::workAvailable()
+{
+	if( !injected.empty() ) {
+		return true;
+	}
+	for( unsigned int i = 0; i < workers.size(); i++ ) {
+		if( workers[i]->deque.size() > 0 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void TaskScheduler::park()
+{
+	mutex.lock();
+	__atomic_add_fetch( &sleepers, 1, __ATOMIC_SEQ_CST );
+	if( !shuttingDown && !workAvailable() ) {
+		condition.wait( &mutex );
+	}
+	__atomic_sub_fetch( &sleepers, 1, __ATOMIC_SEQ_CST );
+	mutex.unlock();
+}
+
+
+void TaskScheduler::execute( Worker *w, StreamTask *task )
+{
+	int s = StreamTask::TASK_QUEUED;
+	__atomic_compare_exchange_n( &task->schedState, &s, StreamTask::TASK_RUNNING,
+			false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+
+	if( !__atomic_load_n( &task->schedStopping, __ATOMIC_SEQ_CST ) ) {
+		unsigned long long t0 = Metrics::nowNs();
+		w->running.push_back( task );
+		try {
+			task->process();
+		}
+		catch( char const* msg ) {
+			log( "ERROR: task did not catch exception" )
+				<< "\ttask: " << task->getId() << endl
+				<< "\texception: " << msg << endl;
+			__atomic_store_n( &task->schedStopping, 1, __ATOMIC_SEQ_CST );
+		}
+		catch( SocketException &e ) {
+			log( "ERROR: task did not catch socket exception" )
+				<< "\ttask: " << task->getId() << endl
+				<< "\texception: " << e.description() << endl;
+			__atomic_store_n( &task->schedStopping, 1, __ATOMIC_SEQ_CST );
+		}
+		catch( exception &e ) {
+			log( "ERROR: task did not catch exception" )
+				<< "\ttask: " << task->getId() << endl
+				<< "\texception: " << e.what() << endl;
+			__atomic_store_n( &task->schedStopping, 1, __ATOMIC_SEQ_CST );
+		}
+		w->running.pop_back();
+		Metrics::add( &task->busyNs, Metrics::nowNs() - t0 );
+		Metrics::add( &task->processCalls, 1 );
+	}
+
+	if( __atomic_load_n( &task->schedStopping, __ATOMIC_SEQ_CST ) ) {
+		__atomic_store_n( &task->schedState, StreamTask::TASK_STOPPED, __ATOMIC_SEQ_CST );
+		return;
+	}
+
+	//process() may have left packets in the queue; the task must not be
+	//touched any more once it is idle, it could be removed and deleted
+	s = StreamTask::TASK_RUNNING;
+	if( task->hasInput()
+			|| !__atomic_compare_exchange_n( &task->schedState, &s, StreamTask::TASK_IDLE,
+					false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) {
+		//more data, or notified while running
+		__atomic_store_n( &task->schedState, StreamTask::TASK_QUEUED, __ATOMIC_SEQ_CST );
+		submit( task );
+	}
+}
@@ -0,0 +1,141 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// TaskScheduler.h - worker pool for scheduled stream tasks
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include "Thread.h"
+#include "Mutex.h"
+#include "Condition.h"
+#include <deque>
+#include <vector>
+
+class StreamTask;
+
+
+/**
+ * \ingroup core
+ * \brief Runs scheduled stream tasks on a fixed pool of worker threads.
+ *
+ * Instead of one thread per task, tasks that set StreamTask::scheduled are
+ * executed by a few worker threads (one per CPU core by default). A task
+ * is queued whenever one of its in-ports receives a packet; a worker then
+ * calls its StreamTask::process() method. A task is never executed by two
+ * workers at the same time.
+ *
+ * Every worker owns a work-stealing deque (Chase-Lev). Tasks that are
+ * made runnable by a worker (i.e. by a send() inside process()) are pushed
+ * to the deque of that worker and run next, while the packets are still in
+ * its cache. Idle workers steal from the other end of the deques of their
+ * peers. Tasks made runnable by other threads (e.g. reader tasks with
+ * their own thread) go to a shared injection queue.
+ */
+class TaskScheduler : public TBObject
+{
+	public:
+		/**
+		 * \param workers Number of worker threads. Zero uses the number of
+		 * online processors.
+		 */
+		TaskScheduler( unsigned int workers = 0 );
+		virtual ~TaskScheduler();
+
+		/// Get the scheduler shared by all tasks (created on first use).
+		static TaskScheduler *getInstance();
+
+		/// Start executing \p task. Called by StreamTask::start().
+		void add( StreamTask *task );
+
+		/**
+		 * \brief Stop executing \p task.
+		 *
+		 * Blocks until the task is neither running nor queued. Called by
+		 * StreamTask::stop(). A worker that calls it runs queued tasks
+		 * meanwhile; if the task is in process() on the calling worker
+		 * (it stops itself), it is marked stopped without waiting.
+		 */
+		void remove( StreamTask *task );
+
+		/// Make \p task runnable. Called by the in-ports of the task.
+		void schedule( StreamTask *task );
+
+		/**
+		 * \brief Let a blocked worker run another queued task.
+		 *
+		 * Called by lossless in-ports before a sender waits for space. If
+		 * the calling thread is a worker, it executes one queued task
+		 * (possibly the receiver it is waiting for) instead of sleeping,
+		 * which could deadlock the pool.
+		 * \return false if the caller is no worker or nothing was queued.
+		 */
+		static bool helpOne();
+
+		/// Check if the calling thread is a worker of a TaskScheduler.
+		static bool isWorkerThread() { return currentWorker() != NULL; }
+
+		/// Get the number of worker threads.
+		unsigned int getWorkerCount() const { return workers.size(); }
+
+	private:
+		/// Chase-Lev work-stealing deque of fixed capacity.
+		class WorkDeque {
+			public:
+				static const long CAPACITY = 1024;
+				WorkDeque() : top(0), bottom(0) {}
+				bool push( StreamTask *t );		///< Owner only.
+				StreamTask *pop();				///< Owner only.
+				StreamTask *steal();			///< Any thread.
+				long size() const;				///< Approximate number of tasks.
+			private:
+				long top;
+				char pad1[64];
+				long bottom;
+				char pad2[64];
+				StreamTask *buffer[CAPACITY];
+		};
+
+		class Worker : public Thread {
+			public:
+				Worker( TaskScheduler *s, unsigned int i ) : scheduler( s ), index( i ) {}
+				void run();
+				std::string identify();
+				TaskScheduler *scheduler;
+				unsigned int index;
+				WorkDeque deque;
+				std::vector<StreamTask *> running;	///< Tasks in process() on this worker, nested by helpOne().
+		};
+
+		std::vector<Worker *> workers;
+		std::deque<StreamTask *> injected;
+		Mutex mutex;		///< Protects injected, used for parking.
+		Condition condition;
+		int sleepers;
+		bool shuttingDown;
+
+		void submit( StreamTask *task );
+		StreamTask *findWork( Worker *w );
+		bool workAvailable();
+		void park();
+		void execute( Worker *w, StreamTask *task );
+		static Worker *currentWorker();
+
+		static TaskScheduler *instance;
+		static Mutex instanceMutex;
+};
+
+
+#endif	//TASKSCHEDULER_H
@@ -21,8 +21,16 @@
 Timer::Timer( struct timeval fireTimeVal, CallbackObj *callbackObject )
 : callbackObject(callbackObject)
 {
-	fireTime.tv_sec = fireTimeVal.tv_sec;
-	fireTime.tv_nsec = 1000 * fireTimeVal.tv_usec;
+	Clock::toTimespec( Clock::fromTimeval( fireTimeVal ), &fireTime );
+	timerIsSet = true;
+	
+	init();
+}
+
+Timer::Timer( unsigned long long fireTimeNs, CallbackObj *callbackObject )
+: callbackObject(callbackObject)
+{
+	Clock::toTimespec( fireTimeNs, &fireTime );
 	timerIsSet = true;
 	
 	init();
@@ -36,10 +44,14 @@ std::string Timer::identify()
 }
 
 void Timer::set( struct timeval fireTimeVal )
+{
+	set( Clock::fromTimeval( fireTimeVal ) );
+}
+
+void Timer::set( unsigned long long fireTimeNs )
 {
 	mutex.lock();
-	fireTime.tv_sec = fireTimeVal.tv_sec;
-	fireTime.tv_nsec = 1000 * fireTimeVal.tv_usec;
+	Clock::toTimespec( fireTimeNs, &fireTime );
 	timerIsSet = true;
 	mutex.unlock();
 }
@@ -21,6 +21,7 @@
 #include "Thread.h"
 #include "Condition.h"
 #include "Mutex.h"
+#include "Clock.h"
 
 /**
  * \ingroup core
@@ -35,15 +36,24 @@ class Timer: private Thread
 			public: virtual void callback(Timer *caller) = 0;
 		};
 
+		/// Timer firing at wall clock time \p fireTime.
 		Timer( struct timeval fireTime, CallbackObj *callbackObject );
+
+		/// Timer firing at monotonic time \p fireTimeNs (see Clock::nowNs()).
+		Timer( unsigned long long fireTimeNs, CallbackObj *callbackObject );
 		virtual ~Timer();
 		
 		/**
 		 * Set a (new) fire time for the timer. Do not call this method
 		 * if the timer is set but not fired yet. It is save to use it in
 		 * the callback method.
+		 * \note The wall clock time is mapped to the monotonic clock when
+		 * set, i.e. the timer does not follow later changes of the system time.
 		 */
 		virtual void set( struct timeval fireTime );
+
+		/// Set a (new) monotonic fire time (see set( struct timeval )).
+		virtual void set( unsigned long long fireTimeNs );
 		
 	private:
 		struct timespec fireTime;
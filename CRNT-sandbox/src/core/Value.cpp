@@ -18,6 +18,7 @@
 // Value.cpp
 
 #include "Value.h"
+#include "PacketPool.h"
 
 //part of lowercase-macro-workaround (see Value.h)
 #ifdef LOG2_WORKAROUND
@@ -27,6 +28,9 @@ double log2( double x ) { return LOG2_WORKAROUND( x ); }
  
 Value::Value( bool valid ) : valid( valid ) {}
 
+void *Value::operator new( size_t size ) { return PacketPool::allocate( size ); }
+void Value::operator delete( void *p, size_t size ) { PacketPool::release( p, size ); }
+
 bool Value::isValid() const { return valid; }
 void Value::setValid( bool v ) { valid = v; }
 void Value::invalidate() { valid = false; }
@@ -64,6 +64,10 @@ class Value: public TBObject
 		Value( bool valid = true );
 		virtual ~Value() {};
 
+		/// Values are allocated from the PacketPool.
+		static void *operator new( size_t size );
+		static void operator delete( void *p, size_t size );
+
 		/// Clone this object
 		virtual Value* clone() const = 0;
 		
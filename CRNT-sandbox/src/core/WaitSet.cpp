@@ -0,0 +1,220 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// WaitSet.cpp
+
+#include "WaitSet.h"
+#include "InPort.h"
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include "Clock.h"
+#include <stdint.h>
+
+using namespace std;
+
+
+void WaitSet::TimerSource::callback( Timer *caller )
+{
+	__atomic_store_n( &fired, 1, __ATOMIC_SEQ_CST );
+	waitSet->notify();
+}
+
+
+WaitSet::WaitSet() : armed(0), canceling(0), next(0)
+{
+	eventFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	if( eventFd < 0 ) {
+		log( "ERROR: eventfd() failed." );
+	}
+}
+
+
+WaitSet::~WaitSet()
+{
+	for( unsigned int i = 0; i < sources.size(); i++ ) {
+		if( sources[i].port ) {
+			sources[i].port->setWaitSet( NULL );
+		}
+		delete sources[i].timer;
+	}
+	if( eventFd >= 0 ) {
+		close( eventFd );
+	}
+}
+
+
+int WaitSet::addInPort( InPort *port )
+{
+	Source s = { port, NULL, -1, 0 };
+	sources.push_back( s );
+	port->setWaitSet( this );
+	return sources.size() - 1;
+}
+
+
+int WaitSet::addFd( int fd, short events )
+{
+	Source s = { NULL, NULL, fd, events };
+	sources.push_back( s );
+	fdSources.push_back( sources.size() - 1 );
+	return sources.size() - 1;
+}
+
+
+Timer::CallbackObj *WaitSet::addTimer( int *index )
+{
+	Source s = { NULL, new TimerSource( this ), -1, 0 };
+	sources.push_back( s );
+	if( index ) {
+		*index = sources.size() - 1;
+	}
+	return s.timer;
+}
+
+
+void WaitSet::notify()
+{
+	if( __atomic_exchange_n( &armed, 0, __ATOMIC_SEQ_CST ) ) {
+		uint64_t one = 1;
+		if( write( eventFd, &one, sizeof( one ) ) < 0 ) {
+			log( "ERROR: writing to eventfd failed." );
+		}
+	}
+}
+
+
+void WaitSet::cancel()
+{
+	__atomic_store_n( &canceling, 1, __ATOMIC_SEQ_CST );
+	uint64_t one = 1;
+	if( write( eventFd, &one, sizeof( one ) ) < 0 ) {
+		log( "ERROR: writing to eventfd failed." );
+	}
+}
+
+
+void WaitSet::checkCancel()
+{
+	if( __atomic_exchange_n( &canceling, 0, __ATOMIC_SEQ_CST ) ) {
+		__atomic_store_n( &armed, 0, __ATOMIC_SEQ_CST );
+		throw "condition canceled";
+	}
+}
+
+
+/**
+ * Polls the fd sources (and the eventfd).
+ * @return Index of a ready fd source, or -1.
+ */
+int WaitSet::pollFds( long timeout )
+{
+	vector<struct pollfd> fds( fdSources.size() + 1 );
+	fds[0].fd = eventFd;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	for( unsigned int i = 0; i < fdSources.size(); i++ ) {
+		fds[i+1].fd = sources[fdSources[i]].fd;
+		fds[i+1].events = sources[fdSources[i]].events;
+		fds[i+1].revents = 0;
+	}
+
+	int ret = poll( &fds[0], fds.size(), timeout );
+	if( ret < 0 && errno != EINTR ) {
+		log( "ERROR: poll() failed." );
+	}
+	if( ret <= 0 ) {
+		return -1;
+	}
+
+	if( fds[0].revents ) {
+		uint64_t count;
+		if( read( eventFd, &count, sizeof( count ) ) < 0 ) {
+			//nothing to drain
+		}
+	}
+	for( unsigned int i = 0; i < fdSources.size(); i++ ) {
+		if( fds[i+1].revents ) {
+			return fdSources[i];
+		}
+	}
+	return -1;
+}
+
+
+/**
+ * Checks all sources, starting at the round-robin index.
+ * @return Index of a ready source, or -1.
+ */
+int WaitSet::findReady( bool checkFds )
+{
+	unsigned int n = sources.size();
+	for( unsigned int k = 0; k < n; k++ ) {
+		unsigned int i = (next + k) % n;
+		Source &s = sources[i];
+		if( s.port && s.port->notEmpty() ) {
+			next = i + 1;
+			return i;
+		}
+		if( s.timer && __atomic_exchange_n( &s.timer->fired, 0, __ATOMIC_SEQ_CST ) ) {
+			next = i + 1;
+			return i;
+		}
+	}
+	if( checkFds && !fdSources.empty() ) {
+		return pollFds( 0 );
+	}
+	return -1;
+}
+
+
+int WaitSet::wait( long timeout )
+{
+	unsigned long long start = Clock::nowNs();
+
+	for( ;; ) {
+		checkCancel();
+
+		int i = findReady( true );
+		if( i >= 0 ) {
+			return i;
+		}
+
+		// announce that we are going to sleep, then check again
+		__atomic_store_n( &armed, 1, __ATOMIC_SEQ_CST );
+		i = findReady( false );
+		if( i >= 0 ) {
+			__atomic_store_n( &armed, 0, __ATOMIC_SEQ_CST );
+			return i;
+		}
+
+		long remaining = -1;
+		if( timeout > 0 ) {
+			long elapsed = (Clock::nowNs() - start) / 1000000;
+			if( elapsed >= timeout ) {
+				__atomic_store_n( &armed, 0, __ATOMIC_SEQ_CST );
+				return -1;
+			}
+			remaining = timeout - elapsed;
+		}
+
+		i = pollFds( remaining );
+		__atomic_store_n( &armed, 0, __ATOMIC_SEQ_CST );
+		if( i >= 0 ) {
+			return i;
+		}
+	}
+}
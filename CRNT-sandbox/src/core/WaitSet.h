@@ -0,0 +1,130 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// WaitSet.h - wait for several in-ports, timers and file descriptors
+
+#ifndef WAITSET_H
+#define WAITSET_H
+
+#include "TBObject.h"
+#include "Timer.h"
+#include <vector>
+
+class InPort;
+
+
+/**
+ * \ingroup core
+ * \brief Wait until one of several sources is ready.
+ *
+ * A WaitSet blocks a task until any of its sources has data: an InPort
+ * that is not empty, a Timer that fired or a file descriptor (e.g. a
+ * Socket) that is readable. wait() returns the index of a ready source,
+ * which is the value returned when the source was added.
+ *
+ * Waking up is done through an eventfd. In-ports only write to it if the
+ * waiting thread is actually blocked in wait().
+ *
+ * Example:
+ * \code
+ * WaitSet ws;
+ * ws.addInPort( inPorts[0] );
+ * ws.addInPort( inPorts[1] );
+ * while( running ) {
+ *     int i = ws.wait();
+ *     DataPacket *p = inPorts[i]->receive();
+ *     ...
+ * }
+ * \endcode
+ *
+ * \note An in-port can be a member of one WaitSet only. Sources must be
+ * added before the task is started.
+ */
+class WaitSet : public TBObject
+{
+	public:
+		WaitSet();
+		virtual ~WaitSet();
+
+		/// Add an in-port. \return Index of the source.
+		int addInPort( InPort *port );
+
+		/**
+		 * \brief Add a file descriptor.
+		 * \param fd The file descriptor (e.g. of a Socket or a timerfd).
+		 * \param events poll() events to wait for.
+		 * \return Index of the source.
+		 */
+		int addFd( int fd, short events = 0x001 /*POLLIN*/ );
+
+		/**
+		 * \brief Add a timer source.
+		 *
+		 * Pass the returned object to the constructor of a Timer; the
+		 * source is ready once the timer fired. The object is owned by
+		 * the WaitSet.
+		 * \param[out] index Index of the source.
+		 */
+		Timer::CallbackObj *addTimer( int *index = NULL );
+
+		/**
+		 * \brief Wait until a source is ready.
+		 *
+		 * Sources are checked round-robin, so a busy source cannot
+		 * starve the others.
+		 * \param timeout Maximum time in milliseconds to wait (zero waits
+		 * infinitely).
+		 * \return The index of a ready source or -1 on timeout.
+		 * \throws "condition canceled" if cancel() was called.
+		 */
+		int wait( long timeout = 0 );
+
+		/// Wake up wait() if it is blocked (called by the sources).
+		void notify();
+
+		/// Let wait() throw "condition canceled".
+		void cancel();
+
+	private:
+		class TimerSource : public Timer::CallbackObj {
+			public:
+				TimerSource( WaitSet *ws ) : waitSet( ws ), fired( 0 ) {}
+				virtual ~TimerSource() {}
+				virtual void callback( Timer *caller );
+				WaitSet *waitSet;
+				int fired;
+		};
+
+		struct Source {
+			InPort *port;
+			TimerSource *timer;
+			int fd;
+			short events;
+		};
+
+		std::vector<Source> sources;
+		std::vector<int> fdSources;		///< Indexes of the fd sources.
+		int eventFd;
+		int armed;
+		int canceling;
+		unsigned int next;				///< Round-robin start index.
+
+		int findReady( bool pollFds );
+		int pollFds( long timeout );
+		void checkCancel();
+};
+
+
+#endif	//WAITSET_H
@@ -0,0 +1,177 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// WindowView.cpp
+
+#include "WindowView.h"
+#include "PacketPool.h"
+#include <string.h>
+
+
+size_t WindowView::blockBytes( unsigned int channels, unsigned int capacity )
+{
+	return sizeof( Block ) + capacity * (2 * sizeof( unsigned long long ) + channels * sizeof( float ));
+}
+
+
+WindowView::Block *WindowView::allocBlock( unsigned int channels, unsigned int capacity )
+{
+	Block *b = static_cast<Block *>( PacketPool::allocate( blockBytes( channels, capacity ) ) );
+	b->refs = 1;
+	b->channels = channels;
+	b->capacity = capacity;
+	b->first = 0;
+	b->next = NULL;
+	return b;
+}
+
+
+void WindowView::releaseBlock( Block *b )
+{
+	if( b && __sync_sub_and_fetch( &b->refs, 1 ) == 0 ) {
+		PacketPool::release( b, blockBytes( b->channels, b->capacity ) );
+	}
+}
+
+
+WindowView::WindowView() : block(NULL), offset(0), length(0)
+{
+}
+
+
+WindowView::WindowView( Block *block, unsigned int offset, unsigned int length ) :
+	block(length ? block : NULL), offset(offset), length(length)
+{
+	retain();
+}
+
+
+WindowView::WindowView( const WindowView &v ) : block(v.block), offset(v.offset), length(v.length)
+{
+	retain();
+}
+
+
+WindowView& WindowView::operator=( const WindowView &v )
+{
+	if( this != &v ) {
+		v.retain();
+		clear();
+		block = v.block;
+		offset = v.offset;
+		length = v.length;
+	}
+	return *this;
+}
+
+
+WindowView::~WindowView()
+{
+	clear();
+}
+
+
+/// Add a reference to every block of the view.
+void WindowView::retain() const
+{
+	unsigned int end = offset + length;
+	for( Block *b = block; b; b = b->next ) {
+		__sync_add_and_fetch( &b->refs, 1 );
+		if( end <= b->capacity ) {
+			break;
+		}
+		end -= b->capacity;
+	}
+}
+
+
+void WindowView::clear()
+{
+	unsigned int end = offset + length;
+	Block *b = block;
+	while( b ) {
+		//the last block may still be written, its next pointer is not read
+		Block *next = end > b->capacity ? b->next : NULL;
+		end -= end > b->capacity ? b->capacity : end;
+		releaseBlock( b );
+		b = next;
+	}
+	block = NULL;
+	offset = 0;
+	length = 0;
+}
+
+
+/// Find the block \p b and the index \p k in it of frame \p i.
+void WindowView::locate( unsigned int i, Block **b, unsigned int *k ) const
+{
+	Block *p = block;
+	unsigned int j = offset + i;
+	while( j >= p->capacity ) {
+		j -= p->capacity;
+		p = p->next;
+	}
+	*b = p;
+	*k = j;
+}
+
+
+const float *WindowView::frame( unsigned int i ) const
+{
+	Block *b;
+	unsigned int k;
+	locate( i, &b, &k );
+	return b->values() + k * b->channels;
+}
+
+
+unsigned int WindowView::contiguous( unsigned int i ) const
+{
+	Block *b;
+	unsigned int k;
+	locate( i, &b, &k );
+	unsigned int n = b->capacity - k;
+	return n < length - i ? n : length - i;
+}
+
+
+unsigned long long WindowView::getSeqNr( unsigned int i ) const
+{
+	Block *b;
+	unsigned int k;
+	locate( i, &b, &k );
+	return b->seqNrs()[k];
+}
+
+
+unsigned long long WindowView::getTimestampNs( unsigned int i ) const
+{
+	Block *b;
+	unsigned int k;
+	locate( i, &b, &k );
+	return b->timestamps()[k];
+}
+
+
+void WindowView::copyTo( float *out ) const
+{
+	unsigned int channels = getChannels();
+	for( unsigned int i = 0; i < length; ) {
+		unsigned int n = contiguous( i );
+		memcpy( out, frame( i ), n * channels * sizeof( float ) );
+		out += n * channels;
+		i += n;
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// WindowView.h - reference to a slice of a HistoryRing
+
+#ifndef WINDOWVIEW_H
+#define WINDOWVIEW_H
+
+#include <stddef.h>
+
+
+/**
+ * \ingroup core
+ * \brief Read-only view of consecutive frames of a HistoryRing.
+ *
+ * A frame is one sample of a stream: the float values of its channels
+ * plus sequence number and time stamp. The ring stores its frames in
+ * reference counted blocks; a view references the blocks it spans, so
+ * the frames stay valid (and unchanged) while the view exists, even after
+ * the ring moved on or was deleted.
+ *
+ * Copies share the blocks. Overlapping windows (e.g. DataPacket::window of
+ * the packets sent by SlidingWindow) therefore store every sample once,
+ * instead of cloning it into every window that contains it.
+ *
+ * The frames of a block are contiguous, so a view consists of at most a
+ * few contiguous parts, see contiguous().
+ */
+class WindowView
+{
+	public:
+		WindowView();
+		WindowView( const WindowView &v );
+		WindowView& operator=( const WindowView &v );
+		~WindowView();
+
+		/// Number of frames.
+		unsigned int size() const { return length; }
+
+		/// Check if the view has no frames.
+		bool empty() const { return length == 0; }
+
+		/// Number of channels per frame.
+		unsigned int getChannels() const { return block ? block->channels : 0; }
+
+		/// Number of the first frame in the ring (frames are counted from 0).
+		unsigned long long getFirst() const { return block ? block->first + offset : 0; }
+
+		/// Get the channel values of frame \p i.
+		const float *frame( unsigned int i ) const;
+
+		/// Number of frames from frame \p i on that are stored contiguously.
+		unsigned int contiguous( unsigned int i ) const;
+
+		unsigned long long getSeqNr( unsigned int i ) const;		///< Sequence number of frame \p i.
+		unsigned long long getTimestampNs( unsigned int i ) const;	///< Time stamp of frame \p i.
+
+		/// Copy the frames to \p out (size() x getChannels() floats).
+		void copyTo( float *out ) const;
+
+		/// Release the frames.
+		void clear();
+
+	private:
+		friend class HistoryRing;
+
+		/// Storage block, followed by sequence numbers, time stamps and values.
+		struct Block {
+			int refs;
+			unsigned int channels;
+			unsigned int capacity;		///< Frames.
+			unsigned int reserved;
+			unsigned long long first;	///< Number of the first frame.
+			Block *next;				///< Following block, set when it is started.
+
+			unsigned long long *seqNrs() { return reinterpret_cast<unsigned long long *>( this + 1 ); }
+			unsigned long long *timestamps() { return seqNrs() + capacity; }
+			float *values() { return reinterpret_cast<float *>( timestamps() + capacity ); }
+		};
+
+		Block *block;			///< Block of the first frame.
+		unsigned int offset;	///< Index of the first frame in \a block.
+		unsigned int length;
+
+		/// Reference \p length frames from frame \p offset of \p block on.
+		WindowView( Block *block, unsigned int offset, unsigned int length );
+
+		void locate( unsigned int i, Block **b, unsigned int *k ) const;
+		void retain() const;
+
+		static Block *allocBlock( unsigned int channels, unsigned int capacity );
+		static void releaseBlock( Block *b );
+		static size_t blockBytes( unsigned int channels, unsigned int capacity );
+};
+
+
+#endif	//WINDOWVIEW_H
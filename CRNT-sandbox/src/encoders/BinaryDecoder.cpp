@@ -0,0 +1,152 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BinaryDecoder.cpp
+
+#include "BinaryDecoder.h"
+#include "BinaryEncoder.h"
+#include <string.h>
+
+using namespace std;
+
+
+static unsigned int get16( const unsigned char *b )
+{
+	return b[0] | (b[1] << 8);
+}
+
+
+static uint32 get32( const unsigned char *b )
+{
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32)b[3] << 24);
+}
+
+
+static unsigned long long get64( const unsigned char *b )
+{
+	return get32( b ) | ((unsigned long long)get32( b + 4 ) << 32);
+}
+
+
+static bool littleEndian()
+{
+	const uint32 one = 1;
+	return *reinterpret_cast<const unsigned char *>( &one ) == 1;
+}
+
+
+BinaryDecoder::BinaryDecoder() : headerSeen(false)
+{
+}
+
+
+BinaryDecoder::~BinaryDecoder()
+{
+}
+
+
+void BinaryDecoder::reset()
+{
+	headerSeen = false;
+}
+
+
+int BinaryDecoder::decode( const unsigned char *buf, unsigned int len, DataPacket **p )
+{
+	*p = NULL;
+	unsigned int used = 0;
+
+	if( !headerSeen ) {
+		if( len < BinaryEncoder::HEADER_SIZE ) {
+			return 0;
+		}
+		if( memcmp( buf, "CRNB", 4 ) || get16( buf + 4 ) != BinaryEncoder::VERSION ) {
+			log( "ERROR: not a BinaryEncoder stream (or wrong version)" );
+			return -1;
+		}
+		headerSeen = true;
+		used = BinaryEncoder::HEADER_SIZE;
+		buf += used;
+		len -= used;
+	}
+
+	if( len < BinaryEncoder::PACKET_HEADER_SIZE ) {
+		return used;
+	}
+	unsigned int n = get16( buf + 6 );
+	unsigned int size = BinaryEncoder::packetSize( n );
+	if( get32( buf ) != size - 4 ) {
+		log( "ERROR: corrupt packet length: " ) << get32( buf ) << endl;
+		return -1;
+	}
+	if( len < size ) {
+		return used;
+	}
+
+	DataPacket *packet = new DataPacket( (int)get32( buf + 8 ) );
+	packet->endOfStream = get16( buf + 4 ) & 1;
+	packet->seqNr = get64( buf + 12 );
+	long long wall = (long long)get64( buf + 20 );
+	struct timeval tv;
+	tv.tv_sec = wall / 1000000000LL;
+	tv.tv_usec = (wall % 1000000000LL) / 1000;
+	packet->setTimestamp( tv, false );	//the encoder sends wall clock time
+
+	const unsigned char *slots = buf + BinaryEncoder::PACKET_HEADER_SIZE;
+	const unsigned char *typeBits = slots + 4 * n;
+	const unsigned char *validBits = typeBits + 4 * ((n + 31) / 32);
+	if( littleEndian() ) {
+		//one copy from the receive buffer into the pooled storage
+		packet->channels.setRaw( n, slots, typeBits, validBits );
+	}
+	else {
+		packet->channels.reserve( n );
+		for( unsigned int i = 0; i < n; i++ ) {
+			uint32 raw = get32( slots + 4 * i );
+			bool valid = (validBits[i >> 3] >> (i & 7)) & 1;
+			if( (typeBits[i >> 3] >> (i & 7)) & 1 ) {
+				packet->channels.appendInt( (int32)raw, valid );
+			}
+			else {
+				float f;
+				memcpy( &f, &raw, 4 );
+				packet->channels.appendFloat( f, valid );
+			}
+		}
+	}
+
+	*p = packet;
+	return used + size;
+}
+
+
+int BinaryDecoder::decodeAll( const unsigned char *buf, unsigned int len, vector<DataPacket*> &out )
+{
+	unsigned int used = 0;
+	for( ;; ) {
+		DataPacket *p;
+		int r = decode( buf + used, len - used, &p );
+		if( r < 0 ) {
+			return -1;
+		}
+		used += r;
+		if( p ) {
+			out.push_back( p );
+		}
+		else if( r == 0 ) {
+			return used;
+		}
+	}
+}
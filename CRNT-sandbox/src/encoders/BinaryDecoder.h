@@ -0,0 +1,72 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BinaryDecoder.h - reads the format of BinaryEncoder
+
+#ifndef BINARYDECODER_H
+#define BINARYDECODER_H
+
+#include "../core/DataPacket.h"
+#include "../core/TBObject.h"
+#include <vector>
+
+
+/**
+ * \ingroup encoders
+ * \brief Decoder for the BinaryEncoder format.
+ *
+ * Builds typed data packets (DataPacket::isTyped()) directly from a
+ * receive buffer: the channel values and flags are copied once into the
+ * pooled channel storage of the new packet, nothing else is allocated.
+ *
+ * The stream header is consumed by the first call to decode(). Wall clock
+ * time stamps are mapped to DataPacket::timestampNs with Clock, so
+ * latencies can be measured between processes on the same host.
+ */
+class BinaryDecoder : public TBObject
+{
+	public:
+		BinaryDecoder();
+		virtual ~BinaryDecoder();
+
+		/**
+		 * \brief Decode one packet.
+		 *
+		 * \param buf Received bytes.
+		 * \param len Number of bytes in \p buf.
+		 * \param p Set to the new packet, or NULL if no packet was complete.
+		 * \returns Number of bytes consumed (0 if more data is needed),
+		 * or -1 if the data is not in the BinaryEncoder format.
+		 */
+		int decode( const unsigned char *buf, unsigned int len, DataPacket **p );
+
+		/**
+		 * \brief Decode all complete packets in \p buf.
+		 *
+		 * The packets are appended to \p out. Bytes of an incomplete
+		 * packet at the end must be passed again with the next data.
+		 * \returns Number of bytes consumed, or -1 on a format error.
+		 */
+		int decodeAll( const unsigned char *buf, unsigned int len, std::vector<DataPacket*> &out );
+
+		/// Expect a new stream (with header).
+		void reset();
+
+	private:
+		bool headerSeen;
+};
+
+
+#endif	//BINARYDECODER_H
@@ -0,0 +1,174 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BinaryEncoder.cpp
+
+#include "BinaryEncoder.h"
+#include "../core/IntValue.h"
+#include <string.h>
+
+using namespace std;
+
+
+static void put16( unsigned char *b, unsigned int v )
+{
+	b[0] = v;
+	b[1] = v >> 8;
+}
+
+
+static void put32( unsigned char *b, uint32 v )
+{
+	b[0] = v;
+	b[1] = v >> 8;
+	b[2] = v >> 16;
+	b[3] = v >> 24;
+}
+
+
+static void put64( unsigned char *b, unsigned long long v )
+{
+	put32( b, (uint32)v );
+	put32( b + 4, (uint32)(v >> 32) );
+}
+
+
+static bool littleEndian()
+{
+	const uint32 one = 1;
+	return *reinterpret_cast<const unsigned char *>( &one ) == 1;
+}
+
+
+BinaryEncoder::BinaryEncoder()
+{
+}
+
+
+BinaryEncoder::~BinaryEncoder()
+{
+}
+
+
+Encoder* BinaryEncoder::clone() const
+{
+	return new BinaryEncoder( *this );
+}
+
+
+void BinaryEncoder::init( const DataPacket *p )
+{
+	//the format does not depend on the packets
+}
+
+
+int BinaryEncoder::get_header( unsigned char *buf, unsigned int size )
+{
+	if( size < HEADER_SIZE ) {
+		return 0;
+	}
+	memcpy( buf, "CRNB", 4 );
+	put16( buf + 4, VERSION );
+	put16( buf + 6, 0 );
+	return HEADER_SIZE;
+}
+
+
+int BinaryEncoder::get_footer( unsigned char *buf, unsigned int size )
+{
+	return 0;
+}
+
+
+unsigned int BinaryEncoder::encodedSize( const DataPacket *p )
+{
+	return packetSize( p->size() );
+}
+
+
+int BinaryEncoder::encode( const DataPacket *p, unsigned char *buf, unsigned int size )
+{
+	unsigned int n = p->size();
+	if( n > MAX_CHANNELS ) {
+		log( "ERROR: too many channels: " ) << n << endl;
+		return 0;
+	}
+	unsigned int len = packetSize( n );
+	if( size < len ) {
+		return 0;
+	}
+	p->checkSerializable();
+
+	long long wall = p->timestamp.tv_sec * 1000000000LL + p->timestamp.tv_usec * 1000LL;
+	put32( buf, len - 4 );
+	put16( buf + 4, p->endOfStream ? 1 : 0 );
+	put16( buf + 6, n );
+	put32( buf + 8, p->getStreamId() );
+	put64( buf + 12, p->seqNr );
+	put64( buf + 20, wall );
+
+	unsigned int words = (n + 31) / 32;
+	unsigned char *slots = buf + PACKET_HEADER_SIZE;
+	unsigned char *typeBits = slots + 4 * n;
+	unsigned char *validBits = typeBits + 4 * words;
+
+	if( p->isTyped() && littleEndian() ) {
+		//the storage has the wire layout already
+		uint32 bits[2 * ((MAX_CHANNELS + 31) / 32)];
+		p->channels.getRaw( slots, bits, bits + words );
+		memcpy( typeBits, bits, 8 * words );
+		return len;
+	}
+
+	memset( typeBits, 0, 8 * words );
+	for( unsigned int i = 0; i < n; i++ ) {
+		bool isInt, valid;
+		uint32 raw;
+		if( p->isTyped() ) {
+			isInt = p->channels.getType( i ) == ChannelBuffer::INT;
+			valid = p->channels.isValid( i );
+			if( isInt ) {
+				raw = p->channels.getInt( i );
+			}
+			else {
+				float f = p->channels.getFloat( i );
+				memcpy( &raw, &f, 4 );
+			}
+		}
+		else {
+			const Value *v = p->dataVector[i];
+			isInt = dynamic_cast<const IntValue *>( v ) != NULL;
+			valid = v && v->isValid();
+			if( !v ) {
+				raw = 0;
+			}
+			else if( isInt ) {
+				raw = v->getInt();
+			}
+			else {
+				float f = v->getFloat();
+				memcpy( &raw, &f, 4 );
+			}
+		}
+		put32( slots + 4 * i, raw );
+		if( isInt ) {
+			typeBits[i >> 3] |= 1 << (i & 7);
+		}
+		if( valid ) {
+			validBits[i >> 3] |= 1 << (i & 7);
+		}
+	}
+	return len;
+}
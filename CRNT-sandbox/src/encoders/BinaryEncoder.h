@@ -0,0 +1,84 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BinaryEncoder.h - compact binary wire format
+
+#ifndef BINARYENCODER_H
+#define BINARYENCODER_H
+
+#include "../core/Encoder.h"
+
+
+/**
+ * \ingroup encoders
+ * \brief Compact binary encoder.
+ *
+ * Writes data packets in a fixed binary layout that BinaryDecoder reads
+ * back. All fields are little endian:
+ *
+ * \verbatim
+   header:  "CRNB"  u16 version  u16 reserved
+
+   packet:  u32 length      bytes following this field
+            u16 flags       bit 0: end of stream
+            u16 channels    n
+            i32 streamId
+            u64 seqNr
+            i64 timestamp   wall clock, nanoseconds since the epoch
+            n x 32 bit      channel values (float or int32)
+            w x u32         type bits, bit i set if channel i is an int   (w = (n + 31) / 32)
+            w x u32         valid bits, bit i set if channel i is valid
+   \endverbatim
+ *
+ * Channels of typed packets (DataPacket::isTyped()) are copied as one
+ * block. IntValue channels are sent as int32, all other Values as float.
+ * The packets of a super packet (DataPacket::packetVector) are not sent.
+ */
+class BinaryEncoder : public Encoder
+{
+	public:
+		static const unsigned short VERSION = 1;		///< Wire format version.
+		static const unsigned int HEADER_SIZE = 8;		///< Bytes of the stream header.
+		static const unsigned int PACKET_HEADER_SIZE = 28;	///< Bytes of a packet without channels.
+		static const unsigned int MAX_CHANNELS = 65535;	///< Channels per packet.
+
+		BinaryEncoder();
+		virtual ~BinaryEncoder();
+
+		virtual Encoder* clone() const;
+		virtual void init( const DataPacket *p );
+		virtual int get_header( unsigned char *buf, unsigned int size );
+
+		/**
+		 * \brief Encode a data packet.
+		 * \returns Length of the encoded packet, or 0 if \p size is too
+		 * small (see encodedSize()).
+		 */
+		virtual int encode( const DataPacket *p, unsigned char *buf, unsigned int size );
+		virtual int get_footer( unsigned char *buf, unsigned int size );
+		virtual unsigned int getEncodedSizeBound( const DataPacket *p ) const { return encodedSize( p ); }
+
+		/// Number of bytes encode() needs for \p p.
+		static unsigned int encodedSize( const DataPacket *p );
+
+		/// Number of bytes of a packet with \p channels channels.
+		static unsigned int packetSize( unsigned int channels )
+		{
+			return PACKET_HEADER_SIZE + 4 * channels + 8 * ((channels + 31) / 32);
+		}
+};
+
+
+#endif	//BINARYENCODER_H
@@ -0,0 +1,219 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// DeltaDecoder.cpp
+
+#include "DeltaDecoder.h"
+#include "Varint.h"
+#include <string.h>
+
+using namespace std;
+
+
+DeltaDecoder::DeltaDecoder() : headerSeen(false), skipped(0)
+{
+}
+
+
+DeltaDecoder::~DeltaDecoder()
+{
+}
+
+
+void DeltaDecoder::reset()
+{
+	headerSeen = false;
+	streams.clear();
+}
+
+
+int DeltaDecoder::decode( const unsigned char *buf, unsigned int len, DataPacket **p )
+{
+	*p = NULL;
+	unsigned int used = 0;
+
+	if( !headerSeen ) {
+		if( len < DeltaEncoder::HEADER_SIZE ) {
+			return 0;
+		}
+		if( memcmp( buf, "CRND", 4 ) || (buf[4] | (buf[5] << 8)) != DeltaEncoder::VERSION ) {
+			log( "ERROR: not a DeltaEncoder stream (or wrong version)" );
+			return -1;
+		}
+		headerSeen = true;
+		used = DeltaEncoder::HEADER_SIZE;
+		buf += used;
+		len -= used;
+	}
+
+	unsigned long long bodyLen;
+	unsigned int k = getVarint( buf, len, &bodyLen );
+	if( k == 0 || len - k < bodyLen ) {
+		if( k == 0 && len >= 10 ) {
+			log( "ERROR: corrupt packet length" );
+			return -1;
+		}
+		return used;
+	}
+	if( decodeBody( buf + k, bodyLen, p ) < 0 ) {
+		return -1;
+	}
+	return used + k + bodyLen;
+}
+
+
+/// Read the bits of \p n channels (bytes, LSB first) into words.
+static const unsigned char *getBits( const unsigned char *b, vector<uint32> &words, unsigned int n )
+{
+	words.assign( (n + 31) / 32, 0 );
+	for( unsigned int j = 0; j < (n + 7) / 8; j++ ) {
+		words[j / 4] |= (uint32)b[j] << (8 * (j % 4));
+	}
+	return b + (n + 7) / 8;
+}
+
+
+/// Read a varint and advance \p b, returns false if it does not end before \p end.
+static bool readVarint( const unsigned char *&b, const unsigned char *end, unsigned long long *v )
+{
+	unsigned int k = getVarint( b, end - b, v );
+	b += k;
+	return k > 0;
+}
+
+
+/**
+ * Decodes the packet \p b of \p len bytes (without the length field).
+ * @return -1 on a format error.
+ */
+int DeltaDecoder::decodeBody( const unsigned char *b, unsigned int len, DataPacket **p )
+{
+	const unsigned char *end = b + len;
+	unsigned long long v, seqDelta, timeDelta;
+
+	if( len == 0 ) {
+		log( "ERROR: empty packet" );
+		return -1;
+	}
+	unsigned int flags = *b++;
+	bool key = flags & 1;
+	if( !readVarint( b, end, &v ) || !readVarint( b, end, &seqDelta ) || !readVarint( b, end, &timeDelta ) ) {
+		log( "ERROR: corrupt packet header" );
+		return -1;
+	}
+	int streamId = (int)unzigzag( v );
+
+	map<int, DeltaEncoder::StreamState>::iterator it = streams.find( streamId );
+	if( !key && it == streams.end() ) {
+		//joined mid-stream, wait for a keyframe
+		skipped++;
+		return 0;
+	}
+	if( it == streams.end() ) {
+		it = streams.insert( make_pair( streamId, DeltaEncoder::StreamState() ) ).first;
+	}
+	DeltaEncoder::StreamState &s = it->second;
+
+	if( key ) {
+		unsigned long long n;
+		if( !readVarint( b, end, &n ) || n > 65535 || (unsigned long long)(end - b) < 2 * ((n + 7) / 8) ) {
+			log( "ERROR: corrupt keyframe" );
+			streams.erase( it );
+			return -1;
+		}
+		b = getBits( b, s.typeBits, n );
+		b = getBits( b, s.validBits, n );
+		s.slots.assign( n, 0 );
+		s.seqNr = 0;
+		s.timeUs = 0;
+	}
+	unsigned int n = s.slots.size();
+	s.seqNr += unzigzag( seqDelta );
+	s.timeUs += unzigzag( timeDelta );
+
+	unsigned int floats = 0;
+	for( unsigned int i = 0; i < n; i++ ) {
+		if( !((s.typeBits[i >> 5] >> (i & 31)) & 1) ) {
+			floats++;
+		}
+	}
+	const unsigned char *codes = b;
+	bool ok = (unsigned int)(end - b) >= (floats + 1) / 2;
+	b += ok ? (floats + 1) / 2 : 0;
+
+	unsigned int f = 0;
+	for( unsigned int i = 0; i < n && ok; i++ ) {
+		if( (s.typeBits[i >> 5] >> (i & 31)) & 1 ) {
+			if( !readVarint( b, end, &v ) ) {
+				ok = false;
+				break;
+			}
+			s.slots[i] += (uint32)(int32)unzigzag( v );
+			continue;
+		}
+		unsigned int code = (codes[f / 2] >> (4 * (f & 1))) & 15;
+		unsigned int bytes = code & 7;
+		unsigned int first = (code & 8) ? 4 - bytes : 0;
+		if( bytes > 4 || end - b < (int)bytes ) {
+			ok = false;
+			break;
+		}
+		uint32 x = 0;
+		for( unsigned int j = 0; j < bytes; j++ ) {
+			x |= (uint32)*b++ << (8 * (first + j));
+		}
+		s.slots[i] ^= x;
+		f++;
+	}
+	if( !ok ) {
+		//the state of this stream is lost, wait for the next keyframe
+		log( "ERROR: corrupt channel data" );
+		streams.erase( it );
+		return -1;
+	}
+
+	DataPacket *packet = new DataPacket( streamId );
+	packet->endOfStream = flags & 2;
+	packet->seqNr = s.seqNr;
+	struct timeval tv;
+	tv.tv_sec = s.timeUs / 1000000;
+	tv.tv_usec = s.timeUs % 1000000;
+	packet->setTimestamp( tv, false );	//the encoder sends wall clock time
+	if( n ) {
+		packet->channels.setRaw( n, &s.slots[0], &s.typeBits[0], &s.validBits[0] );
+	}
+	*p = packet;
+	return 0;
+}
+
+
+int DeltaDecoder::decodeAll( const unsigned char *buf, unsigned int len, vector<DataPacket*> &out )
+{
+	unsigned int used = 0;
+	for( ;; ) {
+		DataPacket *p;
+		int r = decode( buf + used, len - used, &p );
+		if( r < 0 ) {
+			return -1;
+		}
+		used += r;
+		if( p ) {
+			out.push_back( p );
+		}
+		else if( r == 0 ) {
+			return used;
+		}
+	}
+}
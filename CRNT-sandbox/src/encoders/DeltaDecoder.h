@@ -0,0 +1,70 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// DeltaDecoder.h - reads the format of DeltaEncoder
+
+#ifndef DELTADECODER_H
+#define DELTADECODER_H
+
+#include "DeltaEncoder.h"
+#include "../core/TBObject.h"
+#include <map>
+#include <vector>
+
+
+/**
+ * \ingroup encoders
+ * \brief Decoder for the DeltaEncoder format.
+ *
+ * Produces typed data packets (DataPacket::isTyped()). Packets of a
+ * stream are skipped until its first keyframe arrived.
+ *
+ * The interface is the same as the one of BinaryDecoder.
+ */
+class DeltaDecoder : public TBObject
+{
+	public:
+		DeltaDecoder();
+		virtual ~DeltaDecoder();
+
+		/**
+		 * \brief Decode one packet.
+		 *
+		 * \param p Set to the new packet, or NULL if no packet was complete
+		 * or the packet was skipped (waiting for a keyframe).
+		 * \returns Number of bytes consumed (0 if more data is needed),
+		 * or -1 if the data is not in the DeltaEncoder format.
+		 */
+		int decode( const unsigned char *buf, unsigned int len, DataPacket **p );
+
+		/// Decode all complete packets in \p buf, see BinaryDecoder::decodeAll().
+		int decodeAll( const unsigned char *buf, unsigned int len, std::vector<DataPacket*> &out );
+
+		/// Expect a new stream (with header).
+		void reset();
+
+		/// Number of packets skipped while waiting for a keyframe.
+		unsigned long long getSkipped() const { return skipped; }
+
+	private:
+		bool headerSeen;
+		unsigned long long skipped;
+		std::map<int, DeltaEncoder::StreamState> streams;
+
+		int decodeBody( const unsigned char *b, unsigned int len, DataPacket **p );
+};
+
+
+#endif	//DELTADECODER_H
@@ -0,0 +1,199 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// DeltaEncoder.cpp
+
+#include "DeltaEncoder.h"
+#include "Varint.h"
+#include <string.h>
+
+using namespace std;
+
+
+/// Space reserved in front of the body for the length varint.
+static const unsigned int LENGTH_SPACE = 5;
+
+
+DeltaEncoder::DeltaEncoder( unsigned int keyframeInterval ) : keyframeInterval(keyframeInterval)
+{
+}
+
+
+DeltaEncoder::~DeltaEncoder()
+{
+}
+
+
+Encoder* DeltaEncoder::clone() const
+{
+	return new DeltaEncoder( *this );
+}
+
+
+void DeltaEncoder::init( const DataPacket *p )
+{
+	streams.clear();
+}
+
+
+void DeltaEncoder::requestKeyframe()
+{
+	streams.clear();
+}
+
+
+int DeltaEncoder::get_header( unsigned char *buf, unsigned int size )
+{
+	if( size < HEADER_SIZE ) {
+		return 0;
+	}
+	streams.clear();
+	memcpy( buf, "CRND", 4 );
+	buf[4] = VERSION;
+	buf[5] = VERSION >> 8;
+	buf[6] = keyframeInterval;
+	buf[7] = keyframeInterval >> 8;
+	return HEADER_SIZE;
+}
+
+
+int DeltaEncoder::get_footer( unsigned char *buf, unsigned int size )
+{
+	return 0;
+}
+
+
+/// Write the bits of \p n channels as bytes, LSB first.
+static unsigned char *putBits( unsigned char *o, const vector<uint32> &words, unsigned int n )
+{
+	for( unsigned int j = 0; j < (n + 7) / 8; j++ ) {
+		*o++ = words[j / 4] >> (8 * (j % 4));
+	}
+	return o;
+}
+
+
+int DeltaEncoder::encode( const DataPacket *p, unsigned char *buf, unsigned int size )
+{
+	unsigned int n = p->size();
+	if( size < maxEncodedSize( n ) ) {
+		return 0;
+	}
+	p->checkSerializable();
+
+	//raw channel values of this packet
+	ChannelBuffer values;
+	const ChannelBuffer &cb = p->getTypedChannels( values );
+	unsigned int words = (n + 31) / 32;
+	//scratch vectors are swapped with the stream state, so they keep their capacity
+	vector<uint32> &slots = curSlots, &typeBits = curTypeBits, &validBits = curValidBits;
+	slots.resize( n );
+	typeBits.resize( words );
+	validBits.resize( words );
+	if( n ) {
+		cb.getRaw( &slots[0], &typeBits[0], &validBits[0] );
+	}
+
+	int streamId = p->getStreamId();
+	long long timeUs = p->timestamp.tv_sec * 1000000LL + p->timestamp.tv_usec;
+	map<int, StreamState>::iterator it = streams.find( streamId );
+	bool key = it == streams.end();
+	if( key ) {
+		it = streams.insert( make_pair( streamId, StreamState() ) ).first;
+	}
+	StreamState &s = it->second;
+	key = key
+		|| (keyframeInterval && s.count >= keyframeInterval)
+		|| s.slots.size() != n
+		|| s.typeBits != typeBits
+		|| s.validBits != validBits;
+	if( key ) {
+		s.count = 0;
+		s.seqNr = 0;
+		s.timeUs = 0;
+		s.slots.assign( n, 0 );
+	}
+
+	unsigned char *body = buf + LENGTH_SPACE;
+	unsigned char *o = body;
+	*o++ = (key ? 1 : 0) | (p->endOfStream ? 2 : 0);
+	o += putVarint( o, zigzag( streamId ) );
+	o += putVarint( o, zigzag( (long long)(p->seqNr - s.seqNr) ) );
+	o += putVarint( o, zigzag( timeUs - s.timeUs ) );
+	if( key ) {
+		o += putVarint( o, n );
+		o = putBits( o, typeBits, n );
+		o = putBits( o, validBits, n );
+	}
+
+	//4 bit codes of the float channels first, then the data
+	unsigned int floats = 0;
+	for( unsigned int i = 0; i < n; i++ ) {
+		if( !((typeBits[i >> 5] >> (i & 31)) & 1) ) {
+			floats++;
+		}
+	}
+	unsigned char *codes = o;
+	memset( codes, 0, (floats + 1) / 2 );
+	o += (floats + 1) / 2;
+
+	unsigned int f = 0;
+	for( unsigned int i = 0; i < n; i++ ) {
+		uint32 cur = slots[i];
+		uint32 prev = s.slots[i];
+		if( (typeBits[i >> 5] >> (i & 31)) & 1 ) {
+			o += putVarint( o, zigzag( (int32)(cur - prev) ) );
+			continue;
+		}
+		uint32 x = cur ^ prev;
+		unsigned int low = 4, high = 4;	//significant bytes counted from the low/high end
+		while( low > 0 && !(x >> (8 * (low - 1))) ) {
+			low--;
+		}
+		while( high > 0 && !(x << (8 * (high - 1))) ) {
+			high--;
+		}
+		unsigned int code;
+		if( high < low ) {
+			code = 8 | high;
+			for( unsigned int k = 4 - high; k < 4; k++ ) {
+				*o++ = x >> (8 * k);
+			}
+		}
+		else {
+			code = low;
+			for( unsigned int k = 0; k < low; k++ ) {
+				*o++ = x >> (8 * k);
+			}
+		}
+		codes[f / 2] |= code << (4 * (f & 1));
+		f++;
+	}
+
+	s.count++;
+	s.seqNr = p->seqNr;
+	s.timeUs = timeUs;
+	s.slots.swap( slots );
+	s.typeBits.swap( typeBits );
+	s.validBits.swap( validBits );
+
+	//prepend the length
+	unsigned int bodyLen = o - body;
+	unsigned char len[LENGTH_SPACE];
+	unsigned int k = putVarint( len, bodyLen );
+	memmove( buf + k, body, bodyLen );
+	memcpy( buf, len, k );
+	return k + bodyLen;
+}
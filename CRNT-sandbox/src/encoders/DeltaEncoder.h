@@ -0,0 +1,110 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// DeltaEncoder.h - delta compressing wire format for slowly varying streams
+
+#ifndef DELTAENCODER_H
+#define DELTAENCODER_H
+
+#include "../core/Encoder.h"
+#include <map>
+#include <vector>
+
+
+/**
+ * \ingroup encoders
+ * \brief Delta compressing encoder.
+ *
+ * Every channel is encoded against its value in the previous packet of
+ * the same stream:
+ * - int channels as zigzag varint of the difference,
+ * - float channels as the XOR of the bit patterns, of which only the
+ *   bytes that are not zero at the high (or the low) end are sent.
+ *   A 4 bit code per float channel tells how many bytes follow.
+ *
+ * Sequence number and time stamp are sent as varint differences as well.
+ * Small changes between samples thus cost one or two bytes per channel.
+ *
+ * A keyframe (encoded against zero, with the channel layout) is sent for
+ * the first packet of a stream, every \a keyframeInterval packets, and
+ * whenever the number, types or valid flags of the channels change.
+ * DeltaDecoder skips packets of a stream until it has seen a keyframe, so
+ * receivers can join mid-stream.
+ *
+ * \verbatim
+   header:  "CRND"  u16 version  u16 keyframe interval
+
+   packet:  varint length   bytes following this field
+            u8 flags        bit 0: keyframe, bit 1: end of stream
+            varint          zigzag streamId
+            varint          seqNr (keyframe) or zigzag difference
+            varint          wall clock time in us (keyframe) or zigzag difference
+            keyframe only:  varint n, n type bits, n valid bits (bytes, LSB first)
+            4 bit codes of the float channels, two per byte
+            channel data in channel order
+   \endverbatim
+ */
+class DeltaEncoder : public Encoder
+{
+	public:
+		static const unsigned short VERSION = 1;		///< Wire format version.
+		static const unsigned int HEADER_SIZE = 8;		///< Bytes of the stream header.
+		static const unsigned int DEFAULT_KEYFRAME_INTERVAL = 100;
+
+		/// \param keyframeInterval Packets per stream between keyframes (0 = first packet only).
+		DeltaEncoder( unsigned int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL );
+		virtual ~DeltaEncoder();
+
+		virtual Encoder* clone() const;
+
+		/// Forget all streams, the next packet of each stream is a keyframe.
+		virtual void init( const DataPacket *p );
+
+		/// The header starts a new stream of bytes, see init().
+		virtual int get_header( unsigned char *buf, unsigned int size );
+
+		/**
+		 * \brief Encode a data packet.
+		 * \returns Length of the encoded packet, or 0 if \p size is too
+		 * small (see maxEncodedSize()).
+		 */
+		virtual int encode( const DataPacket *p, unsigned char *buf, unsigned int size );
+		virtual int get_footer( unsigned char *buf, unsigned int size );
+		virtual unsigned int getEncodedSizeBound( const DataPacket *p ) const { return maxEncodedSize( p->size() ); }
+
+		/// Force a keyframe for the next packet of every stream.
+		void requestKeyframe();
+
+		/// Upper bound of the encoded size of a packet with \p channels channels.
+		static unsigned int maxEncodedSize( unsigned int channels ) { return 45 + 6 * channels; }
+
+		/// State of one stream, shared with DeltaDecoder.
+		struct StreamState {
+			unsigned int count;					///< Packets since the last keyframe.
+			unsigned long long seqNr;
+			long long timeUs;
+			std::vector<uint32> slots;			///< Raw channel values.
+			std::vector<uint32> typeBits;
+			std::vector<uint32> validBits;
+		};
+
+	private:
+		unsigned int keyframeInterval;
+		std::map<int, StreamState> streams;
+		std::vector<uint32> curSlots, curTypeBits, curValidBits;
+};
+
+
+#endif	//DELTAENCODER_H
@@ -0,0 +1,67 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Varint.h - LEB128 varints and zigzag mapping used by the encoders
+
+#ifndef VARINT_H
+#define VARINT_H
+
+
+/// Map a signed value to an unsigned one with small magnitudes first.
+inline unsigned long long zigzag( long long v )
+{
+	return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+
+/// Inverse of zigzag().
+inline long long unzigzag( unsigned long long u )
+{
+	return (long long)(u >> 1) ^ -(long long)(u & 1);
+}
+
+
+/// Write \p v as varint (7 bits per byte, at most 10 bytes), returns the bytes written.
+inline unsigned int putVarint( unsigned char *b, unsigned long long v )
+{
+	unsigned int n = 0;
+	while( v >= 0x80 ) {
+		b[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	b[n++] = (unsigned char)v;
+	return n;
+}
+
+
+/**
+ * Read a varint from \p b (at most \p len bytes).
+ * @return Bytes read, or 0 if the varint is incomplete or too long.
+ */
+inline unsigned int getVarint( const unsigned char *b, unsigned int len, unsigned long long *v )
+{
+	unsigned long long r = 0;
+	for( unsigned int i = 0; i < len && i < 10; i++ ) {
+		r |= (unsigned long long)(b[i] & 0x7f) << (7 * i);
+		if( !(b[i] & 0x80) ) {
+			*v = r;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+
+#endif	//VARINT_H
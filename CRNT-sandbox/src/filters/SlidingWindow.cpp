@@ -0,0 +1,105 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SlidingWindow.cpp
+
+#include "SlidingWindow.h"
+
+using namespace std;
+
+
+SlidingWindow::SlidingWindow( unsigned int windowSize, unsigned int hopSize ) :
+	StreamTask( 1, 1 ),
+	windowSize(windowSize > 0 ? windowSize : 1),
+	hopSize(hopSize > 0 ? hopSize : 1)
+{
+	setId( "slidingwindow" );
+}
+
+
+SlidingWindow::~SlidingWindow()
+{
+	for( map<int, Stream>::iterator it = streams.begin(); it != streams.end(); it++ ) {
+		delete it->second.ring;
+	}
+}
+
+
+void SlidingWindow::run()
+{
+	vector<DataPacket *> batch, out;
+	try {
+		while( running ) {
+			batch.clear();
+			inPorts[0]->receiveBatch( batch, 64 );
+			for( unsigned int i = 0; i < batch.size(); i++ ) {
+				handle( batch[i], out );
+			}
+			outPorts[0]->sendBatch( out );
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+}
+
+
+void SlidingWindow::process()
+{
+	vector<DataPacket *> batch, out;
+	while( inPorts[0]->notEmpty() ) {
+		batch.clear();
+		inPorts[0]->receiveBatch( batch, 64, 1 );
+		for( unsigned int i = 0; i < batch.size(); i++ ) {
+			handle( batch[i], out );
+		}
+		outPorts[0]->sendBatch( out );
+	}
+}
+
+
+/// Append the sample \p p (deleted) to the history of its stream.
+void SlidingWindow::handle( DataPacket *p, vector<DataPacket *> &out )
+{
+	unsigned int n = p->size();
+	map<int, Stream>::iterator it = streams.find( p->getStreamId() );
+	if( it == streams.end() ) {
+		Stream s = { NULL, 0 };
+		it = streams.insert( make_pair( p->getStreamId(), s ) ).first;
+	}
+	Stream &s = it->second;
+	if( s.ring && s.ring->getChannels() != n ) {
+		log( "number of channels changed, restarting window of stream " ) << p->getStreamId() << endl;
+		//windows in flight keep their samples
+		delete s.ring;
+		s.ring = NULL;
+	}
+	if( !s.ring ) {
+		s.ring = new HistoryRing( n, windowSize );
+	}
+
+	HistoryRing &ring = *s.ring;
+	ring.append( p );
+	unsigned long long count = ring.getCount();
+	if( count >= windowSize && (count - windowSize) % hopSize == 0 ) {
+		DataPacket *w = new DataPacket( p->getStreamId() );
+		w->seqNr = s.seqNr++;
+		w->timestamp = p->timestamp;
+		w->timestampNs = p->timestampNs;
+		w->window = ring.last( windowSize );
+		out.push_back( w );
+	}
+	delete p;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SlidingWindow.h - overlapping windows of samples
+
+#ifndef SLIDINGWINDOW_H
+#define SLIDINGWINDOW_H
+
+#include "../core/StreamTask.h"
+#include "../core/HistoryRing.h"
+#include <map>
+
+
+/**
+ * \ingroup filters
+ * \brief Groups the samples of each stream into (overlapping) windows.
+ *
+ * Every input packet is one sample. Once \a windowSize samples of a stream
+ * arrived, a window packet is sent every \a hopSize samples. It has no
+ * channels; DataPacket::window holds the last \a windowSize samples,
+ * referenced in a HistoryRing of the stream. Windows that overlap share
+ * the samples, so a window costs the same no matter how large the
+ * overlap is.
+ *
+ * Window packets carry the stream id and time stamp of their last sample
+ * and are numbered from 0 per stream. If the number of channels of a
+ * stream changes, its history starts again.
+ *
+ * The windows are meant for tasks in the same process: encoders and
+ * writers serialize the (empty) channels only.
+ */
+class SlidingWindow : public StreamTask
+{
+	public:
+		/**
+		 * \param windowSize Samples per window.
+		 * \param hopSize Samples between the start of two windows.
+		 */
+		SlidingWindow( unsigned int windowSize, unsigned int hopSize );
+		virtual ~SlidingWindow();
+
+	protected:
+		virtual void run();
+		virtual void process();
+
+	private:
+		struct Stream {
+			HistoryRing *ring;
+			unsigned long long seqNr;
+		};
+
+		unsigned int windowSize;
+		unsigned int hopSize;
+		std::map<int, Stream> streams;
+
+		void handle( DataPacket *p, std::vector<DataPacket *> &out );
+};
+
+
+#endif	//SLIDINGWINDOW_H
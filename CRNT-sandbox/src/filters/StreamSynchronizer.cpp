@@ -0,0 +1,263 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// StreamSynchronizer.cpp
+
+#include "StreamSynchronizer.h"
+#include "../core/Clock.h"
+
+using namespace std;
+
+
+StreamSynchronizer::StreamSynchronizer( unsigned int inputs, Policy policy, unsigned int latenessMs ) :
+	StreamTask( inputs, 1 ),
+	policy(policy),
+	latenessNs(latenessMs * 1000000ULL),
+	maxPending(256),
+	samples(inputs),
+	merged(0),
+	late(0),
+	dropped(0),
+	lastNs(0)
+{
+	setId( "streamsynchronizer" );
+	for( unsigned int i = 0; i < inPorts.size(); i++ ) {
+		waitSet.addInPort( inPorts[i] );
+	}
+}
+
+
+StreamSynchronizer::~StreamSynchronizer()
+{
+	for( unsigned int i = 0; i < ticks.size(); i++ ) {
+		delete ticks[i].packet;
+	}
+	for( unsigned int i = 0; i < samples.size(); i++ ) {
+		for( unsigned int k = 0; k < samples[i].size(); k++ ) {
+			delete samples[i][k];
+		}
+	}
+}
+
+
+void StreamSynchronizer::cancelAllBlockingCalls()
+{
+	waitSet.cancel();
+}
+
+
+void StreamSynchronizer::run()
+{
+	vector<DataPacket *> batch, out;
+	try {
+		while( running ) {
+			//sleep until a packet arrives or the oldest tick is due
+			long timeout = 0;
+			if( !ticks.empty() ) {
+				unsigned long long now = Clock::nowNs();
+				unsigned long long deadline = ticks.front().deadline;
+				timeout = deadline > now ? (deadline - now + 999999) / 1000000 : -1;
+			}
+			if( timeout >= 0 ) {
+				waitSet.wait( timeout );
+			}
+
+			//the samples first, they may complete the ticks
+			for( unsigned int i = inPorts.size(); i-- > 0; ) {
+				while( inPorts[i]->notEmpty() ) {
+					batch.clear();
+					inPorts[i]->receiveBatch( batch, 64, 1 );
+					receive( i, batch );
+				}
+			}
+			mergeReady( out );
+			outPorts[0]->sendBatch( out );
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+}
+
+
+/// Queue the packets \p batch of in-port \p port.
+void StreamSynchronizer::receive( unsigned int port, vector<DataPacket *> &batch )
+{
+	if( port == 0 ) {
+		unsigned long long deadline = Clock::nowNs() + latenessNs;
+		for( unsigned int k = 0; k < batch.size(); k++ ) {
+			Tick t = { batch[k], deadline };
+			ticks.push_back( t );
+		}
+		return;
+	}
+
+	deque<DataPacket *> &q = samples[port];
+	for( unsigned int k = 0; k < batch.size(); k++ ) {
+		q.push_back( batch[k] );
+	}
+	while( q.size() > maxPending ) {
+		delete q.front();
+		q.pop_front();
+	}
+	prune( port, ticks.empty() ? lastNs : ticks.front().packet->timestampNs );
+}
+
+
+/// Merge the ticks that are complete, due or exceed maxPending.
+void StreamSynchronizer::mergeReady( vector<DataPacket *> &out )
+{
+	unsigned long long now = Clock::nowNs();
+	while( !ticks.empty() ) {
+		Tick &t = ticks.front();
+		bool complete = isComplete( t.packet );
+		if( !complete && t.deadline > now && ticks.size() <= maxPending ) {
+			break;
+		}
+		if( complete ) {
+			out.push_back( merge( t.packet ) );
+		}
+		else if( isStarted() ) {
+			out.push_back( merge( t.packet ) );
+			late++;
+		}
+		else {
+			delete t.packet;
+			dropped++;
+		}
+		ticks.pop_front();
+	}
+}
+
+
+/// Check if all streams delivered a sample.
+bool StreamSynchronizer::isStarted() const
+{
+	for( unsigned int i = 1; i < samples.size(); i++ ) {
+		if( samples[i].empty() ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/// Check if all streams have a sample at or after \p tick.
+bool StreamSynchronizer::isComplete( const DataPacket *tick ) const
+{
+	for( unsigned int i = 1; i < samples.size(); i++ ) {
+		if( samples[i].empty() || samples[i].back()->timestampNs < tick->timestampNs ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/// Create the merged packet of \p tick (deleted).
+DataPacket *StreamSynchronizer::merge( DataPacket *tick )
+{
+	unsigned long long ns = tick->timestampNs;
+	ChannelBuffer tmp;
+	ChannelBuffer channels = tick->getTypedChannels( tmp );
+	for( unsigned int i = 1; i < samples.size(); i++ ) {
+		appendSample( channels, i, ns );
+		prune( i, ns );
+	}
+
+	DataPacket *p = new DataPacket( tick->getStreamId() );
+	p->seqNr = tick->seqNr;
+	p->timestamp = tick->timestamp;
+	p->timestampNs = ns;
+	p->endOfStream = tick->endOfStream;
+	p->channels = channels;
+	delete tick;
+
+	lastNs = ns;
+	merged++;
+	return p;
+}
+
+
+/// Append the channels of stream \p input at time \p ns to \p out.
+void StreamSynchronizer::appendSample( ChannelBuffer &out, unsigned int input, unsigned long long ns )
+{
+	const deque<DataPacket *> &q = samples[input];
+	if( q.empty() ) {
+		return;
+	}
+
+	//first sample after ns
+	unsigned int lo = 0, hi = q.size();
+	while( lo < hi ) {
+		unsigned int mid = (lo + hi) / 2;
+		if( q[mid]->timestampNs <= ns ) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	DataPacket *before = lo > 0 ? q[lo - 1] : NULL;
+	DataPacket *after = lo < q.size() ? q[lo] : NULL;
+
+	if( policy == HOLD && !before ) {
+		//nothing to hold yet, see the class description
+		unsigned int first = out.size();
+		ChannelBuffer tmp;
+		out.append( after->getTypedChannels( tmp ) );
+		for( unsigned int c = first; c < out.size(); c++ ) {
+			out.setInt( c, 0 );
+			out.setValid( c, false );
+		}
+		return;
+	}
+
+	DataPacket *s;
+	if( !before || !after ) {
+		s = before ? before : after;
+	}
+	else if( policy == HOLD ) {
+		s = before;
+	}
+	else if( policy == LINEAR && before->timestampNs < ns && before->size() == after->size() ) {
+		ChannelBuffer ta, tb;
+		const ChannelBuffer &a = before->getTypedChannels( ta );
+		const ChannelBuffer &b = after->getTypedChannels( tb );
+		double f = (double)(ns - before->timestampNs) / (after->timestampNs - before->timestampNs);
+		for( unsigned int c = 0; c < a.size(); c++ ) {
+			float x = a.getFloat( c ), y = b.getFloat( c );
+			out.appendFloat( x + (y - x) * f, a.isValid( c ) && b.isValid( c ) );
+		}
+		return;
+	}
+	else {
+		s = ns - before->timestampNs <= after->timestampNs - ns ? before : after;
+	}
+
+	ChannelBuffer tmp;
+	out.append( s->getTypedChannels( tmp ) );
+}
+
+
+/// Delete the samples of \p input that no tick at or after \p ns needs.
+void StreamSynchronizer::prune( unsigned int input, unsigned long long ns )
+{
+	deque<DataPacket *> &q = samples[input];
+	while( q.size() > 1 && q[1]->timestampNs <= ns ) {
+		delete q.front();
+		q.pop_front();
+	}
+}
@@ -0,0 +1,119 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// StreamSynchronizer.h - merge streams aligned by time stamp
+
+#ifndef STREAMSYNCHRONIZER_H
+#define STREAMSYNCHRONIZER_H
+
+#include "../core/StreamTask.h"
+#include "../core/WaitSet.h"
+#include <deque>
+#include <vector>
+
+
+/**
+ * \ingroup filters
+ * \brief Merges several streams into one, aligned by time stamp.
+ *
+ * In-port 0 is the reference: every packet arriving there is a tick and
+ * results in one merged packet. It holds the channels of the tick followed
+ * by the channels of in-ports 1, 2, ..., taken at the time stamp
+ * (DataPacket::timestampNs) of the tick according to the #Policy:
+ *
+ * - NEAREST: the sample closest in time,
+ * - HOLD: the last sample at or before the tick. A stream without such a
+ *   sample contributes the channels of its next sample, set to zero and
+ *   invalid: the layout stays the same, but no future value is used,
+ * - LINEAR: interpolated between the samples around the tick (the
+ *   channels become float channels, invalid if either sample is invalid).
+ *
+ * A tick is merged as soon as every other stream has a sample at or after
+ * it, or at the latest \a lateness nanoseconds after it arrived. A stream
+ * that is late by then contributes the samples it has (LINEAR falls back
+ * to the nearest sample). Ticks that are due before every stream delivered
+ * a sample are dropped, the channel layout would not be known.
+ *
+ * The task waits on a WaitSet, so it wakes up on whichever in-port has
+ * data. Memory is bounded: samples no longer needed for a future tick
+ * are deleted, and neither the pending ticks nor the samples of a stream
+ * exceed \a maxPending packets (the oldest tick is merged early, the
+ * oldest sample dropped).
+ *
+ * The merged packets have the stream id, time stamps and sequence number
+ * of their tick.
+ */
+class StreamSynchronizer : public StreamTask
+{
+	public:
+		/// How the samples of a stream are matched to a tick.
+		enum Policy {
+			NEAREST,
+			HOLD,
+			LINEAR
+		};
+
+		/**
+		 * \param inputs Number of in-ports (including the reference).
+		 * \param policy Matching of the samples.
+		 * \param latenessMs Maximal time in milliseconds a tick waits for the other streams.
+		 */
+		StreamSynchronizer( unsigned int inputs, Policy policy = NEAREST, unsigned int latenessMs = 100 );
+		virtual ~StreamSynchronizer();
+
+		/// Maximal number of pending ticks and queued samples per stream.
+		void setMaxPending( unsigned int n ) { maxPending = n > 2 ? n : 2; }
+
+		/// Number of ticks merged.
+		unsigned long long getMerged() const { return merged; }
+
+		/// Number of ticks merged before all streams caught up.
+		unsigned long long getLate() const { return late; }
+
+		/// Number of ticks dropped before all streams started.
+		unsigned long long getDropped() const { return dropped; }
+
+	protected:
+		virtual void run();
+		virtual void cancelAllBlockingCalls();
+
+	private:
+		struct Tick {
+			DataPacket *packet;
+			unsigned long long deadline;	///< Monotonic time to merge at the latest.
+		};
+
+		Policy policy;
+		unsigned long long latenessNs;
+		unsigned int maxPending;
+		WaitSet waitSet;
+		std::deque<Tick> ticks;
+		std::vector< std::deque<DataPacket *> > samples;	///< Per in-port, 0 unused.
+		unsigned long long merged;
+		unsigned long long late;
+		unsigned long long dropped;
+		unsigned long long lastNs;		///< Time stamp of the last merged tick.
+
+		void receive( unsigned int port, std::vector<DataPacket *> &batch );
+		void mergeReady( std::vector<DataPacket *> &out );
+		bool isStarted() const;
+		bool isComplete( const DataPacket *tick ) const;
+		DataPacket *merge( DataPacket *tick );
+		void appendSample( ChannelBuffer &out, unsigned int input, unsigned long long ns );
+		void prune( unsigned int input, unsigned long long ns );
+};
+
+
+#endif	//STREAMSYNCHRONIZER_H
@@ -0,0 +1,378 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// WindowStatistics.cpp
+
+#include "WindowStatistics.h"
+#include "../core/FixedMath.h"
+
+using namespace std;
+
+
+/**
+ * State of one stream. The queues hold sample numbers, the values are
+ * looked up in the ring (a sample stays there until it leaves the window).
+ * In fixed-point mode the samples are kept in fixRing and the sums in
+ * fixSum and fixSumSq instead.
+ */
+struct WindowStatistics::Window
+{
+	/// Monotonic queue of sample numbers with capacity windowSize.
+	struct Queue {
+		unsigned long long head, tail;
+	};
+
+	unsigned int channels;
+	unsigned int size;					///< windowSize
+	unsigned long long count;			///< Samples pushed.
+	unsigned long long seqNr;
+	bool fixed;
+	vector<float> ring;					///< size x channels
+	vector<double> mean, m2, sumSq;
+	vector<fix> fixRing;				///< size x channels (fixed point)
+	vector<long long> fixSum, fixSumSq;	///< Q16.16, exact (fixed point)
+	vector<unsigned long long> minItems, maxItems;	///< channels x size
+	vector<Queue> minQ, maxQ;
+
+	Window( unsigned int size, unsigned int channels, bool fixed ) :
+		channels(channels), size(size), count(0), seqNr(0), fixed(fixed),
+		minItems(size * channels), maxItems(size * channels), minQ(channels), maxQ(channels)
+	{
+		if( fixed ) {
+			fixRing.resize( size * channels );
+			fixSum.resize( channels );
+			fixSumSq.resize( channels );
+		}
+		else {
+			ring.resize( size * channels );
+			mean.resize( channels );
+			m2.resize( channels );
+			sumSq.resize( channels );
+		}
+		Queue empty = { 0, 0 };
+		minQ.assign( channels, empty );
+		maxQ.assign( channels, empty );
+	}
+
+	float value( unsigned long long t, unsigned int c ) const { return ring[(t % size) * channels + c]; }
+	fix fixValue( unsigned long long t, unsigned int c ) const { return fixRing[(t % size) * channels + c]; }
+
+	void push( const float *x );
+	void push( const fix *x );
+	void resync();
+
+	template <class T>
+	void track( const vector<T> &r, unsigned int c, unsigned long long t, bool full, T x );
+};
+
+
+/// Add sample \p t with value \p x of channel \p c to the min and max queues.
+template <class T>
+void WindowStatistics::Window::track( const vector<T> &r, unsigned int c, unsigned long long t, bool full, T x )
+{
+	//drop the sample that left the window, then the ones the new sample dominates
+	unsigned long long *items = &minItems[c * size];
+	Queue &q = minQ[c];
+	if( q.head != q.tail && full && items[q.head % size] == t - size ) {
+		q.head++;
+	}
+	while( q.head != q.tail && r[(items[(q.tail - 1) % size] % size) * channels + c] >= x ) {
+		q.tail--;
+	}
+	items[q.tail++ % size] = t;
+
+	items = &maxItems[c * size];
+	Queue &m = maxQ[c];
+	if( m.head != m.tail && full && items[m.head % size] == t - size ) {
+		m.head++;
+	}
+	while( m.head != m.tail && r[(items[(m.tail - 1) % size] % size) * channels + c] <= x ) {
+		m.tail--;
+	}
+	items[m.tail++ % size] = t;
+}
+
+
+void WindowStatistics::Window::push( const float *x )
+{
+	unsigned long long t = count++;
+	bool full = t >= size;
+	float *slot = &ring[(t % size) * channels];
+
+	for( unsigned int c = 0; c < channels; c++ ) {
+		double v = x[c];
+		if( full ) {
+			//replace the oldest sample
+			double old = slot[c];
+			double prevMean = mean[c];
+			mean[c] += (v - old) / size;
+			m2[c] += (v - old) * (v - mean[c] + old - prevMean);
+			sumSq[c] += v * v - old * old;
+		}
+		else {
+			double d = v - mean[c];
+			mean[c] += d / (t + 1);
+			m2[c] += d * (v - mean[c]);
+			sumSq[c] += v * v;
+		}
+		track( ring, c, t, full, x[c] );
+	}
+	//the queues compare against the ring, so it is written last
+	for( unsigned int c = 0; c < channels; c++ ) {
+		slot[c] = x[c];
+	}
+
+	if( count % size == 0 ) {
+		resync();
+	}
+}
+
+
+/**
+ * Integer sums are exact (the squares are rounded the same way when they
+ * are added and removed), so they need no resync().
+ */
+void WindowStatistics::Window::push( const fix *x )
+{
+	unsigned long long t = count++;
+	bool full = t >= size;
+	fix *slot = &fixRing[(t % size) * channels];
+
+	for( unsigned int c = 0; c < channels; c++ ) {
+		if( full ) {
+			fix old = slot[c];
+			fixSum[c] -= old;
+			fixSumSq[c] -= ((long long)old * old) >> 16;
+		}
+		fixSum[c] += x[c];
+		fixSumSq[c] += ((long long)x[c] * x[c]) >> 16;
+		track( fixRing, c, t, full, x[c] );
+	}
+	for( unsigned int c = 0; c < channels; c++ ) {
+		slot[c] = x[c];
+	}
+}
+
+
+/// Recompute the sums from the samples in the window.
+void WindowStatistics::Window::resync()
+{
+	unsigned int n = count < size ? count : size;
+	for( unsigned int c = 0; c < channels; c++ ) {
+		double sum = 0, sq = 0;
+		for( unsigned int i = 0; i < n; i++ ) {
+			sum += ring[i * channels + c];
+		}
+		double m = sum / n, d2 = 0;
+		for( unsigned int i = 0; i < n; i++ ) {
+			double d = ring[i * channels + c] - m;
+			d2 += d * d;
+			sq += (double)ring[i * channels + c] * ring[i * channels + c];
+		}
+		mean[c] = m;
+		m2[c] = d2;
+		sumSq[c] = sq;
+	}
+}
+
+
+WindowStatistics::WindowStatistics( unsigned int windowSize, unsigned int hopSize, unsigned int features ) :
+	StreamTask( 1, 1 ),
+	windowSize(windowSize > 0 ? windowSize : 1),
+	hopSize(hopSize > 0 ? hopSize : 1),
+	features(features & ALL)
+{
+	setId( "windowstatistics" );
+}
+
+
+WindowStatistics::~WindowStatistics()
+{
+	for( map<int, Window *>::iterator it = windows.begin(); it != windows.end(); it++ ) {
+		delete it->second;
+	}
+}
+
+
+unsigned int WindowStatistics::getFeatureCount() const
+{
+	return __builtin_popcount( features );
+}
+
+
+void WindowStatistics::run()
+{
+	vector<DataPacket *> batch, out;
+	try {
+		while( running ) {
+			batch.clear();
+			inPorts[0]->receiveBatch( batch, 64 );
+			for( unsigned int i = 0; i < batch.size(); i++ ) {
+				handle( batch[i], out );
+			}
+			outPorts[0]->sendBatch( out );
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+}
+
+
+void WindowStatistics::process()
+{
+	vector<DataPacket *> batch, out;
+	while( inPorts[0]->notEmpty() ) {
+		batch.clear();
+		inPorts[0]->receiveBatch( batch, 64, 1 );
+		for( unsigned int i = 0; i < batch.size(); i++ ) {
+			handle( batch[i], out );
+		}
+		outPorts[0]->sendBatch( out );
+	}
+}
+
+
+/// Add the sample \p p (deleted) to the window of its stream.
+void WindowStatistics::handle( DataPacket *p, vector<DataPacket *> &out )
+{
+	unsigned int n = p->size();
+	bool fixed = isFixedPoint();
+
+	Window *&w = windows[p->getStreamId()];
+	if( w && w->channels != n ) {
+		log( "number of channels changed, restarting window of stream " ) << p->getStreamId() << endl;
+		delete w;
+		w = NULL;
+	}
+	if( w && w->fixed != fixed ) {
+		delete w;
+		w = NULL;
+	}
+	if( !w ) {
+		w = new Window( windowSize, n, fixed );
+	}
+
+	if( fixed ) {
+		fixSample.resize( n );
+		if( n ) {
+			readFix( p, &fixSample[0] );
+		}
+		w->push( n ? &fixSample[0] : (const fix *)NULL );
+	}
+	else {
+		const float *x = p->getFloatChannels();
+		if( !x ) {
+			sample.resize( n );
+			for( unsigned int c = 0; c < n; c++ ) {
+				sample[c] = p->getChannel( c )->getFloat();
+			}
+			x = n ? &sample[0] : NULL;
+		}
+		w->push( x );
+	}
+
+	if( w->count >= windowSize && (w->count - windowSize) % hopSize == 0 ) {
+		out.push_back( fixed ? createFixFeatures( *w, p ) : createFeatures( *w, p ) );
+	}
+	delete p;
+}
+
+
+/// Read the channels of \p p as Q16.16 values into \p x.
+void WindowStatistics::readFix( const DataPacket *p, fix *x )
+{
+	unsigned int n = p->size();
+	const float *f = p->getFloatChannels();
+	if( f ) {
+		FixedMath::fromFloat( x, f, n );
+	}
+	else if( p->isTyped() && p->channels.isHomogeneous( ChannelBuffer::INT ) ) {
+		FixedMath::fromInt( x, p->channels.intData(), n );
+	}
+	else {
+		for( unsigned int c = 0; c < n; c++ ) {
+			x[c] = FixedMath::fromFloat( p->getChannel( c )->getFloat() );
+		}
+	}
+}
+
+
+DataPacket *WindowStatistics::createFeatures( Window &w, const DataPacket *p )
+{
+	unsigned int k = getFeatureCount();
+	DataPacket *f = new DataPacket( p->getStreamId(), w.channels * k, ChannelBuffer::FLOAT );
+	f->seqNr = w.seqNr++;
+	f->timestamp = p->timestamp;
+	f->timestampNs = p->timestampNs;
+
+	float *o = f->editFloatChannels();
+	for( unsigned int c = 0; c < w.channels; c++ ) {
+		if( features & MEAN ) {
+			*o++ = w.mean[c];
+		}
+		if( features & VARIANCE ) {
+			double v = w.m2[c] / windowSize;
+			*o++ = v > 0 ? v : 0;
+		}
+		if( features & MIN ) {
+			*o++ = w.value( w.minItems[c * windowSize + w.minQ[c].head % windowSize], c );
+		}
+		if( features & MAX ) {
+			*o++ = w.value( w.maxItems[c * windowSize + w.maxQ[c].head % windowSize], c );
+		}
+		if( features & ENERGY ) {
+			*o++ = w.sumSq[c] / windowSize;
+		}
+	}
+	return f;
+}
+
+
+/**
+ * Variance is computed as energy - mean^2, so it loses precision for
+ * channels whose mean is large compared to their spread.
+ */
+DataPacket *WindowStatistics::createFixFeatures( Window &w, const DataPacket *p )
+{
+	unsigned int k = getFeatureCount();
+	DataPacket *f = new DataPacket( p->getStreamId(), w.channels * k, ChannelBuffer::INT );
+	f->seqNr = w.seqNr++;
+	f->timestamp = p->timestamp;
+	f->timestampNs = p->timestampNs;
+
+	fix *o = f->channels.intData();
+	for( unsigned int c = 0; c < w.channels; c++ ) {
+		long long mean = w.fixSum[c] / (long long)windowSize;
+		long long energy = w.fixSumSq[c] / (long long)windowSize;
+		if( features & MEAN ) {
+			*o++ = FixedMath::saturate( mean );
+		}
+		if( features & VARIANCE ) {
+			long long v = energy - ((mean * mean) >> 16);
+			*o++ = FixedMath::saturate( v > 0 ? v : 0 );
+		}
+		if( features & MIN ) {
+			*o++ = w.fixValue( w.minItems[c * windowSize + w.minQ[c].head % windowSize], c );
+		}
+		if( features & MAX ) {
+			*o++ = w.fixValue( w.maxItems[c * windowSize + w.maxQ[c].head % windowSize], c );
+		}
+		if( features & ENERGY ) {
+			*o++ = FixedMath::saturate( energy );
+		}
+	}
+	return f;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// WindowStatistics.h - sliding window features per channel
+
+#ifndef WINDOWSTATISTICS_H
+#define WINDOWSTATISTICS_H
+
+#include "../core/StreamTask.h"
+#include <map>
+#include <vector>
+
+
+/**
+ * \defgroup filters Filters
+ * \brief Stream tasks that compute features from their input or combine streams.
+ */
+
+/**
+ * \ingroup filters
+ * \brief Mean, variance, minimum, maximum and energy over a sliding window.
+ *
+ * Every input packet is one sample of its channels. The task keeps the
+ * last \a windowSize samples of each stream in a ring and, once the window
+ * is full, sends a feature packet every \a hopSize samples. The features
+ * of a channel are sent next to each other in the order of #Feature:
+ *
+ * - mean,
+ * - variance (population variance, divided by windowSize),
+ * - minimum and maximum,
+ * - energy (mean of the squares).
+ *
+ * The statistics are updated per sample, independent of the window length:
+ * mean and variance with Welford's update (the oldest sample is replaced
+ * by the new one), minimum and maximum with monotonic queues of sample
+ * numbers. To remove rounding drift, the sums are recomputed from the
+ * ring once per window length, which is O(1) per sample as well.
+ *
+ * Feature packets are typed float packets with the stream id, time stamp
+ * and sequence number of the sample that completed the window. If the
+ * number of channels of a stream changes, its window starts again.
+ *
+ * With StreamTask::setFixedPoint() the task computes in Q16.16 (see
+ * FixedMath): the samples are converted to \c fix, the sums are exact
+ * 64 bit integers and the feature packets have INT channels holding
+ * Q16.16 values.
+ */
+class WindowStatistics : public StreamTask
+{
+	public:
+		/// Features, combine them for the constructor.
+		enum Feature {
+			MEAN = 1,
+			VARIANCE = 2,
+			MIN = 4,
+			MAX = 8,
+			ENERGY = 16,
+			ALL = 31
+		};
+
+		/**
+		 * \param windowSize Samples per window.
+		 * \param hopSize Samples between two feature packets.
+		 * \param features Features to send (combination of #Feature).
+		 */
+		WindowStatistics( unsigned int windowSize, unsigned int hopSize, unsigned int features = ALL );
+		virtual ~WindowStatistics();
+
+		/// Number of features sent per input channel.
+		unsigned int getFeatureCount() const;
+
+	protected:
+		virtual void run();
+		virtual void process();
+
+	private:
+		struct Window;
+
+		unsigned int windowSize;
+		unsigned int hopSize;
+		unsigned int features;
+		std::map<int, Window *> windows;
+		std::vector<float> sample;
+		std::vector<fix> fixSample;
+
+		void handle( DataPacket *p, std::vector<DataPacket *> &out );
+		DataPacket *createFeatures( Window &w, const DataPacket *p );
+		DataPacket *createFixFeatures( Window &w, const DataPacket *p );
+		static void readFix( const DataPacket *p, fix *x );
+};
+
+
+#endif	//WINDOWSTATISTICS_H
@@ -0,0 +1,67 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Recorder.cpp
+
+#include "Recorder.h"
+#include "../core/Clock.h"
+
+using namespace std;
+
+
+Recorder::Recorder( const string &fileName ) :
+	StreamTask( 1, 0 ),
+	writer(fileName),
+	flushInterval(1000),
+	recorded(0)
+{
+	setId( "recorder" );
+}
+
+
+Recorder::~Recorder()
+{
+}
+
+
+void Recorder::run()
+{
+	if( !writer.open() ) {
+		return;
+	}
+	vector<DataPacket *> batch;
+	unsigned long long nextFlush = Clock::nowNs() + flushInterval * 1000000ULL;
+	try {
+		while( running ) {
+			batch.clear();
+			inPorts[0]->receiveBatch( batch, 64, flushInterval );
+			for( unsigned int i = 0; i < batch.size(); i++ ) {
+				writer.append( batch[i] );
+				delete batch[i];
+			}
+			recorded += batch.size();
+
+			unsigned long long now = Clock::nowNs();
+			if( now >= nextFlush ) {
+				writer.flush();
+				nextFlush = now + flushInterval * 1000000ULL;
+			}
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+	writer.close();
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Recorder.h - stream task writing its input to a recording
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "RecordingWriter.h"
+#include "../core/StreamTask.h"
+
+
+/**
+ * \ingroup recording
+ * \brief Writes all packets of its in-port to a recording.
+ *
+ * Packets of all streams arriving at the single in-port are written with
+ * a RecordingWriter and deleted. Chunks are completed and written at least
+ * every \a flushInterval milliseconds, so a crash loses little data even
+ * for slow streams. Read the recording with RecordingReader.
+ */
+class Recorder : public StreamTask
+{
+	public:
+		/// \param fileName Base name of the segment files, see RecordingWriter.
+		Recorder( const std::string &fileName );
+		virtual ~Recorder();
+
+		/// Maximal bytes per segment file.
+		void setSegmentSize( unsigned long long bytes ) { writer.setSegmentSize( bytes ); }
+
+		/// Packets per chunk.
+		void setChunkPackets( unsigned int n ) { writer.setChunkPackets( n ); }
+
+		/// Sample rate written to the chunks, 0 (default) estimates it.
+		void setSampleRate( float hz ) { writer.setSampleRate( hz ); }
+
+		/// Maximal time in milliseconds that packets stay in memory.
+		void setFlushInterval( unsigned int ms ) { flushInterval = ms > 0 ? ms : 1; }
+
+		/// Number of packets written.
+		unsigned long long getRecorded() const { return recorded; }
+
+	protected:
+		virtual void run();
+
+	private:
+		RecordingWriter writer;
+		unsigned int flushInterval;
+		unsigned long long recorded;
+};
+
+
+#endif	//RECORDER_H
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Recording.cpp
+
+#include "Recording.h"
+#include <string.h>
+
+
+static const uint32 BYTE_ORDER_MARK = 0x01020304;
+
+
+void RecordingFileHeader::init( uint32 segment_, long long createdNs_ )
+{
+	memset( this, 0, sizeof(*this) );
+	memcpy( magic, "CRNTREC", 8 );
+	byteOrder = BYTE_ORDER_MARK;
+	version = VERSION;
+	headerSize = sizeof(*this);
+	segment = segment_;
+	createdNs = createdNs_;
+}
+
+
+bool RecordingFileHeader::isValid() const
+{
+	return !memcmp( magic, "CRNTREC", 8 )
+		&& byteOrder == BYTE_ORDER_MARK
+		&& version == VERSION
+		&& headerSize == sizeof(*this);
+}
+
+
+bool RecordingChunkHeader::isValid() const
+{
+	return !memcmp( magic, "CRNC", 4 )
+		&& size % 8 == 0
+		&& recordSize == recordSizeFor( channels )
+		&& size == sizeof(*this) + typesSize( channels ) + (unsigned long long)packets * recordSize;
+}
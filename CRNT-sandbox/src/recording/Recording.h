@@ -0,0 +1,142 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Recording.h - on-disk layout of recordings
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "../core/Value.h"
+
+
+/**
+ * \defgroup recording Recording
+ * \brief Recording of data packet streams to disk and replay.
+ *
+ * A recording is a sequence of segment files <tt>name.0000.crec</tt>,
+ * <tt>name.0001.crec</tt>, ... Every segment starts with a
+ * RecordingFileHeader followed by chunks. A chunk holds consecutive packets
+ * of one stream with the same channel layout:
+ *
+ * \verbatim
+   RecordingChunkHeader      64 bytes
+   w x u32                   type bits, bit i set if channel i is an int  (w = (n + 31) / 32)
+                             padded to 8 bytes
+   packets x record          recordSize bytes each:
+       RecordingPacket       24 bytes
+       n x 32 bit            channel values (float or int32)
+       w x u32               valid bits
+                             padded to 8 bytes
+   \endverbatim
+ *
+ * All fields are in host byte order and aligned, so the reader maps the
+ * segments into memory and uses the structures in place. Chunks never
+ * span segments and are appended only when complete.
+ */
+
+
+/**
+ * \ingroup recording
+ * \brief Header of a segment file.
+ */
+struct RecordingFileHeader
+{
+	static const unsigned short VERSION = 1;
+
+	char magic[8];					///< "CRNTREC"
+	uint32 byteOrder;				///< 0x01020304 written in host byte order
+	unsigned short version;
+	unsigned short headerSize;		///< sizeof(RecordingFileHeader)
+	uint32 segment;					///< Number of this segment.
+	uint32 reserved0;
+	long long createdNs;			///< Wall clock time of creation, ns since the epoch.
+	uint32 reserved[8];
+
+	void init( uint32 segment, long long createdNs );
+
+	/// Check magic, byte order and version.
+	bool isValid() const;
+};
+
+
+/**
+ * \ingroup recording
+ * \brief Header of a recorded packet.
+ */
+struct RecordingPacket
+{
+	enum {
+		END_OF_STREAM = 1			///< Flag of DataPacket::endOfStream.
+	};
+
+	unsigned long long seqNr;
+	long long timestampNs;			///< Wall clock time, ns since the epoch.
+	uint32 flags;
+	uint32 reserved;
+
+	/// The raw channel values, see ChannelBuffer::getRaw().
+	const uint32 *values() const { return (const uint32 *)(this + 1); }
+};
+
+
+/**
+ * \ingroup recording
+ * \brief Header of a chunk of packets of one stream.
+ */
+struct RecordingChunkHeader
+{
+	char magic[4];					///< "CRNC"
+	uint32 size;					///< Bytes of the chunk including this header, a multiple of 8.
+	int streamId;
+	uint32 packets;
+	uint32 channels;
+	uint32 recordSize;				///< Bytes per packet record.
+	float sampleRate;				///< Samples per second (configured or estimated, 0 if unknown).
+	uint32 flags;
+	unsigned long long firstSeqNr;
+	long long firstNs;				///< Time stamp of the first packet.
+	long long lastNs;				///< Time stamp of the last packet.
+	uint32 reserved[2];
+
+	/// Words of the type and valid bitmaps.
+	uint32 bitWords() const { return (channels + 31) / 32; }
+
+	/// Type bits of the channels, bit i set if channel i is an int.
+	const uint32 *typeBits() const { return (const uint32 *)(this + 1); }
+
+	/// Get the record of packet \p k.
+	const RecordingPacket *packet( uint32 k ) const
+	{
+		return (const RecordingPacket *)((const char *)(this + 1) + typesSize( channels ) + k * recordSize);
+	}
+
+	/// Valid bits of packet \p k, bit i set if channel i is valid.
+	const uint32 *validBits( uint32 k ) const { return packet( k )->values() + channels; }
+
+	/// Check the magic and the consistency of the sizes.
+	bool isValid() const;
+
+	/// Bytes of the type bitmap (padded).
+	static uint32 typesSize( uint32 channels ) { return ((channels + 31) / 32 * 4 + 7) & ~7u; }
+
+	/// Bytes of a packet record with \p channels channels.
+	static uint32 recordSizeFor( uint32 channels )
+	{
+		return (sizeof(RecordingPacket) + 4 * channels + (channels + 31) / 32 * 4 + 7) & ~7u;
+	}
+};
+
+
+#endif	//RECORDING_H
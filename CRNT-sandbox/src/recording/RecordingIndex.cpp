@@ -0,0 +1,85 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// RecordingIndex.cpp
+
+#include "RecordingIndex.h"
+#include <algorithm>
+
+using namespace std;
+
+
+/// Order by first time stamp.
+static bool earlier( const RecordingIndex::Entry &a, const RecordingIndex::Entry &b )
+{
+	return a.firstNs < b.firstNs;
+}
+
+
+/// Compare the running maximum for seek().
+static bool endsBefore( const RecordingIndex::Entry &e, long long ns )
+{
+	return e.maxLastNs < ns;
+}
+
+
+RecordingIndex::RecordingIndex()
+{
+}
+
+
+void RecordingIndex::build( const RecordingReader &reader )
+{
+	entries.clear();
+	entries.reserve( reader.chunkCount() );
+	for( unsigned int i = 0; i < reader.chunkCount(); i++ ) {
+		const RecordingChunkHeader *c = reader.chunk( i );
+		if( c->packets == 0 ) {
+			continue;
+		}
+		Entry e;
+		e.firstNs = c->firstNs;
+		e.maxLastNs = c->lastNs;
+		e.chunk = c;
+		entries.push_back( e );
+	}
+	//stable: chunks of a stream with the same start time keep the file order
+	stable_sort( entries.begin(), entries.end(), earlier );
+	for( unsigned int i = 1; i < entries.size(); i++ ) {
+		entries[i].maxLastNs = max( entries[i].maxLastNs, entries[i - 1].maxLastNs );
+	}
+}
+
+
+unsigned int RecordingIndex::seek( long long ns ) const
+{
+	return lower_bound( entries.begin(), entries.end(), ns, endsBefore ) - entries.begin();
+}
+
+
+uint32 RecordingIndex::findPacket( const RecordingChunkHeader *c, long long ns )
+{
+	uint32 lo = 0, hi = c->packets;
+	while( lo < hi ) {
+		uint32 mid = lo + (hi - lo) / 2;
+		if( c->packet( mid )->timestampNs < ns ) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
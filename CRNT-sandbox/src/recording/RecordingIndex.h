@@ -0,0 +1,79 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// RecordingIndex.h - time index over the chunks of a recording
+
+#ifndef RECORDINGINDEX_H
+#define RECORDINGINDEX_H
+
+#include "RecordingReader.h"
+#include <vector>
+
+
+/**
+ * \ingroup recording
+ * \brief Sparse time index of a recording.
+ *
+ * Holds one entry per chunk, sorted by the time stamp of the first packet.
+ * Each entry also keeps the largest time stamp of all chunks up to it, so
+ * seek() finds the first chunk that may hold packets at or after a time
+ * with a binary search. Within a chunk findPacket() searches the records
+ * in place.
+ *
+ * Chunks of the same stream keep their order, so packets of a stream are
+ * in time order when the chunks are read in index order. Packets of
+ * different streams have to be merged by time stamp (see Replay).
+ */
+class RecordingIndex
+{
+	public:
+		/// An indexed chunk.
+		struct Entry {
+			long long firstNs;			///< Time stamp of the first packet of the chunk.
+			long long maxLastNs;		///< Largest time stamp of this and all previous entries.
+			const RecordingChunkHeader *chunk;
+		};
+
+		RecordingIndex();
+
+		/// Index all chunks of \p reader (which must stay open).
+		void build( const RecordingReader &reader );
+
+		unsigned int size() const { return entries.size(); }
+		const Entry &entry( unsigned int i ) const { return entries[i]; }
+
+		/// Time stamp of the first packet (0 if empty).
+		long long startNs() const { return entries.empty() ? 0 : entries.front().firstNs; }
+
+		/// Time stamp of the last packet (0 if empty).
+		long long endNs() const { return entries.empty() ? 0 : entries.back().maxLastNs; }
+
+		/**
+		 * \brief Find the first entry that may hold packets at or after \p ns.
+		 *
+		 * All packets at or after \p ns are in the entries from the result
+		 * on. The result is size() if there are none.
+		 */
+		unsigned int seek( long long ns ) const;
+
+		/// Index of the first record in chunk \p c at or after \p ns (c->packets if none).
+		static uint32 findPacket( const RecordingChunkHeader *c, long long ns );
+
+	private:
+		std::vector<Entry> entries;
+};
+
+
+#endif	//RECORDINGINDEX_H
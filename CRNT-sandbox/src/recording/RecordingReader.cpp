@@ -0,0 +1,128 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// RecordingReader.cpp
+
+#include "RecordingReader.h"
+#include "RecordingWriter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+RecordingReader::RecordingReader( const string &baseName ) : baseName(baseName), packets(0)
+{
+}
+
+
+RecordingReader::~RecordingReader()
+{
+	close();
+}
+
+
+bool RecordingReader::open()
+{
+	close();
+	if( !mapSegment( 0, true ) ) {
+		return false;
+	}
+	for( unsigned int s = 1; mapSegment( s, false ); s++ ) {
+	}
+	return true;
+}
+
+
+void RecordingReader::close()
+{
+	for( unsigned int i = 0; i < segments.size(); i++ ) {
+		munmap( segments[i].addr, segments[i].length );
+	}
+	segments.clear();
+	chunks.clear();
+	packets = 0;
+}
+
+
+bool RecordingReader::mapSegment( unsigned int segment, bool required )
+{
+	string name = RecordingWriter::segmentName( baseName, segment );
+	int fd = ::open( name.c_str(), O_RDONLY );
+	if( fd < 0 ) {
+		if( required || errno != ENOENT ) {
+			log( "ERROR: cannot open recording segment " ) << name << ": " << strerror( errno ) << endl;
+		}
+		return false;
+	}
+	struct stat st;
+	if( fstat( fd, &st ) < 0 || (size_t)st.st_size < sizeof(RecordingFileHeader) ) {
+		log( "ERROR: recording segment too short: " ) << name << endl;
+		::close( fd );
+		return false;
+	}
+	Segment seg;
+	seg.length = st.st_size;
+	seg.addr = mmap( NULL, seg.length, PROT_READ, MAP_PRIVATE, fd, 0 );
+	::close( fd );
+	if( seg.addr == MAP_FAILED ) {
+		log( "ERROR: cannot map recording segment " ) << name << ": " << strerror( errno ) << endl;
+		return false;
+	}
+	madvise( seg.addr, seg.length, MADV_SEQUENTIAL );
+
+	const char *base = (const char *)seg.addr;
+	const RecordingFileHeader *fh = (const RecordingFileHeader *)base;
+	if( !fh->isValid() || fh->segment != segment ) {
+		log( "ERROR: not a recording segment (or wrong version): " ) << name << endl;
+		munmap( seg.addr, seg.length );
+		return false;
+	}
+	segments.push_back( seg );
+
+	size_t off = sizeof(RecordingFileHeader);
+	while( off + sizeof(RecordingChunkHeader) <= seg.length ) {
+		const RecordingChunkHeader *c = (const RecordingChunkHeader *)(base + off);
+		if( !c->isValid() || c->size > seg.length - off ) {
+			log( "WARNING: recording segment " ) << name << " truncated at byte " << off << endl;
+			break;
+		}
+		chunks.push_back( c );
+		packets += c->packets;
+		off += c->size;
+	}
+	return true;
+}
+
+
+DataPacket *RecordingReader::createPacket( const RecordingChunkHeader *c, uint32 k )
+{
+	const RecordingPacket *r = c->packet( k );
+	DataPacket *p = new DataPacket( c->streamId );
+	p->seqNr = r->seqNr;
+	p->endOfStream = r->flags & RecordingPacket::END_OF_STREAM;
+	struct timeval tv;
+	tv.tv_sec = r->timestampNs / 1000000000LL;
+	tv.tv_usec = r->timestampNs % 1000000000LL / 1000;
+	p->setTimestamp( tv, false );	//recorded wall clock time
+	if( c->channels ) {
+		p->channels.setRaw( c->channels, r->values(), c->typeBits(), c->validBits( k ) );
+	}
+	return p;
+}
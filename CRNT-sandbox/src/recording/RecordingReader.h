@@ -0,0 +1,86 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// RecordingReader.h - memory mapped access to a recording
+
+#ifndef RECORDINGREADER_H
+#define RECORDINGREADER_H
+
+#include "Recording.h"
+#include "../core/TBObject.h"
+#include "../core/DataPacket.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * \ingroup recording
+ * \brief Reads a recording written by RecordingWriter.
+ *
+ * open() maps all segments into memory and collects the chunk headers.
+ * The packets are not parsed: chunk() and RecordingChunkHeader::packet()
+ * point into the mapped files. createPacket() makes a DataPacket from a
+ * record if needed.
+ *
+ * A segment that ends with an incomplete chunk (e.g. the recorder was
+ * killed) is read up to the last complete chunk.
+ */
+class RecordingReader : public TBObject
+{
+	public:
+		/// \param baseName Name of the recording as given to RecordingWriter.
+		RecordingReader( const std::string &baseName );
+		virtual ~RecordingReader();
+
+		/// Map all segments, returns false if the first one cannot be read.
+		bool open();
+
+		/// Unmap all segments.
+		void close();
+
+		/// Number of chunks in all segments.
+		unsigned int chunkCount() const { return chunks.size(); }
+
+		/// Get chunk \p i (in the order of the file).
+		const RecordingChunkHeader *chunk( unsigned int i ) const { return chunks[i]; }
+
+		/// Number of packets in all chunks.
+		unsigned long long packetCount() const { return packets; }
+
+		/// Number of mapped segments.
+		unsigned int segmentCount() const { return segments.size(); }
+
+		/// Create a typed data packet from record \p k of chunk \p c.
+		static DataPacket *createPacket( const RecordingChunkHeader *c, uint32 k );
+
+	private:
+		struct Segment {
+			void *addr;
+			size_t length;
+		};
+
+		std::string baseName;
+		std::vector<Segment> segments;
+		std::vector<const RecordingChunkHeader *> chunks;
+		unsigned long long packets;
+
+		RecordingReader( const RecordingReader & );
+		RecordingReader& operator=( const RecordingReader & );
+
+		bool mapSegment( unsigned int segment, bool required );
+};
+
+
+#endif	//RECORDINGREADER_H
@@ -0,0 +1,246 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// RecordingWriter.cpp
+
+#include "RecordingWriter.h"
+#include "../core/Clock.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+RecordingWriter::RecordingWriter( const string &baseName ) :
+	baseName(baseName),
+	segmentSize(DEFAULT_SEGMENT_SIZE),
+	chunkPackets(DEFAULT_CHUNK_PACKETS),
+	sampleRate(0),
+	fd(-1),
+	segment(0),
+	segmentBytes(0),
+	bytesWritten(0)
+{
+}
+
+
+RecordingWriter::~RecordingWriter()
+{
+	close();
+}
+
+
+string RecordingWriter::segmentName( const string &baseName, unsigned int segment )
+{
+	char suffix[32];
+	snprintf( suffix, sizeof(suffix), ".%04u.crec", segment );
+	return baseName + suffix;
+}
+
+
+bool RecordingWriter::open()
+{
+	if( fd >= 0 ) {
+		log( "ERROR: recording already open: " ) << baseName << endl;
+		return false;
+	}
+	buffer.reserve( DEFAULT_BUFFER_SIZE );
+	segment = 0;
+	return openSegment();
+}
+
+
+bool RecordingWriter::openSegment()
+{
+	if( fd >= 0 ) {
+		::close( fd );
+	}
+	string name = segmentName( baseName, segment );
+	fd = ::open( name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 ) {
+		log( "ERROR: cannot create recording segment " ) << name << ": " << strerror( errno ) << endl;
+		return false;
+	}
+
+	struct timeval now;
+	Clock::toTimeval( Clock::nowNs(), &now );
+	RecordingFileHeader h;
+	h.init( segment, now.tv_sec * 1000000000LL + now.tv_usec * 1000LL );
+	buffer.insert( buffer.end(), (const unsigned char *)&h, (const unsigned char *)(&h + 1) );
+	segmentBytes = sizeof(h);
+	segment++;
+	return true;
+}
+
+
+bool RecordingWriter::append( const DataPacket *p )
+{
+	if( fd < 0 ) {
+		return false;
+	}
+
+	p->checkSerializable();
+	ChannelBuffer tmp;
+	const ChannelBuffer &cb = p->getTypedChannels( tmp );
+	uint32 n = cb.size();
+	uint32 words = (n + 31) / 32;
+	uint32 recordSize = RecordingChunkHeader::recordSizeFor( n );
+
+	//the type bits decide about the chunk, so the values are read to the side first
+	record.assign( recordSize, 0 );
+	typeBits.assign( words + 1, 0 );
+	RecordingPacket *r = (RecordingPacket *)&record[0];
+	if( n ) {
+		uint32 *values = (uint32 *)(r + 1);
+		cb.getRaw( values, &typeBits[0], values + n );
+	}
+	r->seqNr = p->seqNr;
+	r->timestampNs = p->timestamp.tv_sec * 1000000000LL + p->timestamp.tv_usec * 1000LL;
+	r->flags = p->endOfStream ? RecordingPacket::END_OF_STREAM : 0;
+
+	int streamId = p->getStreamId();
+	Chunk &c = chunks[streamId];
+	if( !c.data.empty() ) {
+		const RecordingChunkHeader *h = (const RecordingChunkHeader *)&c.data[0];
+		if( h->channels != n || memcmp( h->typeBits(), &typeBits[0], 4 * words ) ) {
+			if( !finishChunk( c ) ) {
+				return false;
+			}
+		}
+	}
+	if( c.data.empty() ) {
+		startChunk( c, streamId, p, n );
+		RecordingChunkHeader *h = (RecordingChunkHeader *)&c.data[0];
+		h->firstSeqNr = r->seqNr;
+		h->firstNs = r->timestampNs;
+	}
+
+	c.data.insert( c.data.end(), record.begin(), record.end() );
+	RecordingChunkHeader *h = (RecordingChunkHeader *)&c.data[0];
+	h->packets++;
+	h->lastNs = r->timestampNs;
+	if( h->packets >= chunkPackets ) {
+		return finishChunk( c );
+	}
+	return true;
+}
+
+
+void RecordingWriter::startChunk( Chunk &c, int streamId, const DataPacket *p, uint32 n )
+{
+	uint32 typesSize = RecordingChunkHeader::typesSize( n );
+	uint32 recordSize = RecordingChunkHeader::recordSizeFor( n );
+	c.data.reserve( sizeof(RecordingChunkHeader) + typesSize + chunkPackets * recordSize );
+	c.data.assign( sizeof(RecordingChunkHeader) + typesSize, 0 );
+
+	RecordingChunkHeader *h = (RecordingChunkHeader *)&c.data[0];
+	memcpy( h->magic, "CRNC", 4 );
+	h->streamId = streamId;
+	h->channels = n;
+	h->recordSize = recordSize;
+	memcpy( (void *)h->typeBits(), &typeBits[0], 4 * ((n + 31) / 32) );
+}
+
+
+bool RecordingWriter::finishChunk( Chunk &c )
+{
+	if( c.data.empty() ) {
+		return true;
+	}
+	RecordingChunkHeader *h = (RecordingChunkHeader *)&c.data[0];
+	h->size = c.data.size();
+	h->sampleRate = sampleRate;
+	if( sampleRate <= 0 && h->packets > 1 && h->lastNs > h->firstNs ) {
+		h->sampleRate = (h->packets - 1) * 1e9 / (h->lastNs - h->firstNs);
+	}
+	size_t size = c.data.size();
+
+	bool ok = true;
+	if( segmentBytes > sizeof(RecordingFileHeader) && segmentBytes + size > segmentSize ) {
+		ok = writeBuffer() && openSegment();
+	}
+	if( ok && buffer.size() + size > DEFAULT_BUFFER_SIZE ) {
+		ok = writeBuffer();
+	}
+	if( ok ) {
+		if( size >= DEFAULT_BUFFER_SIZE ) {
+			ok = writeAll( &c.data[0], size );
+		}
+		else {
+			buffer.insert( buffer.end(), c.data.begin(), c.data.end() );
+		}
+		segmentBytes += size;
+	}
+	c.data.clear();
+	return ok;
+}
+
+
+bool RecordingWriter::flush()
+{
+	if( fd < 0 ) {
+		return false;
+	}
+	bool ok = true;
+	for( map<int, Chunk>::iterator it = chunks.begin(); it != chunks.end(); it++ ) {
+		ok = finishChunk( it->second ) && ok;
+	}
+	return writeBuffer() && ok;
+}
+
+
+void RecordingWriter::close()
+{
+	if( fd < 0 ) {
+		return;
+	}
+	flush();
+	::close( fd );
+	fd = -1;
+	chunks.clear();
+}
+
+
+bool RecordingWriter::writeBuffer()
+{
+	if( buffer.empty() ) {
+		return true;
+	}
+	bool ok = writeAll( &buffer[0], buffer.size() );
+	buffer.clear();
+	return ok;
+}
+
+
+bool RecordingWriter::writeAll( const unsigned char *b, size_t len )
+{
+	while( len > 0 ) {
+		ssize_t r = ::write( fd, b, len );
+		if( r < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			log( "ERROR: writing recording " ) << baseName << ": " << strerror( errno ) << endl;
+			return false;
+		}
+		b += r;
+		len -= r;
+		bytesWritten += r;
+	}
+	return true;
+}
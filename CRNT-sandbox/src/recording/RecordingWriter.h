@@ -0,0 +1,113 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// RecordingWriter.h - appends packets to a recording
+
+#ifndef RECORDINGWRITER_H
+#define RECORDINGWRITER_H
+
+#include "Recording.h"
+#include "../core/TBObject.h"
+#include "../core/DataPacket.h"
+#include <map>
+#include <string>
+#include <vector>
+
+
+/**
+ * \ingroup recording
+ * \brief Writes data packets to a recording (see Recording.h).
+ *
+ * Packets are collected in one chunk per stream. A chunk is complete when
+ * it holds \a chunkPackets packets or the channel layout of the stream
+ * changes. Complete chunks are copied to a write buffer that is written
+ * with one write() call when it is full, so the file is written in large
+ * sequential blocks. A new segment is started before a chunk would make
+ * the current one larger than \a segmentSize.
+ *
+ * The class is not thread safe.
+ */
+class RecordingWriter : public TBObject
+{
+	public:
+		static const unsigned int DEFAULT_SEGMENT_SIZE = 256 * 1024 * 1024;
+		static const unsigned int DEFAULT_CHUNK_PACKETS = 256;
+		static const unsigned int DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+		/// \param baseName Name of the recording, the segments are named baseName.NNNN.crec.
+		RecordingWriter( const std::string &baseName );
+		virtual ~RecordingWriter();
+
+		/// Create the first segment, returns false on error.
+		bool open();
+
+		/// Add a packet. Returns false on a write error.
+		bool append( const DataPacket *p );
+
+		/// Complete all chunks and write them to the file.
+		bool flush();
+
+		/// Flush and close the current segment.
+		void close();
+
+		bool isOpen() const { return fd >= 0; }
+
+		/// Maximal bytes per segment file.
+		void setSegmentSize( unsigned long long bytes ) { segmentSize = bytes; }
+
+		/// Packets per chunk.
+		void setChunkPackets( unsigned int n ) { chunkPackets = n > 0 ? n : 1; }
+
+		/// Sample rate written to the chunks, 0 estimates it from the time stamps.
+		void setSampleRate( float hz ) { sampleRate = hz; }
+
+		/// Get the name of segment file \p segment of recording \p baseName.
+		static std::string segmentName( const std::string &baseName, unsigned int segment );
+
+		/// Bytes written to all segments.
+		unsigned long long getBytesWritten() const { return bytesWritten; }
+
+	private:
+		/// A chunk being filled.
+		struct Chunk {
+			std::vector<unsigned char> data;	///< Header, type bits and the records.
+		};
+
+		std::string baseName;
+		unsigned long long segmentSize;
+		unsigned int chunkPackets;
+		float sampleRate;
+
+		int fd;
+		unsigned int segment;
+		unsigned long long segmentBytes;	///< Bytes in the current segment (incl. the buffer).
+		unsigned long long bytesWritten;
+		std::vector<unsigned char> buffer;
+		std::map<int, Chunk> chunks;
+		std::vector<unsigned char> record;	///< The packet being added.
+		std::vector<uint32> typeBits;
+
+		RecordingWriter( const RecordingWriter & );
+		RecordingWriter& operator=( const RecordingWriter & );
+
+		void startChunk( Chunk &c, int streamId, const DataPacket *p, uint32 n );
+		bool finishChunk( Chunk &c );
+		bool openSegment();
+		bool writeBuffer();
+		bool writeAll( const unsigned char *b, size_t len );
+};
+
+
+#endif	//RECORDINGWRITER_H
@@ -0,0 +1,208 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Replay.cpp
+
+#include "Replay.h"
+#include "../core/Clock.h"
+
+using namespace std;
+
+
+/// Packets per OutPort::sendBatch() call.
+static const unsigned int BATCH_SIZE = 64;
+
+
+Replay::Replay( const string &fileName ) :
+	StreamTask( 0, 1 ),
+	reader(fileName),
+	nextEntry(0),
+	rate(1),
+	seekNs(0),
+	seekPending(false),
+	rateChanged(false),
+	replayed(0),
+	finished(false)
+{
+	setId( "replay" );
+	if( reader.open() ) {
+		index.build( reader );
+		log( "recording " ) << fileName << ": " << reader.packetCount() << " packets in "
+			<< index.size() << " chunks" << endl;
+	}
+	applySeek( index.startNs() );
+}
+
+
+Replay::~Replay()
+{
+}
+
+
+void Replay::setRate( double r )
+{
+	mutex.lock();
+	rate = r > 0 ? r : 0;
+	rateChanged = true;
+	condition.signal();
+	mutex.unlock();
+}
+
+
+void Replay::seek( long long ns )
+{
+	mutex.lock();
+	seekNs = ns;
+	seekPending = true;
+	__atomic_store_n( &finished, false, __ATOMIC_RELEASE );
+	condition.signal();
+	mutex.unlock();
+}
+
+
+void Replay::cancelAllBlockingCalls()
+{
+	mutex.lock();
+	condition.cancel();
+	mutex.unlock();
+}
+
+
+/**
+ * Restart the merge at the chunks the index gives for \p ns. Packets
+ * before \p ns are skipped when the chunks are added.
+ */
+void Replay::applySeek( long long ns )
+{
+	while( !cursors.empty() ) {
+		cursors.pop();
+	}
+	seekNs = ns;
+	nextEntry = index.seek( ns );
+}
+
+
+/// Add the chunks that start before the earliest packet of the current ones.
+void Replay::addCursors()
+{
+	while( nextEntry < index.size()
+		&& (cursors.empty() || index.entry( nextEntry ).firstNs <= cursors.top().ns) ) {
+		const RecordingChunkHeader *c = index.entry( nextEntry ).chunk;
+		Cursor cur;
+		cur.entry = nextEntry++;
+		cur.k = c->firstNs < seekNs ? RecordingIndex::findPacket( c, seekNs ) : 0;
+		if( cur.k < c->packets ) {
+			cur.ns = c->packet( cur.k )->timestampNs;
+			cursors.push( cur );
+		}
+	}
+}
+
+
+void Replay::run()
+{
+	vector<DataPacket *> batch;
+	long long mediaStart = 0;			///< Recorded time of the pacing reference.
+	unsigned long long wallStart = 0;	///< Monotonic time of the pacing reference.
+	bool paced = false;
+
+	try {
+		while( running ) {
+			mutex.lock();
+			if( seekPending ) {
+				applySeek( seekNs );
+				seekPending = false;
+				paced = false;
+			}
+			if( rateChanged ) {
+				rateChanged = false;
+				paced = false;
+			}
+			double r = rate;
+			mutex.unlock();
+
+			addCursors();
+			if( cursors.empty() ) {
+				//end of the recording, wait for a seek()
+				outPorts[0]->sendBatch( batch );
+				mutex.lock();
+				if( !seekPending ) {
+					log( "end of recording, packets sent: " ) << getReplayed() << endl;
+					__atomic_store_n( &finished, true, __ATOMIC_RELEASE );
+				}
+				try {
+					while( !seekPending ) {
+						condition.wait( &mutex );
+					}
+				}
+				catch( char const* msg ) {
+					mutex.unlock();
+					throw msg;
+				}
+				mutex.unlock();
+				continue;
+			}
+			Cursor cur = cursors.top();
+
+			if( r > 0 ) {
+				if( !paced ) {
+					mediaStart = cur.ns;
+					wallStart = Clock::nowNs();
+					paced = true;
+				}
+				unsigned long long due = wallStart + (unsigned long long)((cur.ns - mediaStart) / r);
+				if( due > Clock::nowNs() ) {
+					if( !batch.empty() ) {
+						outPorts[0]->sendBatch( batch );
+						continue;
+					}
+					struct timespec ts;
+					Clock::toTimespec( due, &ts );
+					mutex.lock();
+					try {
+						if( !seekPending && !rateChanged ) {
+							condition.wait( &mutex, &ts );
+						}
+					}
+					catch( char const* msg ) {
+						mutex.unlock();
+						throw msg;
+					}
+					mutex.unlock();
+					continue;
+				}
+			}
+
+			cursors.pop();
+			const RecordingChunkHeader *c = index.entry( cur.entry ).chunk;
+			batch.push_back( RecordingReader::createPacket( c, cur.k ) );
+			if( ++cur.k < c->packets ) {
+				cur.ns = c->packet( cur.k )->timestampNs;
+				cursors.push( cur );
+			}
+			__atomic_add_fetch( &replayed, 1, __ATOMIC_RELAXED );
+
+			if( batch.size() >= BATCH_SIZE ) {
+				outPorts[0]->sendBatch( batch );
+			}
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop() or while a lossless in-port was full
+		for( unsigned int i = 0; i < batch.size(); i++ ) {
+			delete batch[i];
+		}
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Replay.h - stream task playing back a recording
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "RecordingIndex.h"
+#include "../core/StreamTask.h"
+#include "../core/Mutex.h"
+#include "../core/Condition.h"
+#include <queue>
+
+
+/**
+ * \ingroup recording
+ * \brief Sends the packets of a recording to its out-port.
+ *
+ * The packets of all streams are sent in the order of their time stamps,
+ * which keep the recorded values. Playback starts at the beginning of the
+ * recording or at the time given to seek(); seeks use the RecordingIndex
+ * and also work while the task is running.
+ *
+ * The rate multiplier sets the speed relative to the recorded time
+ * (1 = real time, 10 = ten times faster). With rate 0 the packets are
+ * sent as fast as possible in batches; the speed is then limited by the
+ * receivers only. Connect such a replay to lossless in-ports
+ * (InPort::setLossless()), which block the replay while their queue is
+ * full, otherwise packets are dropped.
+ */
+class Replay : public StreamTask
+{
+	public:
+		/// \param fileName Base name of the recording, see RecordingWriter.
+		Replay( const std::string &fileName );
+		virtual ~Replay();
+
+		/// Set the rate multiplier, 0 sends as fast as possible.
+		void setRate( double rate );
+
+		/// Continue playback at the first packets at or after \p ns (wall clock, ns since the epoch).
+		void seek( long long ns );
+
+		/// Time stamp of the first packet of the recording, see seek().
+		long long getStartNs() const { return index.startNs(); }
+
+		/// Time stamp of the last packet of the recording.
+		long long getEndNs() const { return index.endNs(); }
+
+		/// Number of packets sent.
+		unsigned long long getReplayed() const { return __atomic_load_n( &replayed, __ATOMIC_RELAXED ); }
+
+		/// Check if the end of the recording was reached (the task then waits for a seek()).
+		bool isFinished() const { return __atomic_load_n( &finished, __ATOMIC_ACQUIRE ); }
+
+	protected:
+		virtual void run();
+		virtual void cancelAllBlockingCalls();
+
+	private:
+		/// The next packet of a chunk.
+		struct Cursor {
+			long long ns;
+			unsigned int entry;		///< Position in the index (orders equal times).
+			uint32 k;
+		};
+
+		/// Puts the earliest cursor on top of the heap.
+		struct Later {
+			bool operator()( const Cursor &a, const Cursor &b ) const
+			{
+				return a.ns > b.ns || (a.ns == b.ns && a.entry > b.entry);
+			}
+		};
+
+		RecordingReader reader;
+		RecordingIndex index;
+		std::priority_queue<Cursor, std::vector<Cursor>, Later> cursors;
+		unsigned int nextEntry;		///< Next index entry to add to the cursors.
+
+		Mutex mutex;
+		Condition condition;		///< Waits for the time of the next packet.
+		double rate;
+		long long seekNs;
+		bool seekPending;
+		bool rateChanged;
+
+		unsigned long long replayed;
+		bool finished;
+
+		void applySeek( long long ns );
+		void addCursors();
+};
+
+
+#endif	//REPLAY_H
@@ -0,0 +1,75 @@
+################################################################################
+# sources.mk - toolbox sources for the stand-alone programs in bench/ and tests/
+#
+# Include it from a makefile one directory below src/. It builds the
+# toolbox into $(CRNT_BUILD)/libcrnt.a. SerialDevice.cpp is left out, it
+# needs stropts.h, which current C libraries no longer ship.
+################################################################################
+
+CRNT_SRC ?= ..
+CRNT_BUILD ?= build
+CXXFLAGS ?= -O2 -g -Wall
+CRNT_LIBS = -lpthread -lrt
+
+CRNT_SRCS = \
+	core/AsyncLog.cpp \
+	core/ChannelBuffer.cpp \
+	core/ChannelMath.cpp \
+	core/ChannelValue.cpp \
+	core/ClientSocket.cpp \
+	core/Clock.cpp \
+	core/Condition.cpp \
+	core/DataInterface.cpp \
+	core/DataPacket.cpp \
+	core/FixedMath.cpp \
+	core/FloatValue.cpp \
+	core/HistoryRing.cpp \
+	core/InPort.cpp \
+	core/IntValue.cpp \
+	core/MetricsReporter.cpp \
+	core/Mutex.cpp \
+	core/OutPort.cpp \
+	core/PacketPool.cpp \
+	core/SharedBuffer.cpp \
+	core/Socket.cpp \
+	core/SocketReactor.cpp \
+	core/SpscInPort.cpp \
+	core/StreamTask.cpp \
+	core/TBObject.cpp \
+	core/TaskScheduler.cpp \
+	core/Thread.cpp \
+	core/Timer.cpp \
+	core/Value.cpp \
+	core/WaitSet.cpp \
+	core/WindowView.cpp \
+	encoders/BinaryDecoder.cpp \
+	encoders/BinaryEncoder.cpp \
+	encoders/DeltaDecoder.cpp \
+	encoders/DeltaEncoder.cpp \
+	filters/SlidingWindow.cpp \
+	filters/StreamSynchronizer.cpp \
+	filters/WindowStatistics.cpp \
+	recording/Recorder.cpp \
+	recording/Recording.cpp \
+	recording/RecordingIndex.cpp \
+	recording/RecordingReader.cpp \
+	recording/RecordingWriter.cpp \
+	recording/Replay.cpp \
+	transport/BroadcastServer.cpp \
+	transport/ShmReader.cpp \
+	transport/ShmRing.cpp \
+	transport/ShmWriter.cpp \
+	transport/UdpReader.cpp \
+	transport/UdpWriter.cpp
+
+CRNT_OBJS = $(CRNT_SRCS:%.cpp=$(CRNT_BUILD)/%.o)
+CRNT_LIB = $(CRNT_BUILD)/libcrnt.a
+
+$(CRNT_BUILD)/%.o: $(CRNT_SRC)/%.cpp
+	@mkdir -p $(dir $@)
+	$(CXX) $(CXXFLAGS) -MMD -MP -c -o $@ $<
+
+$(CRNT_LIB): $(CRNT_OBJS)
+	$(AR) rcs $@ $^
+
+-include $(CRNT_OBJS:.o=.d)
@@ -0,0 +1,145 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BroadcastServerTest.cpp - broadcast to loopback clients, one of them slow
+//
+// 20 clients decode the stream and check that they got every packet in
+// order. One more client never reads and must be disconnected once it
+// exceeds the client limit. A packet the encoder cannot encode must be
+// skipped without affecting the following ones.
+
+#include "../transport/BroadcastServer.h"
+#include "../encoders/BinaryEncoder.h"
+#include "../encoders/BinaryDecoder.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+
+using namespace std;
+
+
+static const unsigned int CLIENTS = 20;
+static const unsigned int PACKETS = 100000;
+static const unsigned int CHANNELS = 8;
+
+
+/// State of a reading client.
+struct Client {
+	int fd;
+	BinaryDecoder decoder;
+	vector<unsigned char> pending;
+	unsigned long long bytes;
+	unsigned long long nextSeqNr;
+	unsigned long long outOfOrder;
+};
+
+
+/// Read and decode what is available on \p c.
+static void readClient( Client &c )
+{
+	unsigned char buf[65536];
+	ssize_t n;
+	while( (n = recv( c.fd, buf, sizeof( buf ), MSG_DONTWAIT )) > 0 ) {
+		c.bytes += n;
+		c.pending.insert( c.pending.end(), buf, buf + n );
+		vector<DataPacket *> packets;
+		int used = c.decoder.decodeAll( &c.pending[0], c.pending.size(), packets );
+		if( used > 0 ) {
+			c.pending.erase( c.pending.begin(), c.pending.begin() + used );
+		}
+		for( unsigned int i = 0; i < packets.size(); i++ ) {
+			if( packets[i]->seqNr != c.nextSeqNr ) {
+				c.outOfOrder++;
+			}
+			c.nextSeqNr = packets[i]->seqNr + 1;
+			delete packets[i];
+		}
+	}
+}
+
+
+int main()
+{
+	BinaryEncoder encoder;
+	BroadcastServer server( 0, encoder, 2 );
+	server.setClientLimit( 256 << 10 );
+	OutPort out;
+	out.connect( server.getInPorts()[0] );
+
+	vector<Client *> clients;
+	for( unsigned int i = 0; i < CLIENTS; i++ ) {
+		Client *c = new Client();
+		c->fd = connectLoopback( server.getPort() );
+		int size = 65536;
+		setsockopt( c->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof( size ) );
+		c->bytes = c->nextSeqNr = c->outOfOrder = 0;
+		clients.push_back( c );
+	}
+	int slow = connectLoopback( server.getPort() );
+	int size = 65536;
+	setsockopt( slow, SOL_SOCKET, SO_RCVBUF, &size, sizeof( size ) );
+
+	server.start();
+	server.getInPorts()[0]->setLossless( true );
+	usleep( 100000 );
+	check( server.getClientCount() == CLIENTS + 1, "all clients connected" );
+
+	//not encodable, skipped
+	out.send( new DataPacket( 3, BinaryEncoder::MAX_CHANNELS + 1, ChannelBuffer::FLOAT ) );
+
+	unsigned long long expected = BinaryEncoder::HEADER_SIZE + (unsigned long long)PACKETS * BinaryEncoder::packetSize( CHANNELS );
+	unsigned long long start = Clock::nowNs();
+	unsigned int sent = 0;
+	bool done = false;
+	while( !done && Clock::nowNs() - start < 20000000000ULL ) {
+		for( unsigned int k = 0; k < 200 && sent < PACKETS; k++ ) {
+			DataPacket *p = new DataPacket( 3, CHANNELS, ChannelBuffer::FLOAT );
+			p->seqNr = sent++;
+			out.send( p );
+		}
+		done = sent == PACKETS;
+		for( unsigned int i = 0; i < clients.size(); i++ ) {
+			readClient( *clients[i] );
+			done = done && clients[i]->bytes >= expected;
+		}
+	}
+
+	unsigned int complete = 0;
+	unsigned long long outOfOrder = 0;
+	for( unsigned int i = 0; i < clients.size(); i++ ) {
+		if( clients[i]->bytes == expected && clients[i]->nextSeqNr == PACKETS ) {
+			complete++;
+		}
+		outOfOrder += clients[i]->outOfOrder;
+	}
+	printf( "%u of %u clients complete, encoded %llu, dropped %llu, disconnected %llu in %.0f ms\n",
+		complete, CLIENTS, server.getEncoded(), server.getDropped(), server.getDisconnected(),
+		(Clock::nowNs() - start) / 1e6 );
+	check( complete == CLIENTS, "all clients got every packet" );
+	check( outOfOrder == 0, "packets in order" );
+	check( server.getEncoded() == PACKETS, "unencodable packet skipped" );
+	check( server.getDisconnected() == 1, "slow client disconnected" );
+	check( server.getClientCount() == CLIENTS, "client count" );
+
+	server.stop();
+	close( slow );
+	for( unsigned int i = 0; i < clients.size(); i++ ) {
+		close( clients[i]->fd );
+		delete clients[i];
+	}
+
+	return result( "BroadcastServerTest" );
+}
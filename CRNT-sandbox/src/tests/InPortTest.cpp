@@ -0,0 +1,253 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// InPortTest.cpp - lossless batches into small queues
+//
+// sendBatch() of more packets than fit into a lossless in-port must
+// complete for every kind of receiver: a thread, a WaitSet and a
+// scheduled task. A sender blocked on a full queue must return with
+// "condition canceled" when the receiver stops. A scheduled SpscInPort
+// must not become lossless.
+
+#include "../core/StreamTask.h"
+#include "../core/SpscInPort.h"
+#include "../core/TaskScheduler.h"
+#include "../core/WaitSet.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+
+static const unsigned int QUEUE = 10;
+static const unsigned int BATCH = 100;
+static const unsigned int BATCHES = 50;
+
+
+/// Counts the packets in order, in one of three receive modes.
+class CountingSink : public StreamTask
+{
+	public:
+		enum Mode { THREAD, WAITSET, SCHEDULED };
+
+		CountingSink( Mode mode ) : StreamTask( 1, 0 ), outOfOrder(0), mode(mode), received(0)
+		{
+			scheduled = mode == SCHEDULED;
+			inPortLossless = true;
+			inPortBufferSize = QUEUE;
+			if( mode == WAITSET ) {
+				waitSet.addInPort( inPorts[0] );
+			}
+		}
+
+		unsigned long long getReceived() { return __atomic_load_n( &received, __ATOMIC_ACQUIRE ); }
+		unsigned long long outOfOrder;
+
+	protected:
+		virtual void run()
+		{
+			try {
+				while( running ) {
+					if( mode == WAITSET ) {
+						waitSet.wait();
+					}
+					take( 0 );
+				}
+			}
+			catch( char const* msg ) {
+				//canceled by stop()
+			}
+		}
+
+		virtual void process()
+		{
+			while( inPorts[0]->notEmpty() ) {
+				take( 1 );
+			}
+		}
+
+	private:
+		Mode mode;
+		WaitSet waitSet;
+		unsigned long long received;
+
+		void take( long timeout )
+		{
+			vector<DataPacket *> packets;
+			inPorts[0]->receiveBatch( packets, 3, timeout );
+			for( unsigned int i = 0; i < packets.size(); i++ ) {
+				if( packets[i]->seqNr != received ) {
+					outOfOrder++;
+				}
+				__atomic_store_n( &received, received + 1, __ATOMIC_RELEASE );
+				delete packets[i];
+			}
+		}
+};
+
+
+/// Sends BATCHES batches of BATCH packets from its own thread.
+struct Sender {
+	OutPort *out;
+	bool done;
+	bool canceled;
+};
+
+
+static void *sendBatches( void *arg )
+{
+	Sender *s = (Sender *)arg;
+	unsigned long long seqNr = 0;
+	vector<DataPacket *> batch;
+	try {
+		for( unsigned int k = 0; k < BATCHES; k++ ) {
+			for( unsigned int i = 0; i < BATCH; i++ ) {
+				DataPacket *p = new DataPacket( 1, 1, ChannelBuffer::FLOAT );
+				p->seqNr = seqNr++;
+				batch.push_back( p );
+			}
+			s->out->sendBatch( batch );
+		}
+	}
+	catch( char const* msg ) {
+		s->canceled = true;
+	}
+	for( unsigned int i = 0; i < batch.size(); i++ ) {
+		delete batch[i];
+	}
+	__atomic_store_n( &s->done, true, __ATOMIC_RELEASE );
+	return NULL;
+}
+
+
+/// Wait up to \p timeoutMs for the sender to return.
+static bool waitDone( Sender &s, long timeoutMs )
+{
+	unsigned long long end = Clock::nowNs() + timeoutMs * 1000000ULL;
+	while( !__atomic_load_n( &s.done, __ATOMIC_ACQUIRE ) && Clock::nowNs() < end ) {
+		usleep( 1000 );
+	}
+	return __atomic_load_n( &s.done, __ATOMIC_ACQUIRE );
+}
+
+
+static void run( CountingSink::Mode mode, const char *name )
+{
+	CountingSink sink( mode );
+	OutPort out;
+	out.connect( sink.getInPorts()[0] );
+	sink.start();
+
+	Sender s = { &out, false, false };
+	pthread_t t;
+	pthread_create( &t, NULL, sendBatches, &s );
+	bool done = waitDone( s, 10000 );
+	//the last packets may still be queued
+	for( int i = 0; i < 1000 && sink.getReceived() < BATCH * BATCHES; i++ ) {
+		usleep( 1000 );
+	}
+	string what = string( name ) + ": lossless batches larger than the queue";
+	if( !done || sink.getReceived() != BATCH * BATCHES ) {
+		cout << "\t" << name << ": received " << sink.getReceived() << ", out of order " << sink.outOfOrder << endl;
+	}
+	check( done && !s.canceled && sink.getReceived() == BATCH * BATCHES && sink.outOfOrder == 0, what.c_str() );
+	sink.stop();
+	if( !done ) {
+		//a scheduled sink does not cancel its in-ports on stop()
+		sink.getInPorts()[0]->cancel_receive();
+	}
+	pthread_join( t, NULL );
+}
+
+
+/// Receiver that does not read: the sender blocks until stop().
+class StuckSink : public StreamTask
+{
+	public:
+		StuckSink() : StreamTask( 1, 0 )
+		{
+			inPortLossless = true;
+			inPortBufferSize = QUEUE;
+		}
+
+	protected:
+		virtual void run()
+		{
+			try {
+				while( running ) {
+					usleep( 1000 );
+				}
+			}
+			catch( char const* msg ) {
+			}
+		}
+};
+
+
+static void runCancel()
+{
+	StuckSink sink;
+	OutPort out;
+	out.connect( sink.getInPorts()[0] );
+	sink.start();
+
+	Sender s = { &out, false, false };
+	pthread_t t;
+	pthread_create( &t, NULL, sendBatches, &s );
+	usleep( 100000 );
+	bool blocked = !__atomic_load_n( &s.done, __ATOMIC_ACQUIRE );
+	sink.stop();
+	bool done = waitDone( s, 2000 );
+	check( blocked && done && s.canceled, "cancel: blocked sender returns on stop()" );
+	if( done ) {
+		pthread_join( t, NULL );
+	}
+}
+
+
+/// A scheduled SpscInPort stays lossy: it drops instead of blocking the sender.
+static void runSpscScheduled()
+{
+	SpscInPort port;
+	port.setSilent( true );
+	port.setMaxQueueSize( QUEUE );
+	port.setScheduler( TaskScheduler::getInstance() );
+	port.setLossless( true );
+	for( unsigned int i = 0; i < 2 * QUEUE; i++ ) {
+		port.enqueue( new DataPacket( 1, 1, ChannelBuffer::FLOAT ) );
+	}
+	InPortStats s = port.getStats();
+	check( s.enqueued == QUEUE && s.dropped == QUEUE, "spsc: lossless rejected on a scheduled port" );
+	port.setScheduler( NULL );
+	vector<DataPacket *> packets;
+	port.receiveBatch( packets, 2 * QUEUE, 1 );
+	for( unsigned int i = 0; i < packets.size(); i++ ) {
+		delete packets[i];
+	}
+}
+
+
+int main()
+{
+	run( CountingSink::THREAD, "thread" );
+	run( CountingSink::WAITSET, "waitset" );
+	run( CountingSink::SCHEDULED, "scheduled" );
+	runCancel();
+	runSpscScheduled();
+	return result( "InPortTest" );
+}
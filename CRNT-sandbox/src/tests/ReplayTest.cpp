@@ -0,0 +1,185 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ReplayTest.cpp - replay of a recording into lossless sinks
+//
+// A recording of two streams is replayed as fast as possible (rate 0,
+// batches of 64 packets) into a scheduled sink with a 10-packet lossless
+// queue, which must receive every packet in time order. A replay blocked
+// on a full in-port must return when the receiver stops.
+
+#include "../recording/RecordingWriter.h"
+#include "../recording/Replay.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+
+
+static const unsigned int PACKETS = 5000;
+static const unsigned int QUEUE = 10;
+
+
+/// Write PACKETS packets of two streams, 1 ms apart.
+static bool writeRecording( const string &base )
+{
+	RecordingWriter w( base );
+	if( !w.open() ) {
+		return false;
+	}
+	struct timeval tv;
+	Clock::toTimeval( Clock::nowNs(), &tv );
+	for( unsigned int i = 0; i < PACKETS; i++ ) {
+		DataPacket p( 1 + i % 2 );
+		p.seqNr = i;
+		p.setTimestamp( tv, false );
+		p.channels.appendFloat( i * 0.5f );
+		if( !w.append( &p ) ) {
+			return false;
+		}
+		tv.tv_usec += 1000;
+		if( tv.tv_usec >= 1000000 ) {
+			tv.tv_usec -= 1000000;
+			tv.tv_sec++;
+		}
+	}
+	bool ok = w.flush();
+	w.close();
+	return ok;
+}
+
+
+/// Scheduled sink that checks the order of the replayed packets.
+class OrderSink : public StreamTask
+{
+	public:
+		OrderSink() : StreamTask( 1, 0 ), outOfOrder(0), received(0)
+		{
+			scheduled = true;
+			inPortLossless = true;
+			inPortBufferSize = QUEUE;
+		}
+
+		unsigned long long getReceived() { return __atomic_load_n( &received, __ATOMIC_ACQUIRE ); }
+		unsigned long long outOfOrder;
+
+	protected:
+		virtual void run() {}
+
+		virtual void process()
+		{
+			vector<DataPacket *> packets;
+			while( inPorts[0]->notEmpty() ) {
+				inPorts[0]->receiveBatch( packets, 4, 1 );
+				for( unsigned int i = 0; i < packets.size(); i++ ) {
+					if( packets[i]->seqNr != received ) {
+						outOfOrder++;
+					}
+					__atomic_store_n( &received, received + 1, __ATOMIC_RELEASE );
+					delete packets[i];
+				}
+				packets.clear();
+			}
+		}
+
+	private:
+		unsigned long long received;
+};
+
+
+/// Thread sink that never reads: the replay blocks until stop().
+class StuckSink : public StreamTask
+{
+	public:
+		StuckSink() : StreamTask( 1, 0 )
+		{
+			inPortLossless = true;
+			inPortBufferSize = QUEUE;
+		}
+
+	protected:
+		virtual void run()
+		{
+			while( running ) {
+				usleep( 1000 );
+			}
+		}
+};
+
+
+static void testScheduled( const string &base )
+{
+	Replay replay( base );
+	replay.setRate( 0 );
+	OrderSink sink;
+	replay.getOutPorts()[0]->connect( sink.getInPorts()[0] );
+	sink.start();
+	replay.start();
+
+	for( int i = 0; i < 10000 && (!replay.isFinished() || sink.getReceived() < PACKETS); i++ ) {
+		usleep( 1000 );
+	}
+	if( sink.getReceived() != PACKETS ) {
+		cout << "\treplayed " << replay.getReplayed() << ", received " << sink.getReceived() << endl;
+	}
+	check( replay.isFinished() && sink.getReceived() == PACKETS && sink.outOfOrder == 0,
+		"scheduled: every packet in order" );
+	if( !replay.isFinished() ) {
+		//a scheduled sink does not cancel its in-ports on stop()
+		sink.getInPorts()[0]->cancel_receive();
+	}
+	replay.stop();
+	sink.stop();
+}
+
+
+static void testCancel( const string &base )
+{
+	Replay replay( base );
+	replay.setRate( 0 );
+	StuckSink sink;
+	replay.getOutPorts()[0]->connect( sink.getInPorts()[0] );
+	sink.start();
+	replay.start();
+
+	usleep( 100000 );
+	bool blocked = !replay.isFinished() && replay.getReplayed() < PACKETS;
+	sink.stop();
+	unsigned long long end = Clock::nowNs() + 2000000000ULL;
+	while( !replay.isStopped() && !replay.isFinished() && Clock::nowNs() < end ) {
+		usleep( 1000 );
+	}
+	check( blocked && replay.isStopped(), "cancel: blocked replay returns when the sink stops" );
+	replay.stop();
+}
+
+
+int main()
+{
+	ostringstream base;
+	base << "/tmp/crnt_replaytest_" << getpid();
+	bool written = writeRecording( base.str() );
+	check( written, "recording written" );
+	if( written ) {
+		testScheduled( base.str() );
+		testCancel( base.str() );
+	}
+	unlink( RecordingWriter::segmentName( base.str(), 0 ).c_str() );
+	return result( "ReplayTest" );
+}
@@ -0,0 +1,190 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmRingTest.cpp - three writer processes and one reader on a ShmRing
+//
+// Each writer process sends packets with 0 to 39 channels of both types
+// and with invalid channels. The reader checks the channels and the order
+// per stream. The lossless run must deliver every packet; in the lossy
+// run the reader is slow and must receive exactly what the writers wrote.
+
+#include "../transport/ShmWriter.h"
+#include "../transport/ShmReader.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+
+static const char *RING = "crnt_shmringtest";
+static const unsigned int PACKETS = 300000;
+static const unsigned int WRITERS = 3;
+
+
+/// Packet \p i of a writer: \p i % 40 channels with known values.
+static DataPacket *createPacket( int stream, unsigned int i )
+{
+	DataPacket *p = new DataPacket( stream );
+	p->seqNr = i;
+	p->timestampNs = Clock::nowNs();
+	for( unsigned int c = 0; c < i % 40; c++ ) {
+		if( c % 3 == 0 ) {
+			p->channels.appendInt( (int)(i * 7 + c), c % 5 != 1 );
+		}
+		else {
+			p->channels.appendFloat( i * 0.5f + c, c % 5 != 1 );
+		}
+	}
+	p->endOfStream = i == PACKETS - 1;
+	return p;
+}
+
+
+/// Check the channels of \p p against createPacket().
+static bool isIntact( DataPacket *p )
+{
+	unsigned int i = p->seqNr;
+	const ChannelBuffer &cb = p->channels;
+	if( cb.size() != i % 40 ) {
+		return false;
+	}
+	for( unsigned int c = 0; c < cb.size(); c++ ) {
+		bool valid = c % 5 != 1;
+		if( cb.isValid( c ) != valid ) {
+			return false;
+		}
+		if( !valid ) {
+			continue;
+		}
+		if( c % 3 == 0 ? cb.getType( c ) != ChannelBuffer::INT || cb.getInt( c ) != (int)(i * 7 + c)
+				: cb.getType( c ) != ChannelBuffer::FLOAT || cb.getFloat( c ) != i * 0.5f + c ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/// Writer process: send all packets, report the written ones to \p fd.
+static void writer( int stream, bool lossless, int fd )
+{
+	ShmWriter w( RING, 1 << 16 );
+	w.setLossless( lossless );
+	OutPort out;
+	out.connect( w.getInPorts()[0] );
+	w.start();
+	//start() resets the in-port mode
+	w.getInPorts()[0]->setLossless( true );
+	for( unsigned int i = 0; i < PACKETS; i++ ) {
+		out.send( createPacket( stream, i ) );
+	}
+	while( w.getInPorts()[0]->notEmpty() ) {
+		usleep( 1000 );
+	}
+	usleep( 200000 );
+	w.stop();
+	unsigned long long written = w.getWritten();
+	if( write( fd, &written, sizeof( written ) ) != sizeof( written ) ) {
+		perror( "write" );
+	}
+}
+
+
+static void run( bool lossless )
+{
+	printf( "%s run\n", lossless ? "lossless" : "lossy" );
+	shm_unlink( (string( "/" ) + RING).c_str() );
+	ShmReader reader( RING, 1 << 16 );
+	InPort in;
+	reader.getOutPorts()[0]->connect( &in );
+	in.setLossless( true );
+	reader.start();
+
+	int fds[2];
+	if( pipe( fds ) != 0 ) {
+		perror( "pipe" );
+		failures++;
+		return;
+	}
+	for( unsigned int k = 0; k < WRITERS; k++ ) {
+		if( fork() == 0 ) {
+			writer( k, lossless, fds[1] );
+			_exit( 0 );
+		}
+	}
+	close( fds[1] );
+
+	vector<unsigned long long> next( WRITERS, 0 );
+	unsigned long long received = 0, broken = 0, gaps = 0;
+	unsigned int ends = 0, exited = 0;
+	unsigned long long start = Clock::nowNs();
+	for( ;; ) {
+		vector<DataPacket *> packets;
+		in.receiveBatch( packets, 64, 100 );
+		for( unsigned int j = 0; j < packets.size(); j++ ) {
+			DataPacket *p = packets[j];
+			unsigned int s = p->getStreamId();
+			received++;
+			if( !lossless && received % 200 == 0 ) {
+				usleep( 1000 );
+			}
+			if( s >= WRITERS || p->seqNr < next[s] || !isIntact( p ) ) {
+				broken++;
+			}
+			else {
+				gaps += p->seqNr - next[s];
+				next[s] = p->seqNr + 1;
+			}
+			if( p->endOfStream ) {
+				ends++;
+			}
+			delete p;
+		}
+		while( exited < WRITERS && waitpid( -1, NULL, WNOHANG ) > 0 ) {
+			exited++;
+		}
+		//the writers are gone and the ring is drained
+		if( (exited == WRITERS && packets.empty()) || Clock::nowNs() - start > 60000000000ULL ) {
+			break;
+		}
+	}
+
+	unsigned long long written = 0, w;
+	while( read( fds[0], &w, sizeof( w ) ) == sizeof( w ) ) {
+		written += w;
+	}
+	close( fds[0] );
+	printf( "written %llu, received %llu, gaps %llu, broken %llu in %.0f ms\n",
+		written, received, gaps, broken, (Clock::nowNs() - start) / 1e6 );
+	check( broken == 0, "packets intact and in order" );
+	check( received == written && reader.getReceived() == written, "received what was written" );
+	if( lossless ) {
+		check( written == WRITERS * PACKETS && gaps == 0 && ends == WRITERS, "lossless: no packet lost" );
+	}
+	reader.stop();
+}
+
+
+int main()
+{
+	setvbuf( stdout, NULL, _IONBF, 0 );
+	run( true );
+	run( false );
+	return result( "ShmRingTest" );
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SocketReactorTest.cpp - echo server with 600 loopback clients
+//
+// Every client sends 100 messages of 100 bytes and reads the echo. Then
+// half of the clients disconnect and the reactor is stopped; the test
+// checks that every connection was reported closed exactly once.
+
+#include "../core/SocketReactor.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+
+using namespace std;
+
+
+static const unsigned int CLIENTS = 600;
+static const unsigned int ROUNDS = 100;
+static const unsigned int MESSAGE = 100;
+
+
+class Echo : public SocketReactor::Handler
+{
+	public:
+		int closed;
+
+		Echo() : closed(0) {}
+
+		void onData( SocketReactor::Connection *c )
+		{
+			c->send( c->data(), c->size() );
+			c->consume( c->size() );
+		}
+
+		void onClose( SocketReactor::Connection *c )
+		{
+			__sync_add_and_fetch( &closed, 1 );
+		}
+};
+
+
+/// Wait up to \p timeoutMs for \p value to reach \p expected.
+static bool waitFor( int *value, int expected, long timeoutMs )
+{
+	unsigned long long end = Clock::nowNs() + timeoutMs * 1000000ULL;
+	while( __atomic_load_n( value, __ATOMIC_SEQ_CST ) != expected && Clock::nowNs() < end ) {
+		usleep( 10000 );
+	}
+	return __atomic_load_n( value, __ATOMIC_SEQ_CST ) == expected;
+}
+
+
+int main()
+{
+	raiseFileLimit();
+
+	Echo echo;
+	SocketReactor reactor( 2 );
+	int port = reactor.listen( 0, &echo );
+	check( port > 0, "listen" );
+	reactor.start();
+
+	vector<int> fds;
+	for( unsigned int i = 0; i < CLIENTS; i++ ) {
+		int fd = connectLoopback( port );
+		if( fd < 0 ) {
+			perror( "connect" );
+			break;
+		}
+		fds.push_back( fd );
+	}
+	check( fds.size() == CLIENTS, "all clients connected" );
+
+	unsigned long long start = Clock::nowNs();
+	unsigned int echoed = 0;
+	char msg[MESSAGE], buf[MESSAGE];
+	for( unsigned int round = 0; round < ROUNDS; round++ ) {
+		for( unsigned int i = 0; i < fds.size(); i++ ) {
+			memset( msg, 'a' + (i + round) % 26, MESSAGE );
+			if( write( fds[i], msg, MESSAGE ) != (ssize_t)MESSAGE ) {
+				perror( "write" );
+			}
+		}
+		for( unsigned int i = 0; i < fds.size(); i++ ) {
+			unsigned int got = 0;
+			while( got < MESSAGE ) {
+				ssize_t n = read( fds[i], buf + got, MESSAGE - got );
+				if( n <= 0 ) {
+					break;
+				}
+				got += n;
+			}
+			if( got == MESSAGE && buf[0] == (char)('a' + (i + round) % 26) && buf[MESSAGE - 1] == buf[0] ) {
+				echoed++;
+			}
+		}
+	}
+	printf( "%u connections, %u of %u messages echoed in %.1f ms\n",
+		reactor.getConnectionCount(), echoed, CLIENTS * ROUNDS, (Clock::nowNs() - start) / 1e6 );
+	check( reactor.getConnectionCount() == CLIENTS, "connection count" );
+	check( echoed == CLIENTS * ROUNDS, "all messages echoed" );
+
+	for( unsigned int i = 0; i < fds.size() / 2; i++ ) {
+		close( fds[i] );
+	}
+	check( waitFor( &echo.closed, fds.size() / 2, 2000 ), "closed by the peer" );
+	check( reactor.getConnectionCount() == fds.size() - fds.size() / 2, "connection count after close" );
+
+	reactor.stop();
+	check( echo.closed == (int)fds.size(), "closed by stop()" );
+	check( reactor.getConnectionCount() == 0, "no connections after stop()" );
+	for( unsigned int i = fds.size() / 2; i < fds.size(); i++ ) {
+		close( fds[i] );
+	}
+
+	return result( "SocketReactorTest" );
+}
@@ -0,0 +1,212 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// SocketTest.cpp - buffered reads and writes of Socket over loopback
+//
+// Reads lines of many lengths through a small read buffer (readLine()
+// then crosses refills), mixes in readBuf(), and checks the write buffer:
+// coalescing, writes larger than the buffer, the latency bound with
+// flushIfDue(), and the write timeout against a peer that does not read.
+
+#include "../core/Socket.h"
+#include "../core/SocketException.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+#include <string>
+#include <poll.h>
+#include <pthread.h>
+
+using namespace std;
+
+
+static const unsigned int LINES = 1000;
+static const unsigned int RECORDS = 20000;
+static const unsigned int RECORD = 37;
+
+
+/// Line \p i: \p i % 300 characters, no separator.
+static string line( unsigned int i )
+{
+	string s( i % 300, 'a' + i % 26 );
+	for( unsigned int k = 0; k < s.size(); k += 7 ) {
+		s[k] = '0' + k % 10;
+	}
+	return s;
+}
+
+
+/// Connected pair of sockets: \p client and the accepted \p peer.
+static bool connectPair( Socket &server, Socket &client, Socket &peer )
+{
+	return server.create() && server.bind( 0 ) && server.listen()
+		&& client.create() && client.connect( "127.0.0.1", server.getPortNumber() )
+		&& server.accept( peer );
+}
+
+
+/// Bytes received by the reader thread.
+struct Sink {
+	int fd;
+	vector<unsigned char> data;
+	unsigned long long expected;
+};
+
+
+static void *readAll( void *arg )
+{
+	Sink *s = (Sink *)arg;
+	unsigned char buf[65536];
+	while( s->data.size() < s->expected ) {
+		ssize_t n = recv( s->fd, buf, sizeof( buf ), 0 );
+		if( n <= 0 ) {
+			break;
+		}
+		s->data.insert( s->data.end(), buf, buf + n );
+	}
+	return NULL;
+}
+
+
+static void testRead()
+{
+	Socket server, client, peer;
+	check( connectPair( server, client, peer ), "read: connected" );
+	client.setReadBufferSize( 64 );
+
+	string text;
+	for( unsigned int i = 0; i < LINES; i++ ) {
+		text += line( i ) + "\n";
+	}
+	text += "0123456789abcdef;tail";
+	unsigned char binary[10000];
+	for( unsigned int i = 0; i < sizeof( binary ); i++ ) {
+		binary[i] = i * 13;
+	}
+	peer.send( (const unsigned char *)text.data(), text.size() );
+	peer.send( binary, sizeof( binary ) );
+
+	unsigned int good = 0;
+	unsigned char buf[512];
+	for( unsigned int i = 0; i < LINES; i++ ) {
+		int n = client.readLine( buf, sizeof( buf ), '\n', i % 2 == 1 );
+		string expected = line( i ) + (i % 2 == 1 ? "\n" : "");
+		if( n == (int)expected.size() && expected == (const char *)buf ) {
+			good++;
+		}
+	}
+	check( good == LINES, "read: lines across buffer refills" );
+
+	//longer than the buffer of the caller: split
+	int n1 = client.readLine( buf, 11, ';' );
+	string first( (const char *)buf, n1 );
+	int n2 = client.readLine( buf, sizeof( buf ), ';' );
+	string second( (const char *)buf, n2 );
+	check( first == "0123456789" && second == "abcdef", "read: line longer than the caller buffer" );
+
+	unsigned char tail[4];
+	client.readBuf( tail, 4 );
+	unsigned char got[sizeof( binary )];
+	int n = client.readBuf( got, sizeof( got ) );
+	check( memcmp( tail, "tail", 4 ) == 0 && n == (int)sizeof( got ) && memcmp( got, binary, sizeof( got ) ) == 0,
+		"read: readBuf() after readLine()" );
+}
+
+
+static void testWrite()
+{
+	Socket server, client, peer;
+	check( connectPair( server, client, peer ), "write: connected" );
+	client.setWriteBuffer( 4096, 1000 );
+
+	Sink sink;
+	sink.fd = peer.getFd();
+	sink.expected = RECORDS * RECORD + RECORDS / 5000 * 100000;
+	pthread_t reader;
+	pthread_create( &reader, NULL, readAll, &sink );
+
+	//small records and a few large ones, in order
+	vector<unsigned char> sent;
+	unsigned char record[RECORD];
+	vector<unsigned char> large( 100000 );
+	for( unsigned int i = 0; i < RECORDS; i++ ) {
+		for( unsigned int k = 0; k < RECORD; k++ ) {
+			record[k] = i + k;
+		}
+		client.write( record, RECORD );
+		sent.insert( sent.end(), record, record + RECORD );
+		if( i % 5000 == 4999 ) {
+			for( unsigned int k = 0; k < large.size(); k++ ) {
+				large[k] = i * k;
+			}
+			client.write( &large[0], large.size() );
+			sent.insert( sent.end(), large.begin(), large.end() );
+		}
+	}
+
+	client.flush();
+	pthread_join( reader, NULL );
+	check( sink.data == sent, "write: coalesced and large writes in order" );
+
+	//the latency bound: held back until due, then written by flushIfDue()
+	client.write( record, 10 );
+	struct pollfd pfd = { peer.getFd(), POLLIN, 0 };
+	bool held = poll( &pfd, 1, 0 ) == 0;
+	long remaining = client.flushIfDue();
+	usleep( 2000 );
+	long after = client.flushIfDue();
+	bool arrived = poll( &pfd, 1, 100 ) == 1;
+	check( held && remaining >= 0 && after == -1 && arrived, "write: latency bound with flushIfDue()" );
+}
+
+
+static void testTimeout()
+{
+	Socket server, client, peer;
+	check( connectPair( server, client, peer ), "timeout: connected" );
+	client.setWriteBuffer( 4096, 1000, 300 );
+
+	//the peer does not read
+	unsigned char buf[1000];
+	memset( buf, 0, sizeof( buf ) );
+	unsigned long long start = Clock::nowNs();
+	bool thrown = false;
+	try {
+		for( unsigned int i = 0; i < 1000000; i++ ) {
+			client.write( buf, sizeof( buf ) );
+		}
+	}
+	catch( SocketException &e ) {
+		thrown = true;
+	}
+	double ms = (Clock::nowNs() - start) / 1e6;
+	printf( "write timeout after %.0f ms\n", ms );
+	check( thrown && ms >= 250 && ms < 5000, "timeout: write gives up" );
+
+	client.write( buf, 100 );
+	start = Clock::nowNs();
+	client.close();
+	check( (Clock::nowNs() - start) / 1e6 < 100, "timeout: close() does not wait" );
+}
+
+
+int main()
+{
+	testRead();
+	testWrite();
+	testTimeout();
+	return result( "SocketTest" );
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// TestUtil.h - helpers of the test programs
+
+#ifndef TESTUTIL_H
+#define TESTUTIL_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+
+/// Number of failed checks of the test program.
+static int failures = 0;
+
+
+/**
+ * Report a check, e.g. <tt>check( got == sent, "all packets received" )</tt>.
+ */
+inline void check( bool ok, const char *what )
+{
+	printf( "%s: %s\n", ok ? "ok" : "FAILED", what );
+	if( !ok ) {
+		failures++;
+	}
+}
+
+
+/// Print the result and get the exit code of the test program.
+inline int result( const char *test )
+{
+	printf( "%s: %s\n", test, failures ? "FAILED" : "passed" );
+	return failures ? 1 : 0;
+}
+
+
+/// Connect a TCP socket to \p port on 127.0.0.1, -1 on an error.
+inline int connectLoopback( int port )
+{
+	int fd = socket( AF_INET, SOCK_STREAM, 0 );
+	struct sockaddr_in a;
+	memset( &a, 0, sizeof( a ) );
+	a.sin_family = AF_INET;
+	a.sin_port = htons( port );
+	a.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	if( fd >= 0 && connect( fd, (struct sockaddr *)&a, sizeof( a ) ) != 0 ) {
+		close( fd );
+		return -1;
+	}
+	return fd;
+}
+
+
+/// Raise the limit of open files to the hard limit (for many connections).
+inline void raiseFileLimit()
+{
+	struct rlimit rl;
+	if( getrlimit( RLIMIT_NOFILE, &rl ) == 0 && rl.rlim_cur < rl.rlim_max ) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit( RLIMIT_NOFILE, &rl );
+	}
+}
+
+
+#endif	//TESTUTIL_H
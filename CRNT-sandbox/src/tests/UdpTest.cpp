@@ -0,0 +1,237 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// UdpTest.cpp - UdpWriter to UdpReader over loopback
+//
+// Sends packets by unicast with a large and with a small receive buffer
+// (the reader is slow, so datagrams are lost and must be counted), and by
+// multicast. Then checks that a late packet only fills a gap of its own
+// stream, malformed and oversized datagrams and a writer whose
+// destination port is closed.
+
+#include "../transport/UdpWriter.h"
+#include "../transport/UdpReader.h"
+#include "../core/Clock.h"
+#include "TestUtil.h"
+
+#include <vector>
+
+using namespace std;
+
+
+static const unsigned int CHANNELS = 16;
+
+
+/// Counters of a run as seen by the test.
+struct Received {
+	unsigned long long packets;
+	unsigned long long broken;
+	unsigned long long lastSeqNr;
+};
+
+
+/// Take the packets out of \p in, sleeping 2 ms every \p slowEvery packets.
+static void drain( InPort &in, Received &r, unsigned int slowEvery, long timeout )
+{
+	vector<DataPacket *> packets;
+	in.receiveBatch( packets, 100000, timeout );
+	for( unsigned int i = 0; i < packets.size(); i++ ) {
+		DataPacket *p = packets[i];
+		r.packets++;
+		if( slowEvery && r.packets % slowEvery == 0 ) {
+			usleep( 2000 );
+		}
+		if( p->channels.size() != CHANNELS || p->channels.getFloat( 3 ) != p->seqNr + 0.75f ) {
+			r.broken++;
+		}
+		if( p->seqNr > r.lastSeqNr ) {
+			r.lastSeqNr = p->seqNr;
+		}
+		delete p;
+	}
+}
+
+
+/**
+ * Send \p count packets from a UdpWriter to \p host.
+ * \param group Multicast group of the reader, NULL for unicast.
+ */
+static void run( const char *host, const char *group, unsigned int count, int receiveBuffer, unsigned int slowEvery )
+{
+	string name = string( group ? "multicast" : "unicast" ) + (slowEvery ? ", slow reader" : "");
+	UdpReader reader( 0, group ? group : "", group ? "127.0.0.1" : "" );
+	reader.setReceiveBufferSize( receiveBuffer );
+	InPort in;
+	reader.getOutPorts()[0]->connect( &in );
+
+	UdpWriter writer( host, reader.getPort() );
+	if( group ) {
+		writer.setMulticastInterface( "127.0.0.1" );
+	}
+	writer.setSendBufferSize( 1 << 20 );
+	OutPort out;
+	out.connect( writer.getInPorts()[0] );
+
+	reader.start();
+	writer.start();
+	writer.getInPorts()[0]->setLossless( true );
+	writer.getInPorts()[0]->setMaxQueueSize( 1000 );
+
+	Received r = { 0, 0, 0 };
+	for( unsigned int i = 0; i < count; i++ ) {
+		DataPacket *p = new DataPacket( 5, CHANNELS, ChannelBuffer::FLOAT );
+		p->seqNr = i;
+		gettimeofday( &p->timestamp, NULL );
+		for( unsigned int c = 0; c < CHANNELS; c++ ) {
+			p->channels.setFloat( c, i + c * 0.25f );
+		}
+		out.send( p );
+		if( i % 256 == 0 ) {
+			drain( in, r, slowEvery, 0 );
+		}
+	}
+	unsigned long long end = Clock::nowNs() + 500000000ULL;
+	while( Clock::nowNs() < end ) {
+		drain( in, r, 0, 50 );
+	}
+	writer.stop();
+	reader.stop();
+
+	printf( "%s: sent %llu, received %llu, lost %llu, reordered %llu, broken %llu\n", name.c_str(),
+		writer.getSent(), reader.getReceived(), reader.getLost(), reader.getReordered(), r.broken );
+	if( group && r.packets == 0 ) {
+		printf( "%s: nothing received, multicast is not routed on this host, skipped\n", name.c_str() );
+		return;
+	}
+	check( writer.getSent() == count && writer.getDropped() == 0, (name + ": all sent").c_str() );
+	check( r.packets == reader.getReceived() && r.broken == 0, (name + ": packets intact").c_str() );
+	if( slowEvery ) {
+		check( reader.getReceived() < count, (name + ": datagrams lost").c_str() );
+		check( reader.getReceived() + reader.getLost() == r.lastSeqNr + 1, (name + ": losses counted").c_str() );
+	}
+	else {
+		check( reader.getReceived() == count && reader.getLost() == 0, (name + ": nothing lost").c_str() );
+	}
+}
+
+
+/// Packet \p seqNr of \p stream.
+static DataPacket *sequenced( int stream, unsigned long long seqNr )
+{
+	DataPacket *p = new DataPacket( stream, 1, ChannelBuffer::INT );
+	p->seqNr = seqNr;
+	return p;
+}
+
+
+/// A gap in stream 1 must not be filled by a late packet of stream 2.
+static void runReordered()
+{
+	UdpReader reader( 0 );
+	InPort in;
+	reader.getOutPorts()[0]->connect( &in );
+	reader.start();
+	UdpWriter writer( "127.0.0.1", reader.getPort() );
+	OutPort out;
+	out.connect( writer.getInPorts()[0] );
+	writer.start();
+
+	out.send( sequenced( 1, 0 ) );
+	out.send( sequenced( 1, 2 ) );
+	out.send( sequenced( 2, 0 ) );
+	out.send( sequenced( 2, 1 ) );
+	out.send( sequenced( 2, 1 ) );	//late, but stream 2 has no gap
+	usleep( 300000 );
+	check( reader.getReceived() == 5 && reader.getReordered() == 1 && reader.getLost() == 1,
+		"reordered: loss counted per stream" );
+	out.send( sequenced( 1, 1 ) );
+	usleep( 300000 );
+	check( reader.getReordered() == 2 && reader.getLost() == 0, "reordered: gap filled" );
+
+	writer.stop();
+	reader.stop();
+	vector<DataPacket *> packets;
+	in.receiveBatch( packets, 100, 0 );
+	for( unsigned int i = 0; i < packets.size(); i++ ) {
+		delete packets[i];
+	}
+}
+
+
+/// Oversized packets, foreign datagrams and a closed destination port.
+static void runErrors()
+{
+	UdpReader reader( 0 );
+	InPort in;
+	reader.getOutPorts()[0]->connect( &in );
+	reader.start();
+	UdpWriter writer( "127.0.0.1", reader.getPort() );
+	OutPort out;
+	out.connect( writer.getInPorts()[0] );
+	writer.start();
+
+	//does not fit into a datagram
+	out.send( new DataPacket( 1, 3000, ChannelBuffer::FLOAT ) );
+	out.send( new DataPacket( 1, 3, ChannelBuffer::INT ) );
+
+	int fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	struct sockaddr_in a;
+	memset( &a, 0, sizeof( a ) );
+	a.sin_family = AF_INET;
+	a.sin_port = htons( reader.getPort() );
+	a.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	sendto( fd, "hello", 5, 0, (struct sockaddr *)&a, sizeof( a ) );
+	close( fd );
+	usleep( 300000 );
+
+	//port 1 is closed: the ICMP errors make later sends fail
+	UdpWriter dead( "127.0.0.1", 1 );
+	OutPort deadOut;
+	deadOut.connect( dead.getInPorts()[0] );
+	dead.start();
+	for( int i = 0; i < 5; i++ ) {
+		deadOut.send( new DataPacket( 2, 1, ChannelBuffer::FLOAT ) );
+		usleep( 20000 );
+	}
+	usleep( 200000 );
+
+	printf( "errors: sent %llu, dropped %llu, received %llu, malformed %llu, closed port sent %llu, dropped %llu\n",
+		writer.getSent(), writer.getDropped(), reader.getReceived(), reader.getMalformed(),
+		dead.getSent(), dead.getDropped() );
+	check( writer.getSent() == 1 && writer.getDropped() == 1, "errors: oversized packet dropped" );
+	check( reader.getReceived() == 1 && reader.getMalformed() == 1, "errors: foreign datagram counted" );
+	check( dead.getSent() + dead.getDropped() == 5 && dead.getDropped() > 0, "errors: closed port counted" );
+
+	dead.stop();
+	writer.stop();
+	reader.stop();
+	vector<DataPacket *> packets;
+	in.receiveBatch( packets, 100, 0 );
+	for( unsigned int i = 0; i < packets.size(); i++ ) {
+		delete packets[i];
+	}
+}
+
+
+int main()
+{
+	setvbuf( stdout, NULL, _IONBF, 0 );
+	run( "127.0.0.1", NULL, 200000, 4 << 20, 0 );
+	run( "127.0.0.1", NULL, 200000, 64 << 10, 500 );
+	run( "239.1.2.3", "239.1.2.3", 100000, 4 << 20, 0 );
+	runReordered();
+	runErrors();
+	return result( "UdpTest" );
+}
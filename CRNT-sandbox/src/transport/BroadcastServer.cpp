@@ -0,0 +1,194 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BroadcastServer.cpp
+
+#include "BroadcastServer.h"
+#include <string.h>
+
+using namespace std;
+
+
+/// Largest encoded batch.
+static const unsigned int MAX_BATCH_BYTES = 16 << 20;
+
+
+SocketReactor::Handler *BroadcastServer::Clients::onAccept( SocketReactor::Connection *c )
+{
+	server->mutex.lock();
+	c->retain();
+	Client client = { c, false };
+	if( server->header ) {
+		c->send( server->header );
+		client.headerSent = true;
+	}
+	server->clients.push_back( client );
+	server->mutex.unlock();
+	return this;
+}
+
+
+void BroadcastServer::Clients::onClose( SocketReactor::Connection *c )
+{
+	server->mutex.lock();
+	for( unsigned int i = 0; i < server->clients.size(); i++ ) {
+		if( server->clients[i].connection == c ) {
+			server->clients.erase( server->clients.begin() + i );
+			break;
+		}
+	}
+	server->mutex.unlock();
+	c->release();
+}
+
+
+BroadcastServer::BroadcastServer( int port, const Encoder &encoder, unsigned int threads ) :
+	StreamTask( 1, 0 ),
+	encoder(encoder.clone()),
+	reactor(threads),
+	handler(this),
+	policy(DISCONNECT),
+	header(NULL),
+	bufferSize(65536),
+	encoded(0),
+	dropped(0),
+	disconnected(0)
+{
+	setId( "broadcastserver" );
+	this->port = reactor.listen( port, &handler );
+}
+
+
+BroadcastServer::~BroadcastServer()
+{
+	reactor.stop();
+	if( header ) {
+		header->release();
+	}
+	delete encoder;
+}
+
+
+void BroadcastServer::run()
+{
+	vector<DataPacket *> batch;
+	reactor.start();
+	try {
+		while( running ) {
+			batch.clear();
+			inPorts[0]->receiveBatch( batch, 64 );
+			SharedBuffer *buffer = encodeBatch( batch );
+			for( unsigned int i = 0; i < batch.size(); i++ ) {
+				delete batch[i];
+			}
+			if( buffer ) {
+				broadcast( buffer );
+				buffer->release();
+			}
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+	reactor.stop();
+}
+
+
+/**
+ * Encode \p batch into one buffer.
+ * @return The buffer or NULL if nothing was encoded.
+ */
+SharedBuffer *BroadcastServer::encodeBatch( const vector<DataPacket *> &batch )
+{
+	if( batch.empty() ) {
+		return NULL;
+	}
+	if( !header ) {
+		encoder->init( batch[0] );
+		SharedBuffer *h = SharedBuffer::create( 4096 );
+		int n = encoder->get_header( h->data(), h->getCapacity() );
+		h->setSize( n > 0 ? n : 0 );
+		mutex.lock();
+		header = h;
+		mutex.unlock();
+	}
+
+	SharedBuffer *b = SharedBuffer::create( bufferSize );
+	bool failed = false;
+	for( unsigned int i = 0; i < batch.size(); ) {
+		int n = encoder->encode( batch[i], b->data() + b->size(), b->getCapacity() - b->size() );
+		if( n > 0 ) {
+			b->setSize( b->size() + n );
+			encoded++;
+			i++;
+			continue;
+		}
+		//grow and retry only if the buffer was too small (encoders do not
+		//change their state then); without a size bound up to the limit
+		unsigned int need = encoder->getEncodedSizeBound( batch[i] );
+		unsigned int capacity = b->getCapacity() < MAX_BATCH_BYTES / 2 ? 2 * b->getCapacity() : MAX_BATCH_BYTES;
+		if( need > 0 && b->size() + need > capacity ) {
+			capacity = b->size() + need;
+		}
+		if( (need > 0 && need <= b->getCapacity() - b->size())
+				|| capacity > MAX_BATCH_BYTES || capacity <= b->getCapacity() ) {
+			log( "ERROR: cannot encode packet " ) << batch[i]->seqNr << " of stream " << batch[i]->getStreamId() << endl;
+			failed = true;
+			i++;
+			continue;
+		}
+		SharedBuffer *larger = SharedBuffer::create( capacity );
+		memcpy( larger->data(), b->data(), b->size() );
+		larger->setSize( b->size() );
+		b->release();
+		b = larger;
+	}
+	//keep a grown size for the next batches, unless it was grown in vain
+	if( !failed && b->getCapacity() > bufferSize ) {
+		bufferSize = b->getCapacity();
+	}
+	if( b->size() == 0 ) {
+		b->release();
+		return NULL;
+	}
+	return b;
+}
+
+
+/// Queue \p buffer for all clients.
+void BroadcastServer::broadcast( SharedBuffer *buffer )
+{
+	mutex.lock();
+	for( unsigned int i = 0; i < clients.size(); i++ ) {
+		Client &client = clients[i];
+		SocketReactor::Connection *c = client.connection;
+		if( !client.headerSent ) {
+			c->send( header );
+			client.headerSent = true;
+		}
+		if( c->send( buffer ) || c->isClosed() ) {
+			continue;
+		}
+		if( policy == DROP ) {
+			dropped++;
+		}
+		else {
+			log( "client does not keep up, disconnecting " ) << c->getFd() << endl;
+			c->abort();
+			disconnected++;
+		}
+	}
+	mutex.unlock();
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// BroadcastServer.h - TCP server sending a stream to many clients
+
+#ifndef BROADCASTSERVER_H
+#define BROADCASTSERVER_H
+
+#include "../core/StreamTask.h"
+#include "../core/SocketReactor.h"
+#include "../core/Encoder.h"
+#include <vector>
+
+
+/**
+ * \defgroup transport Transport
+ * \brief Tasks that move packets between processes or hosts.
+ */
+
+/**
+ * \ingroup transport
+ * \brief Sends its input to every client connected to a TCP port.
+ *
+ * Each batch of packets is encoded once into a SharedBuffer, which is
+ * queued for every client by reference (SocketReactor::Connection::send()).
+ * The encoding cost is thus independent of the number of clients; a client
+ * costs one queue entry and its share of the writes. The clients are
+ * served by a SocketReactor, so they need no threads of their own.
+ *
+ * A client that connects receives the header of the encoder first (once
+ * the first packet was encoded). Clients that do not keep up are handled
+ * according to the #SlowClientPolicy once their queued bytes would exceed
+ * the limit (setClientLimit()):
+ *
+ * - DROP: the batch is not sent to that client. Use a stateless encoder
+ *   (e.g. BinaryEncoder); a DeltaEncoder stream stays undecodable until
+ *   the next keyframe.
+ * - DISCONNECT: the connection is closed.
+ */
+class BroadcastServer : public StreamTask
+{
+	public:
+		/// What to do with a client whose queue is full.
+		enum SlowClientPolicy {
+			DROP,
+			DISCONNECT
+		};
+
+		/**
+		 * \param port TCP port, 0 for any free port (see getPort()).
+		 * \param encoder Encoder for the packets (cloned).
+		 * \param threads Threads serving the clients.
+		 */
+		BroadcastServer( int port, const Encoder &encoder, unsigned int threads = 1 );
+		virtual ~BroadcastServer();
+
+		/// The port the server listens on, -1 if listening failed.
+		int getPort() const { return port; }
+
+		/// Maximal bytes queued per client (default 4 MB).
+		void setClientLimit( unsigned int bytes ) { reactor.setBufferLimits( 65536, bytes ); }
+
+		void setSlowClientPolicy( SlowClientPolicy policy ) { this->policy = policy; }
+
+		unsigned int getClientCount() { return reactor.getConnectionCount(); }
+
+		unsigned long long getEncoded() const { return encoded; }		///< Packets encoded.
+		unsigned long long getDropped() const { return dropped; }		///< Batches not sent to a slow client.
+		unsigned long long getDisconnected() const { return disconnected; }	///< Slow clients disconnected.
+
+	protected:
+		virtual void run();
+
+	private:
+		class Clients : public SocketReactor::Handler {
+			public:
+				Clients( BroadcastServer *server ) : server(server) {}
+				virtual SocketReactor::Handler *onAccept( SocketReactor::Connection *c );
+				virtual void onClose( SocketReactor::Connection *c );
+				BroadcastServer *server;
+		};
+
+		struct Client {
+			SocketReactor::Connection *connection;
+			bool headerSent;
+		};
+
+		Encoder *encoder;
+		SocketReactor reactor;
+		Clients handler;
+		int port;
+		SlowClientPolicy policy;
+		Mutex mutex;
+		std::vector<Client> clients;
+		SharedBuffer *header;
+		unsigned int bufferSize;		///< Capacity for the next batch.
+		unsigned long long encoded;
+		unsigned long long dropped;
+		unsigned long long disconnected;
+
+		SharedBuffer *encodeBatch( const std::vector<DataPacket *> &batch );
+		void broadcast( SharedBuffer *buffer );
+};
+
+
+#endif	//BROADCASTSERVER_H
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmReader.cpp
+
+#include "ShmReader.h"
+
+using namespace std;
+
+
+ShmReader::ShmReader( const string &name, unsigned int capacity ) :
+	StreamTask( 0, 1 ),
+	received(0)
+{
+	setId( "shmreader" );
+	ring.open( name, capacity );
+}
+
+
+ShmReader::~ShmReader()
+{
+	ring.unlink();
+}
+
+
+void ShmReader::run()
+{
+	vector<DataPacket *> batch;
+	try {
+		while( running && ring.isOpen() ) {
+			DataPacket *p = ring.pop();
+			if( p ) {
+				batch.push_back( p );
+				__atomic_add_fetch( &received, 1, __ATOMIC_RELAXED );
+				if( batch.size() < 64 ) {
+					continue;
+				}
+			}
+			if( !batch.empty() ) {
+				outPorts[0]->sendBatch( batch );
+			}
+			if( !p ) {
+				ring.waitData( 100 );
+			}
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop() while a lossless in-port was full
+	}
+	for( unsigned int i = 0; i < batch.size(); i++ ) {
+		delete batch[i];
+	}
+}
+
+
+void ShmReader::cancelAllBlockingCalls()
+{
+	ring.wakeAll();
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmReader.h - stream task reading packets from a shared-memory ring
+
+#ifndef SHMREADER_H
+#define SHMREADER_H
+
+#include "ShmRing.h"
+#include "../core/StreamTask.h"
+
+
+/**
+ * \ingroup transport
+ * \brief Receives packets from ShmWriter tasks of other processes.
+ *
+ * The reader owns the ring: it creates it if the writers did not yet,
+ * sends the packets to its out-port in batches and removes the name of
+ * the ring when it is deleted. Only one reader per ring is allowed.
+ */
+class ShmReader : public StreamTask
+{
+	public:
+		/**
+		 * \param name Name of the ring, see ShmRing::open().
+		 * \param capacity Bytes of the ring if this reader creates it.
+		 */
+		ShmReader( const std::string &name, unsigned int capacity = 1 << 22 );
+		virtual ~ShmReader();
+
+		unsigned long long getReceived() const { return __atomic_load_n( &received, __ATOMIC_RELAXED ); }	///< Packets received.
+
+	protected:
+		virtual void run();
+		virtual void cancelAllBlockingCalls();
+
+	private:
+		ShmRing ring;
+		unsigned long long received;
+};
+
+
+#endif	//SHMREADER_H
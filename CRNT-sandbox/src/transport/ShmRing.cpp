@@ -0,0 +1,398 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmRing.cpp
+
+#include "ShmRing.h"
+#include "../core/Clock.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+using namespace std;
+
+
+static const uint32 VERSION = 1;
+static const uint32 HEADER_SIZE = 256;
+static const uint32 MIN_CAPACITY = 4096;
+
+
+/// Shared header, the positions and futex words on cache lines of their own.
+struct ShmRing::Header
+{
+	char magic[8];					///< "CRNTSHM"
+	uint32 version;
+	uint32 ready;					///< Set by the creator when initialized.
+	uint32 capacity;
+	uint32 headerSize;
+	char pad0[40];
+	unsigned long long reserve;		///< Absolute position of the next record (writers).
+	char pad1[56];
+	unsigned long long tail;		///< Absolute position of the oldest record (reader).
+	char pad2[56];
+	int dataSeq;					///< Futex, incremented when records are committed.
+	int readerWaiting;
+	int spaceSeq;					///< Futex, incremented when space is freed.
+	int writersWaiting;
+	char pad3[48];
+};
+
+
+/// Record in the ring, followed by the raw channels.
+struct ShmRing::Record
+{
+	enum { PACKET = 0, PAD = 1 };
+	enum { END_OF_STREAM = 1 };
+
+	unsigned long long commit;		///< Absolute position + 1 once the record is complete.
+	uint32 length;
+	uint32 type;
+	int streamId;
+	uint32 channels;
+	unsigned long long seqNr;
+	unsigned long long timestampNs;
+	long long wallNs;
+	uint32 flags;
+	uint32 reserved;
+
+	uint32 *values() { return (uint32 *)(this + 1); }
+
+	static uint32 sizeFor( uint32 channels )
+	{
+		return (sizeof(Record) + 4 * channels + 2 * 4 * ((channels + 31) / 32) + 15) & ~15u;
+	}
+};
+
+
+ShmRing::ShmRing() :
+	fd(-1),
+	header(NULL),
+	ring(NULL),
+	mapped(0),
+	fullTail(0)
+{
+}
+
+
+ShmRing::~ShmRing()
+{
+	close();
+}
+
+
+bool ShmRing::open( const string &name, unsigned int capacity )
+{
+	close();
+	this->name = name[0] == '/' ? name : "/" + name;
+
+	uint32 cap = MIN_CAPACITY;
+	while( cap < capacity && cap < (1u << 30) ) {
+		cap <<= 1;
+	}
+	bool created = true;
+	fd = shm_open( this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+	if( fd < 0 && errno == EEXIST ) {
+		created = false;
+		fd = shm_open( this->name.c_str(), O_RDWR, 0600 );
+	}
+	if( fd < 0 ) {
+		log( "ERROR: cannot open shared memory " ) << this->name << ": " << strerror( errno ) << endl;
+		return false;
+	}
+
+	struct stat st;
+	if( created ) {
+		if( ftruncate( fd, HEADER_SIZE + cap ) < 0 ) {
+			log( "ERROR: cannot size shared memory " ) << this->name << ": " << strerror( errno ) << endl;
+			close();
+			shm_unlink( this->name.c_str() );
+			return false;
+		}
+		mapped = HEADER_SIZE + cap;
+	}
+	else {
+		//the creator sizes and initializes the ring right after creating it
+		for( int i = 0; ; i++ ) {
+			if( fstat( fd, &st ) == 0 && st.st_size > (off_t)HEADER_SIZE ) {
+				break;
+			}
+			if( i == 1000 ) {
+				log( "ERROR: shared memory " ) << this->name << " is not initialized" << endl;
+				close();
+				return false;
+			}
+			usleep( 1000 );
+		}
+		mapped = st.st_size;
+	}
+
+	void *m = mmap( NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	if( m == MAP_FAILED ) {
+		log( "ERROR: cannot map shared memory " ) << this->name << ": " << strerror( errno ) << endl;
+		mapped = 0;
+		close();
+		return false;
+	}
+	header = (Header *)m;
+	ring = (unsigned char *)m + HEADER_SIZE;
+
+	if( created ) {
+		//ftruncate() zeroed the memory
+		memcpy( header->magic, "CRNTSHM", 8 );
+		header->version = VERSION;
+		header->capacity = cap;
+		header->headerSize = HEADER_SIZE;
+		__atomic_store_n( &header->ready, 1, __ATOMIC_RELEASE );
+		return true;
+	}
+
+	for( int i = 0; !__atomic_load_n( &header->ready, __ATOMIC_ACQUIRE ); i++ ) {
+		if( i == 1000 ) {
+			log( "ERROR: shared memory " ) << this->name << " is not initialized" << endl;
+			close();
+			return false;
+		}
+		usleep( 1000 );
+	}
+	if( memcmp( header->magic, "CRNTSHM", 8 ) || header->version != VERSION
+		|| header->headerSize != HEADER_SIZE || header->capacity + HEADER_SIZE != mapped
+		|| (header->capacity & (header->capacity - 1)) ) {
+		log( "ERROR: shared memory " ) << this->name << " is no packet ring" << endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+
+void ShmRing::close()
+{
+	if( header ) {
+		munmap( header, mapped );
+		header = NULL;
+		ring = NULL;
+		mapped = 0;
+	}
+	if( fd >= 0 ) {
+		::close( fd );
+		fd = -1;
+	}
+}
+
+
+void ShmRing::unlink()
+{
+	if( !name.empty() ) {
+		shm_unlink( name.c_str() );
+	}
+}
+
+
+unsigned int ShmRing::getCapacity() const
+{
+	return header ? header->capacity : 0;
+}
+
+
+bool ShmRing::push( const DataPacket *p )
+{
+	if( !header ) {
+		return false;
+	}
+	p->checkSerializable();
+	ChannelBuffer tmp;
+	const ChannelBuffer &cb = p->getTypedChannels( tmp );
+	uint32 n = cb.size();
+	uint32 size = Record::sizeFor( n );
+	uint32 cap = header->capacity;
+	if( size > cap / 2 ) {
+		log( "ERROR: packet of stream " ) << p->getStreamId() << " with " << n << " channels is too large for the ring" << endl;
+		return false;
+	}
+
+	//reserve space, records do not wrap around: the end of the ring is padded
+	unsigned long long pos, pad;
+	for( ;; ) {
+		pos = __atomic_load_n( &header->reserve, __ATOMIC_ACQUIRE );
+		unsigned long long tail = __atomic_load_n( &header->tail, __ATOMIC_ACQUIRE );
+		uint32 off = pos & (cap - 1);
+		pad = off + size > cap ? cap - off : 0;
+		if( pos + pad + size - tail > cap ) {
+			fullTail = tail;
+			return false;
+		}
+		if( __atomic_compare_exchange_n( &header->reserve, &pos, pos + pad + size, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+			break;
+		}
+	}
+	if( pad ) {
+		Record *r = (Record *)(ring + (pos & (cap - 1)));
+		r->length = pad;
+		r->type = Record::PAD;
+		__atomic_store_n( &r->commit, pos + 1, __ATOMIC_RELEASE );
+		pos += pad;
+	}
+
+	Record *r = (Record *)(ring + (pos & (cap - 1)));
+	r->length = size;
+	r->type = Record::PACKET;
+	r->streamId = p->getStreamId();
+	r->channels = n;
+	r->seqNr = p->seqNr;
+	r->timestampNs = p->timestampNs;
+	r->wallNs = p->timestamp.tv_sec * 1000000000LL + p->timestamp.tv_usec * 1000LL;
+	r->flags = p->endOfStream ? Record::END_OF_STREAM : 0;
+	r->reserved = 0;
+	if( n ) {
+		uint32 *values = r->values();
+		cb.getRaw( values, values + n, values + n + (n + 31) / 32 );
+	}
+	__atomic_store_n( &r->commit, pos + 1, __ATOMIC_RELEASE );
+
+	//pairs with the fence in waitData(): either the reader sees the record or we see it waiting
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	if( __atomic_load_n( &header->readerWaiting, __ATOMIC_RELAXED ) ) {
+		__atomic_add_fetch( &header->dataSeq, 1, __ATOMIC_RELEASE );
+		wake( &header->dataSeq, 1 );
+	}
+	return true;
+}
+
+
+DataPacket *ShmRing::pop()
+{
+	if( !header ) {
+		return NULL;
+	}
+	uint32 cap = header->capacity;
+	unsigned long long tail = __atomic_load_n( &header->tail, __ATOMIC_RELAXED );
+	DataPacket *p = NULL;
+	for( ;; ) {
+		Record *r = (Record *)(ring + (tail & (cap - 1)));
+		if( __atomic_load_n( &r->commit, __ATOMIC_ACQUIRE ) != tail + 1 ) {
+			return NULL;
+		}
+		uint32 length = r->length;
+		if( r->type == Record::PACKET ) {
+			p = new DataPacket( r->streamId );
+			p->seqNr = r->seqNr;
+			p->timestampNs = r->timestampNs;
+			p->timestamp.tv_sec = r->wallNs / 1000000000LL;
+			p->timestamp.tv_usec = r->wallNs % 1000000000LL / 1000;
+			p->endOfStream = r->flags & Record::END_OF_STREAM;
+			uint32 n = r->channels;
+			if( n ) {
+				const uint32 *values = r->values();
+				p->channels.setRaw( n, values, values + n, values + n + (n + 31) / 32 );
+			}
+		}
+		//records start 16 byte aligned: clear every word a later commit
+		//word may fall on, stale payload could equal its position + 1
+		for( uint32 k = 0; k < length; k += 16 ) {
+			*(unsigned long long *)((unsigned char *)r + k) = 0;
+		}
+		tail += length;
+		__atomic_store_n( &header->tail, tail, __ATOMIC_RELEASE );
+		if( p ) {
+			break;
+		}
+	}
+
+	//pairs with the fence in waitSpace()
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	if( __atomic_load_n( &header->writersWaiting, __ATOMIC_RELAXED ) ) {
+		__atomic_add_fetch( &header->spaceSeq, 1, __ATOMIC_RELEASE );
+		wake( &header->spaceSeq, INT_MAX );
+	}
+	return p;
+}
+
+
+/// Check if a record is committed at the read position.
+bool ShmRing::hasData()
+{
+	unsigned long long tail = __atomic_load_n( &header->tail, __ATOMIC_RELAXED );
+	Record *r = (Record *)(ring + (tail & (header->capacity - 1)));
+	return __atomic_load_n( &r->commit, __ATOMIC_ACQUIRE ) == tail + 1;
+}
+
+
+bool ShmRing::waitData( long timeoutMs )
+{
+	if( !header ) {
+		return false;
+	}
+	__atomic_store_n( &header->readerWaiting, 1, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	int seq = __atomic_load_n( &header->dataSeq, __ATOMIC_ACQUIRE );
+	if( !hasData() ) {
+		wait( &header->dataSeq, seq, timeoutMs );
+	}
+	__atomic_store_n( &header->readerWaiting, 0, __ATOMIC_RELAXED );
+	return hasData();
+}
+
+
+bool ShmRing::waitSpace( long timeoutMs )
+{
+	if( !header ) {
+		return false;
+	}
+	__atomic_add_fetch( &header->writersWaiting, 1, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	int seq = __atomic_load_n( &header->spaceSeq, __ATOMIC_ACQUIRE );
+	if( __atomic_load_n( &header->tail, __ATOMIC_ACQUIRE ) == fullTail ) {
+		wait( &header->spaceSeq, seq, timeoutMs );
+	}
+	__atomic_sub_fetch( &header->writersWaiting, 1, __ATOMIC_RELAXED );
+	return __atomic_load_n( &header->tail, __ATOMIC_ACQUIRE ) != fullTail;
+}
+
+
+void ShmRing::wakeAll()
+{
+	if( !header ) {
+		return;
+	}
+	__atomic_add_fetch( &header->dataSeq, 1, __ATOMIC_RELEASE );
+	wake( &header->dataSeq, INT_MAX );
+	__atomic_add_fetch( &header->spaceSeq, 1, __ATOMIC_RELEASE );
+	wake( &header->spaceSeq, INT_MAX );
+}
+
+
+/// Sleep while *word == value, at most \p timeoutMs milliseconds.
+void ShmRing::wait( int *word, int value, long timeoutMs )
+{
+	struct timespec ts;
+	ts.tv_sec = timeoutMs / 1000;
+	ts.tv_nsec = timeoutMs % 1000 * 1000000L;
+	//shared between processes: no FUTEX_PRIVATE_FLAG
+	syscall( SYS_futex, word, FUTEX_WAIT, value, &ts, NULL, 0 );
+}
+
+
+void ShmRing::wake( int *word, int count )
+{
+	syscall( SYS_futex, word, FUTEX_WAKE, count, NULL, NULL, 0 );
+}
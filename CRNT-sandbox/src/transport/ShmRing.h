@@ -0,0 +1,126 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmRing.h - packet ring in shared memory
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include "../core/DataPacket.h"
+#include <string>
+
+
+/**
+ * \ingroup transport
+ * \brief Ring of data packets in POSIX shared memory (MPSC).
+ *
+ * Connects processes on one host without encoding and without the
+ * kernel: a writer copies the channels of a packet into the ring
+ * (ChannelBuffer::getRaw()) and the reader copies them into a new packet
+ * (ChannelBuffer::setRaw()). Any number of processes may push, one pops.
+ *
+ * The segment <tt>/dev/shm/name</tt> holds a header followed by the ring
+ * of \a capacity bytes. Records are 16 byte aligned:
+ *
+ * \verbatim
+   u64 commit        absolute ring position + 1, written last
+   u32 length        bytes of the record (padding records fill the end of the ring)
+   u32 type          0 packet, 1 padding
+   i32 streamId  u32 channels  u64 seqNr  u64 timestampNs  i64 wallNs  u32 flags  u32 reserved
+   n x 32 bit        channel values (float or int32)
+   w x u32           type bits, then w x u32 valid bits (w = (n + 31) / 32)
+   \endverbatim
+ *
+ * Writers reserve space with a compare-and-swap on the write position and
+ * publish a record by writing its commit word, which contains its absolute
+ * position. The reader zeroes the first 8 bytes of every 16 byte unit of
+ * a consumed record before it frees the space by advancing the read
+ * position, so neither an old commit word nor stale payload can look
+ * committed. Waiting on either side uses
+ * futexes in the shared header (a wakeup is only sent if somebody waits).
+ *
+ * DataPacket::timestampNs is based on the monotonic clock and thus valid
+ * in all processes of the host; the wall clock time stamp is transferred
+ * as well. A writer that dies between reserving and committing a record
+ * stalls the ring, the reader then has to recreate it.
+ */
+class ShmRing : public TBObject
+{
+	public:
+		ShmRing();
+		virtual ~ShmRing();
+
+		/**
+		 * \brief Create the ring or attach to an existing one.
+		 * \param name Name of the shared memory object.
+		 * \param capacity Bytes of the ring if it is created (rounded up to
+		 * a power of two), an existing ring keeps its size.
+		 * \return \c false on an error.
+		 */
+		bool open( const std::string &name, unsigned int capacity );
+
+		/// Unmap the ring.
+		void close();
+
+		/// Remove the name of the ring (existing mappings stay valid).
+		void unlink();
+
+		bool isOpen() const { return header != NULL; }
+
+		/// Bytes of the ring.
+		unsigned int getCapacity() const;
+
+		/**
+		 * \brief Append \p p (not deleted).
+		 * \return \c false if the ring is full or the packet is too large.
+		 */
+		bool push( const DataPacket *p );
+
+		/// Take the oldest packet, NULL if the ring is empty.
+		DataPacket *pop();
+
+		/**
+		 * \brief Wait until pop() may return a packet.
+		 * \return \c false on timeout (or wakeAll()).
+		 */
+		bool waitData( long timeoutMs );
+
+		/**
+		 * \brief Wait until the reader freed space since the last push()
+		 * that failed (see waitData()).
+		 */
+		bool waitSpace( long timeoutMs );
+
+		/// Wake up all waiting threads, e.g. to stop them.
+		void wakeAll();
+
+	private:
+		struct Header;
+		struct Record;
+
+		std::string name;
+		int fd;
+		Header *header;
+		unsigned char *ring;
+		size_t mapped;
+		unsigned long long fullTail;	///< Read position seen by the last push() that failed.
+
+		bool hasData();
+		static void wait( int *word, int value, long timeoutMs );
+		static void wake( int *word, int count );
+};
+
+
+#endif	//SHMRING_H
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmWriter.cpp
+
+#include "ShmWriter.h"
+
+using namespace std;
+
+
+ShmWriter::ShmWriter( const string &name, unsigned int capacity ) :
+	StreamTask( 1, 0 ),
+	lossless(false),
+	written(0),
+	dropped(0)
+{
+	setId( "shmwriter" );
+	ring.open( name, capacity );
+}
+
+
+ShmWriter::~ShmWriter()
+{
+}
+
+
+void ShmWriter::run()
+{
+	vector<DataPacket *> batch;
+	try {
+		while( running ) {
+			batch.clear();
+			inPorts[0]->receiveBatch( batch, 64 );
+			for( unsigned int i = 0; i < batch.size(); i++ ) {
+				bool ok = ring.push( batch[i] );
+				while( !ok && lossless && running && ring.isOpen() ) {
+					ring.waitSpace( 100 );
+					ok = ring.push( batch[i] );
+				}
+				if( ok ) {
+					__atomic_add_fetch( &written, 1, __ATOMIC_RELAXED );
+				}
+				else {
+					__atomic_add_fetch( &dropped, 1, __ATOMIC_RELAXED );
+				}
+				delete batch[i];
+			}
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+}
+
+
+void ShmWriter::cancelAllBlockingCalls()
+{
+	ring.wakeAll();
+}
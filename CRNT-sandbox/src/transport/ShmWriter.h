@@ -0,0 +1,62 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// ShmWriter.h - stream task writing its input to a shared-memory ring
+
+#ifndef SHMWRITER_H
+#define SHMWRITER_H
+
+#include "ShmRing.h"
+#include "../core/StreamTask.h"
+
+
+/**
+ * \ingroup transport
+ * \brief Sends its input to another process on the same host through a ShmRing.
+ *
+ * The packets are copied into the ring and deleted; a ShmReader in the
+ * other process creates them anew. Several writers (in one or more
+ * processes) may share a ring. If the ring is full, packets are dropped
+ * unless the writer is lossless, then it waits for the reader.
+ */
+class ShmWriter : public StreamTask
+{
+	public:
+		/**
+		 * \param name Name of the ring, see ShmRing::open().
+		 * \param capacity Bytes of the ring if this writer creates it.
+		 */
+		ShmWriter( const std::string &name, unsigned int capacity = 1 << 22 );
+		virtual ~ShmWriter();
+
+		/// Wait for space instead of dropping packets if the ring is full.
+		void setLossless( bool lossless ) { this->lossless = lossless; }
+
+		unsigned long long getWritten() const { return __atomic_load_n( &written, __ATOMIC_RELAXED ); }	///< Packets written.
+		unsigned long long getDropped() const { return __atomic_load_n( &dropped, __ATOMIC_RELAXED ); }	///< Packets dropped.
+
+	protected:
+		virtual void run();
+		virtual void cancelAllBlockingCalls();
+
+	private:
+		ShmRing ring;
+		bool lossless;
+		unsigned long long written;
+		unsigned long long dropped;
+};
+
+
+#endif	//SHMWRITER_H
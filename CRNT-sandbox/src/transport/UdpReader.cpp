@@ -0,0 +1,192 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// UdpReader.cpp
+
+#include "UdpReader.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+using namespace std;
+
+
+/// Datagrams per recvmmsg() call.
+static const unsigned int BATCH_SIZE = 64;
+
+/// A sequence number this far behind the expected one starts the stream anew.
+static const unsigned long long RESTART_DISTANCE = 1 << 16;
+
+
+UdpReader::UdpReader( int port, const string &group, const string &interface ) :
+	StreamTask( 0, 1 ),
+	fd(-1),
+	port(-1),
+	maxDatagram(8192),
+	received(0),
+	lost(0),
+	reordered(0),
+	malformed(0)
+{
+	setId( "udpreader" );
+	fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	if( fd < 0 ) {
+		log( "ERROR: cannot create socket: " ) << strerror( errno ) << endl;
+		return;
+	}
+	if( !group.empty() ) {
+		//several receivers of the group on this host
+		int on = 1;
+		setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on) );
+	}
+
+	struct sockaddr_in a;
+	memset( &a, 0, sizeof(a) );
+	a.sin_family = AF_INET;
+	a.sin_addr.s_addr = htonl( INADDR_ANY );
+	a.sin_port = htons( port );
+	socklen_t len = sizeof(a);
+	if( bind( fd, (struct sockaddr *)&a, sizeof(a) ) < 0 || getsockname( fd, (struct sockaddr *)&a, &len ) < 0 ) {
+		log( "ERROR: cannot bind to port " ) << port << ": " << strerror( errno ) << endl;
+		close( fd );
+		fd = -1;
+		return;
+	}
+	this->port = ntohs( a.sin_port );
+
+	if( !group.empty() ) {
+		struct ip_mreq m;
+		m.imr_interface.s_addr = htonl( INADDR_ANY );
+		if( inet_pton( AF_INET, group.c_str(), &m.imr_multiaddr ) != 1
+			|| (!interface.empty() && inet_pton( AF_INET, interface.c_str(), &m.imr_interface ) != 1)
+			|| setsockopt( fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof(m) ) < 0 ) {
+			log( "ERROR: cannot join multicast group " ) << group << ": " << strerror( errno ) << endl;
+		}
+	}
+}
+
+
+UdpReader::~UdpReader()
+{
+	if( fd >= 0 ) {
+		close( fd );
+	}
+}
+
+
+void UdpReader::setReceiveBufferSize( int bytes )
+{
+	if( fd >= 0 && setsockopt( fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes) ) < 0 ) {
+		log( "ERROR: cannot set receive buffer size: " ) << strerror( errno ) << endl;
+	}
+}
+
+
+void UdpReader::run()
+{
+	if( fd < 0 ) {
+		return;
+	}
+	unsigned int size = maxDatagram;
+	vector<unsigned char> buffer( BATCH_SIZE * size );
+	struct mmsghdr msgs[BATCH_SIZE];
+	struct iovec iov[BATCH_SIZE];
+	for( unsigned int i = 0; i < BATCH_SIZE; i++ ) {
+		iov[i].iov_base = &buffer[i * size];
+		iov[i].iov_len = size;
+		memset( &msgs[i], 0, sizeof(msgs[i]) );
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	vector<DataPacket *> batch;
+	try {
+		while( running ) {
+			int k = recvmmsg( fd, msgs, BATCH_SIZE, MSG_DONTWAIT, NULL );
+			if( k <= 0 ) {
+				if( k < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) {
+					log( "ERROR: receiving failed: " ) << strerror( errno ) << endl;
+					break;
+				}
+				//wake up regularly to see stop()
+				poll( &pfd, 1, 100 );
+				continue;
+			}
+			for( int i = 0; i < k; i++ ) {
+				unsigned int len = msgs[i].msg_len;
+				DataPacket *p = NULL;
+				if( !(msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ) {
+					//every datagram starts with the stream header
+					decoder.reset();
+					if( decoder.decode( &buffer[i * size], len, &p ) != (int)len ) {
+						delete p;
+						p = NULL;
+					}
+				}
+				if( !p ) {
+					__atomic_add_fetch( &malformed, 1, __ATOMIC_RELAXED );
+					continue;
+				}
+				account( p );
+				batch.push_back( p );
+			}
+			__atomic_add_fetch( &received, batch.size(), __ATOMIC_RELAXED );
+			outPorts[0]->sendBatch( batch );
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop() while a lossless in-port was full
+	}
+	for( unsigned int i = 0; i < batch.size(); i++ ) {
+		delete batch[i];
+	}
+}
+
+
+/// Update the loss counters with the sequence number of \p p.
+void UdpReader::account( const DataPacket *p )
+{
+	map<int, StreamSeq>::iterator it = streams.find( p->getStreamId() );
+	if( it == streams.end() ) {
+		StreamSeq &s = streams[p->getStreamId()];
+		s.expected = p->seqNr + 1;
+		s.lost = 0;
+		return;
+	}
+	StreamSeq &s = it->second;
+	if( p->seqNr >= s.expected ) {
+		s.lost += p->seqNr - s.expected;
+		__atomic_add_fetch( &lost, p->seqNr - s.expected, __ATOMIC_RELAXED );
+		s.expected = p->seqNr + 1;
+	}
+	else if( s.expected - p->seqNr > RESTART_DISTANCE ) {
+		s.expected = p->seqNr + 1;
+	}
+	else {
+		__atomic_add_fetch( &reordered, 1, __ATOMIC_RELAXED );
+		//only a gap of this stream is filled
+		if( s.lost > 0 ) {
+			s.lost--;
+			__atomic_sub_fetch( &lost, 1, __ATOMIC_RELAXED );
+		}
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// UdpReader.h - stream task receiving packets from UDP datagrams
+
+#ifndef UDPREADER_H
+#define UDPREADER_H
+
+#include "../core/StreamTask.h"
+#include "../encoders/BinaryDecoder.h"
+#include <map>
+#include <string>
+
+
+/**
+ * \ingroup transport
+ * \brief Receives the datagrams of UdpWriter tasks.
+ *
+ * Up to 64 datagrams are taken from the socket with one recvmmsg() call,
+ * decoded and sent to the out-port as a batch. Datagrams that are
+ * truncated or not in the BinaryEncoder format are counted as malformed.
+ *
+ * Losses are counted per stream from the sequence numbers: a gap counts
+ * as lost packets, a packet older than the expected one as reordered (it
+ * is passed on and fills a gap of its stream, if there is one). A sequence number far
+ * behind the expected one is taken as a restarted sender. Streams must
+ * therefore not be sent by more than one writer.
+ */
+class UdpReader : public StreamTask
+{
+	public:
+		/**
+		 * \param port UDP port to receive on, 0 for any free port (see getPort()).
+		 * \param group IPv4 address of a multicast group to join (optional).
+		 * \param interface IPv4 address of the interface to join the group on,
+		 * default is the one chosen by the kernel.
+		 */
+		UdpReader( int port, const std::string &group = "", const std::string &interface = "" );
+		virtual ~UdpReader();
+
+		/// The port the reader receives on, -1 if the socket could not be bound.
+		int getPort() const { return port; }
+
+		/// Set SO_RCVBUF of the socket.
+		void setReceiveBufferSize( int bytes );
+
+		/// Largest datagram received, longer ones are truncated (default 8192, set before start()).
+		void setMaxDatagramSize( unsigned int bytes ) { maxDatagram = bytes; }
+
+		unsigned long long getReceived() const { return __atomic_load_n( &received, __ATOMIC_RELAXED ); }	///< Packets received.
+		unsigned long long getLost() const { return __atomic_load_n( &lost, __ATOMIC_RELAXED ); }			///< Packets missing in the sequences of all streams.
+		unsigned long long getReordered() const { return __atomic_load_n( &reordered, __ATOMIC_RELAXED ); }	///< Packets received late.
+		unsigned long long getMalformed() const { return __atomic_load_n( &malformed, __ATOMIC_RELAXED ); }	///< Datagrams not decoded.
+
+	protected:
+		virtual void run();
+
+	private:
+		int fd;
+		int port;
+		unsigned int maxDatagram;
+		BinaryDecoder decoder;
+		/// Sequence state of a stream.
+		struct StreamSeq {
+			unsigned long long expected;	///< Next sequence number.
+			unsigned long long lost;		///< Gaps not filled by reordered packets.
+		};
+		std::map<int, StreamSeq> streams;
+		unsigned long long received;
+		unsigned long long lost;		///< Sum of StreamSeq::lost.
+		unsigned long long reordered;
+		unsigned long long malformed;
+
+		void account( const DataPacket *p );
+};
+
+
+#endif	//UDPREADER_H
@@ -0,0 +1,196 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// UdpWriter.cpp
+
+#include "UdpWriter.h"
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+using namespace std;
+
+
+/// Packets per sendmmsg() call.
+static const unsigned int BATCH_SIZE = 64;
+
+/// Largest UDP payload over IPv4.
+static const unsigned int MAX_UDP_PAYLOAD = 65507;
+
+
+UdpWriter::UdpWriter( const string &host, int port ) :
+	StreamTask( 1, 0 ),
+	maxDatagram(8192),
+	sent(0),
+	dropped(0)
+{
+	setId( "udpwriter" );
+	encoder.get_header( header, sizeof(header) );
+
+	memset( &addr, 0, sizeof(addr) );
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons( port );
+	fd = -1;
+	if( inet_pton( AF_INET, host.c_str(), &addr.sin_addr ) != 1 ) {
+		log( "ERROR: invalid address " ) << host << endl;
+		return;
+	}
+	fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	//connected: no address per datagram, errors of unicast receivers are reported
+	if( fd < 0 || connect( fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0 ) {
+		log( "ERROR: cannot create socket for " ) << host << ":" << port << ": " << strerror( errno ) << endl;
+		if( fd >= 0 ) {
+			close( fd );
+			fd = -1;
+		}
+	}
+}
+
+
+UdpWriter::~UdpWriter()
+{
+	if( fd >= 0 ) {
+		close( fd );
+	}
+}
+
+
+void UdpWriter::setSendBufferSize( int bytes )
+{
+	if( fd >= 0 && setsockopt( fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes) ) < 0 ) {
+		log( "ERROR: cannot set send buffer size: " ) << strerror( errno ) << endl;
+	}
+}
+
+
+void UdpWriter::setMaxDatagramSize( unsigned int bytes )
+{
+	maxDatagram = bytes < MAX_UDP_PAYLOAD ? bytes : MAX_UDP_PAYLOAD;
+}
+
+
+void UdpWriter::setMulticastTtl( int ttl )
+{
+	unsigned char t = ttl;
+	if( fd >= 0 && setsockopt( fd, IPPROTO_IP, IP_MULTICAST_TTL, &t, sizeof(t) ) < 0 ) {
+		log( "ERROR: cannot set multicast TTL: " ) << strerror( errno ) << endl;
+	}
+}
+
+
+void UdpWriter::setMulticastLoop( bool loop )
+{
+	unsigned char l = loop;
+	if( fd >= 0 && setsockopt( fd, IPPROTO_IP, IP_MULTICAST_LOOP, &l, sizeof(l) ) < 0 ) {
+		log( "ERROR: cannot set multicast loop: " ) << strerror( errno ) << endl;
+	}
+}
+
+
+void UdpWriter::setMulticastInterface( const string &address )
+{
+	struct in_addr a;
+	if( inet_pton( AF_INET, address.c_str(), &a ) != 1 ) {
+		log( "ERROR: invalid address " ) << address << endl;
+		return;
+	}
+	if( fd >= 0 && setsockopt( fd, IPPROTO_IP, IP_MULTICAST_IF, &a, sizeof(a) ) < 0 ) {
+		log( "ERROR: cannot set multicast interface: " ) << strerror( errno ) << endl;
+	}
+}
+
+
+void UdpWriter::run()
+{
+	vector<DataPacket *> batch;
+	try {
+		while( running ) {
+			batch.clear();
+			inPorts[0]->receiveBatch( batch, BATCH_SIZE );
+			sendDatagrams( batch );
+			for( unsigned int i = 0; i < batch.size(); i++ ) {
+				delete batch[i];
+			}
+		}
+	}
+	catch( char const* msg ) {
+		//canceled by stop()
+	}
+}
+
+
+/// Encode each packet of \p batch into a datagram and send them all.
+void UdpWriter::sendDatagrams( const vector<DataPacket *> &batch )
+{
+	struct mmsghdr msgs[BATCH_SIZE];
+	struct iovec iov[BATCH_SIZE];
+	unsigned int sizes[BATCH_SIZE];
+
+	//sizes first: the buffer must not move while it is filled
+	size_t total = 0;
+	for( unsigned int i = 0; i < batch.size(); i++ ) {
+		sizes[i] = BinaryEncoder::HEADER_SIZE + BinaryEncoder::encodedSize( batch[i] );
+		if( sizes[i] > maxDatagram || fd < 0 ) {
+			if( fd >= 0 ) {
+				log( "ERROR: packet " ) << batch[i]->seqNr << " of stream " << batch[i]->getStreamId()
+					<< " does not fit into a datagram: " << sizes[i] << " bytes" << endl;
+			}
+			sizes[i] = 0;
+			__atomic_add_fetch( &dropped, 1, __ATOMIC_RELAXED );
+		}
+		total += sizes[i];
+	}
+	if( buffer.size() < total ) {
+		buffer.resize( total );
+	}
+
+	unsigned int n = 0;
+	size_t offset = 0;
+	for( unsigned int i = 0; i < batch.size(); i++ ) {
+		if( !sizes[i] ) {
+			continue;
+		}
+		unsigned char *d = &buffer[offset];
+		memcpy( d, header, BinaryEncoder::HEADER_SIZE );
+		int len = encoder.encode( batch[i], d + BinaryEncoder::HEADER_SIZE, sizes[i] - BinaryEncoder::HEADER_SIZE );
+		if( len <= 0 ) {
+			__atomic_add_fetch( &dropped, 1, __ATOMIC_RELAXED );
+			continue;
+		}
+		iov[n].iov_base = d;
+		iov[n].iov_len = BinaryEncoder::HEADER_SIZE + len;
+		memset( &msgs[n], 0, sizeof(msgs[n]) );
+		msgs[n].msg_hdr.msg_iov = &iov[n];
+		msgs[n].msg_hdr.msg_iovlen = 1;
+		n++;
+		offset += sizes[i];
+	}
+
+	unsigned int done = 0;
+	while( done < n ) {
+		int k = sendmmsg( fd, &msgs[done], n - done, 0 );
+		if( k > 0 ) {
+			done += k;
+			__atomic_add_fetch( &sent, k, __ATOMIC_RELAXED );
+		}
+		else if( errno != EINTR ) {
+			//e.g. ECONNREFUSED of an earlier datagram: this one is lost, go on with the next
+			done++;
+			__atomic_add_fetch( &dropped, 1, __ATOMIC_RELAXED );
+		}
+	}
+}
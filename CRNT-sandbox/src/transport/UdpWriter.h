@@ -0,0 +1,88 @@
+/*
+ * This file is part of the CRN Toolbox.
+ * The CRN Toolbox is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ * The CRN Toolbox is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the CRN Toolbox; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// UdpWriter.h - stream task sending packets as UDP datagrams
+
+#ifndef UDPWRITER_H
+#define UDPWRITER_H
+
+#include "../core/StreamTask.h"
+#include "../encoders/BinaryEncoder.h"
+#include <netinet/in.h>
+#include <string>
+
+
+/**
+ * \ingroup transport
+ * \brief Sends its input as UDP datagrams to a host or multicast group.
+ *
+ * Every packet travels in a datagram of its own, encoded in the
+ * BinaryEncoder format (stream header followed by the packet), so a lost
+ * datagram loses just that packet and never delays the following ones as
+ * a TCP connection would. Receive the datagrams with UdpReader.
+ *
+ * The packets of a batch are sent with one sendmmsg() call. Packets that
+ * do not fit into a datagram (setMaxDatagramSize()) or that the kernel
+ * refuses are counted as dropped.
+ */
+class UdpWriter : public StreamTask
+{
+	public:
+		/**
+		 * \param host IPv4 address of the receiver or of a multicast group.
+		 * \param port UDP port of the receivers.
+		 */
+		UdpWriter( const std::string &host, int port );
+		virtual ~UdpWriter();
+
+		/// Check if the socket was created.
+		bool isOpen() const { return fd >= 0; }
+
+		/// Set SO_SNDBUF of the socket.
+		void setSendBufferSize( int bytes );
+
+		/// Largest datagram sent, bytes of the UDP payload (default 8192).
+		void setMaxDatagramSize( unsigned int bytes );
+
+		/// Hops of multicast datagrams (default 1, the local network).
+		void setMulticastTtl( int ttl );
+
+		/// Deliver multicast datagrams to receivers on this host, too (default on).
+		void setMulticastLoop( bool loop );
+
+		/// Send multicast datagrams through the interface with this IPv4 address.
+		void setMulticastInterface( const std::string &address );
+
+		unsigned long long getSent() const { return __atomic_load_n( &sent, __ATOMIC_RELAXED ); }		///< Datagrams sent.
+		unsigned long long getDropped() const { return __atomic_load_n( &dropped, __ATOMIC_RELAXED ); }	///< Packets not sent.
+
+	protected:
+		virtual void run();
+
+	private:
+		int fd;
+		struct sockaddr_in addr;
+		BinaryEncoder encoder;
+		unsigned char header[BinaryEncoder::HEADER_SIZE];
+		unsigned int maxDatagram;
+		std::vector<unsigned char> buffer;
+		unsigned long long sent;
+		unsigned long long dropped;
+
+		void sendDatagrams( const std::vector<DataPacket *> &batch );
+};
+
+
+#endif	//UDPWRITER_H